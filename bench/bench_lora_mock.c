@@ -0,0 +1,285 @@
+/*********************************************************************
+*
+*   NAME:
+*       bench_lora_mock.c
+*
+*   DESCRIPTION:
+*       in-memory stand in for the LoRa radio API. frames sent are
+*       queued and read back in order, frames can also be loaded
+*       directly. in loop mode reads walk the queue round and round
+*       without taking frames off it
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "bench_lora_mock.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* held frame               */
+    {
+    uint8_t size;                       /* size of data[]           */
+    uint8_t data[ MAX_LORA_MSG_SIZE ];  /* raw frame                */
+    } mock_frame;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static mock_frame queue[ MOCK_LORA_QUEUE_SIZE ];    /* held frames  */
+
+static uint16_t head;                   /* next frame to read       */
+
+static uint16_t count;                  /* frames held              */
+
+static uint16_t cursor;                 /* loop mode read position  */
+
+static bool looping;                    /* frames are kept on read  */
+
+static mock_lora_stats counters;        /* mock radio counters      */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       mock_lora_reset
+*
+*   DESCRIPTION:
+*       drop every held frame and counter, leave loop mode
+*
+*********************************************************************/
+void mock_lora_reset
+    (
+    void
+    )
+{
+
+head    = 0;
+count   = 0;
+cursor  = 0;
+looping = false;
+memset( &counters, 0, sizeof( counters ) );
+
+} /* mock_lora_reset() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       mock_lora_load
+*
+*   DESCRIPTION:
+*       queue frame as if it had been received
+*
+*   RETURN:
+*       T/F frame queued y/n
+*
+*********************************************************************/
+bool mock_lora_load
+    (
+    const uint8_t frame[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+mock_frame *slot;                       /* slot to fill             */
+
+if( count >= MOCK_LORA_QUEUE_SIZE )
+    {
+    return false;
+    }
+
+slot = &queue[ ( head + count ) % MOCK_LORA_QUEUE_SIZE ];
+slot->size = size;
+memcpy( slot->data, frame, size );
+count++;
+
+return true;
+
+} /* mock_lora_load() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       mock_lora_loop
+*
+*   DESCRIPTION:
+*       turn loop mode on or off, reads start from the oldest frame
+*
+*********************************************************************/
+void mock_lora_loop
+    (
+    bool enable
+    )
+{
+
+looping = enable;
+cursor  = 0;
+
+} /* mock_lora_loop() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       mock_lora_get_stats
+*
+*   DESCRIPTION:
+*       copy mock radio counters
+*
+*********************************************************************/
+void mock_lora_get_stats
+    (
+    mock_lora_stats *stats
+    )
+{
+
+*stats = counters;
+
+} /* mock_lora_get_stats() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_port_init
+*
+*   DESCRIPTION:
+*       no hardware to set up
+*
+*********************************************************************/
+void lora_port_init
+    (
+    lora_config config_data
+    )
+{
+
+( void ) config_data;
+
+} /* lora_port_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_init_continious_rx
+*
+*   DESCRIPTION:
+*       always back in receive mode
+*
+*********************************************************************/
+bool lora_init_continious_rx
+    (
+    void
+    )
+{
+
+return true;
+
+} /* lora_init_continious_rx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_send_message
+*
+*   DESCRIPTION:
+*       queue frame to be read back
+*
+*********************************************************************/
+lora_errors lora_send_message
+    (
+    uint8_t message[],
+    uint8_t size
+    )
+{
+
+counters.sent++;
+if( ! mock_lora_load( message, size ) )
+    {
+    counters.dropped++;
+    }
+
+return RX_NO_ERROR;
+
+} /* lora_send_message() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_get_message
+*
+*   DESCRIPTION:
+*       hand out the next held frame
+*
+*   RETURN:
+*       T/F frame received y/n
+*
+*********************************************************************/
+bool lora_get_message
+    (
+    uint8_t message[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+mock_frame *slot;                       /* frame to hand out        */
+
+if( count == 0 )
+    {
+    return false;
+    }
+
+if( looping )
+    {
+    slot    = &queue[ ( head + cursor ) % MOCK_LORA_QUEUE_SIZE ];
+    cursor  = ( uint16_t )( ( cursor + 1 ) % count );
+    }
+else
+    {
+    slot    = &queue[ head ];
+    head    = ( uint16_t )( ( head + 1 ) % MOCK_LORA_QUEUE_SIZE );
+    count--;
+    }
+
+if( slot->size > max_size )
+    {
+    *errors = RX_SIZING;
+    return true;
+    }
+
+memcpy( message, slot->data, slot->size );
+*size   = slot->size;
+*errors = RX_NO_ERROR;
+counters.received++;
+
+return true;
+
+} /* lora_get_message() */
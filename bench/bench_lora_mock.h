@@ -0,0 +1,81 @@
+/*********************************************************************
+*
+*   HEADER:
+*       mock LoRa layer for host benchmarks. stands in for the LoRa
+*       submodule's radio functions so messageAPI runs its real
+*       LoRa transport with frames held in memory. in loop mode the
+*       loaded frames are handed out over and over, so a decode
+*       benchmark reads without refilling
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef BENCH_LORA_MOCK_H
+#define BENCH_LORA_MOCK_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#ifndef MOCK_LORA_QUEUE_SIZE
+#define MOCK_LORA_QUEUE_SIZE ( 64 )     /* frames held              */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* mock radio counters      */
+    {
+    uint32_t sent;                      /* lora_send_message calls  */
+    uint32_t received;                  /* frames handed out        */
+    uint32_t dropped;                   /* sent while queue full    */
+    } mock_lora_stats;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+bench_lora_mock.c
+--------------------------------------------------------------------*/
+void mock_lora_reset
+    (
+    void
+    );
+
+bool mock_lora_load
+    (
+    const uint8_t frame[],              /* raw frame to receive     */
+    uint8_t size                        /* size of frame[]          */
+    );
+
+void mock_lora_loop
+    (
+    bool enable                         /* hand out frames again    */
+    );
+
+void mock_lora_get_stats
+    (
+    mock_lora_stats *stats              /* pointer to store stats   */
+    );
+
+#endif /* BENCH_LORA_MOCK_H */
+/* bench_lora_mock.h */
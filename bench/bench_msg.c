@@ -0,0 +1,610 @@
+/*********************************************************************
+*
+*   NAME:
+*       bench_msg.c
+*
+*   DESCRIPTION:
+*       host benchmark of the message path: crc, encode, decode of
+*       valid, corrupt and foreign traffic, and a full send/receive
+*       round trip, for data sizes from 0 to MAX_MSG_LENGTH. frames
+*       go through the real LoRa transport into bench_lora_mock.c.
+*       each result is printed as one JSON object a line:
+*
+*           {"bench":"decode","variant":"valid","size":10,
+*            "frames":20000,"ns_per_frame":88.1,"frames_per_sec":...}
+*
+*       usage: bench_msg [-n frames] [-b baseline] [-t percent]
+*       with a baseline, a case more than percent (default 10)
+*       slower than its baseline line is reported on stderr and
+*       the exit status is 1. see bench/Makefile
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE                     /* clock_gettime under
+                                           -std=c11                 */
+
+#include "messageAPI.h"
+#include "msg_crc.h"
+#include "bench_lora_mock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define DEFAULT_FRAMES      ( 20000 )   /* frames timed per case    */
+
+#define DEFAULT_TOLERANCE   ( 10.0 )    /* percent slower allowed   */
+
+#define REPEATS             ( 3 )       /* best of, per case        */
+
+#define NAME_SIZE           ( 16 )      /* bench and variant names  */
+
+#define MAX_BASELINE        ( 512 )     /* baseline results read    */
+
+#define LINE_SIZE           ( 256 )     /* baseline line buffer     */
+
+#define FOREIGN_MODULE      ( RPI_MODULE ) /* address rx_ctx skips  */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef enum                            /* decode traffic mixes     */
+    {
+    MIX_VALID,                          /* every frame good         */
+    MIX_CORRUPT,                        /* every frame fails crc    */
+    MIX_FOREIGN,                        /* every frame for another
+                                           module                   */
+    MIX_MIXED,                          /* 8 good, 1 corrupt and 1
+                                           foreign in 10            */
+    MIX_COUNT
+    } traffic_mix;
+
+typedef struct                          /* one benchmark result     */
+    {
+    char bench[ NAME_SIZE ];            /* crc, encode, ...         */
+    char variant[ NAME_SIZE ];          /* engine or traffic mix    */
+    unsigned size;                      /* data bytes               */
+    double ns_per_frame;                /* time per frame           */
+    } bench_result;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+const location current_location = TIVA_MODULE;
+
+static const char * const mix_names[ MIX_COUNT ] =
+    { "valid", "corrupt", "foreign", "mixed" };
+
+static const char * const engine_names[ CRC8_ENGINE_COUNT ] =
+    { "bytewise", "slice4", "slice8", "clmul" };
+
+static const uint8_t candidate_sizes[] =
+    { 0, 1, 4, MAX_MSG_LENGTH_V1, 16, 32, 64, 128, 200 };
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static message_ctx tx_ctx;              /* sending module           */
+
+static message_ctx rx_ctx;              /* receiving module         */
+
+static uint32_t frames;                 /* frames timed per case    */
+
+static double tolerance;                /* percent slower allowed   */
+
+static bench_result baseline[ MAX_BASELINE ];
+                                        /* results to compare with  */
+
+static unsigned baseline_count;         /* entries in baseline[]    */
+
+static unsigned regressions;            /* cases over tolerance     */
+
+static volatile uint8_t sink;           /* keeps results live       */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       now_ns
+*
+*   DESCRIPTION:
+*       monotonic time in ns
+*
+*********************************************************************/
+static uint64_t now_ns
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+struct timespec now;
+
+clock_gettime( CLOCK_MONOTONIC, &now );
+
+return ( uint64_t ) now.tv_sec * 1000000000u + ( uint64_t ) now.tv_nsec;
+
+} /* now_ns() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       report
+*
+*   DESCRIPTION:
+*       print one result and check it against the baseline
+*
+*********************************************************************/
+static void report
+    (
+    const char *bench,
+    const char *variant,
+    unsigned size,
+    uint64_t best_ns
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+double ns_per_frame;                    /* time per frame           */
+unsigned i;                             /* iterator                 */
+
+ns_per_frame = ( double ) best_ns / frames;
+
+printf( "{\"bench\":\"%s\",\"variant\":\"%s\",\"size\":%u,\"frames\":%lu,"
+        "\"ns_per_frame\":%.1f,\"frames_per_sec\":%.0f}\n",
+        bench, variant, size, ( unsigned long ) frames,
+        ns_per_frame, ( ns_per_frame > 0 ) ? 1e9 / ns_per_frame : 0.0 );
+
+for( i = 0; i < baseline_count; i++ )
+    {
+    if( strcmp( baseline[ i ].bench, bench ) == 0 && strcmp( baseline[ i ].variant, variant ) == 0
+     && baseline[ i ].size == size
+     && ns_per_frame > baseline[ i ].ns_per_frame * ( 1.0 + tolerance / 100.0 ) )
+        {
+        fprintf( stderr, "regression: %s %s size %u %.1f ns, baseline %.1f ns\n",
+                 bench, variant, size, ns_per_frame, baseline[ i ].ns_per_frame );
+        regressions++;
+        }
+    }
+
+} /* report() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       load_baseline
+*
+*   DESCRIPTION:
+*       read results printed by an earlier run
+*
+*   RETURN:
+*       T/F file read y/n
+*
+*********************************************************************/
+static bool load_baseline
+    (
+    const char *path
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+FILE *file;                             /* baseline file            */
+char line[ LINE_SIZE ];                 /* one result               */
+bench_result *result;                   /* entry to fill            */
+
+file = fopen( path, "r" );
+if( file == NULL )
+    {
+    return false;
+    }
+
+while( baseline_count < MAX_BASELINE && fgets( line, sizeof( line ), file ) != NULL )
+    {
+    result = &baseline[ baseline_count ];
+    if( sscanf( line, "{\"bench\":\"%15[^\"]\",\"variant\":\"%15[^\"]\",\"size\":%u,\"frames\":%*u,\"ns_per_frame\":%lf",
+                result->bench, result->variant, &result->size, &result->ns_per_frame ) == 4 )
+        {
+        baseline_count++;
+        }
+    }
+
+fclose( file );
+
+return true;
+
+} /* load_baseline() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       bench_crc
+*
+*   DESCRIPTION:
+*       crc of a frame carrying size data bytes, each engine the
+*       host supports
+*
+*********************************************************************/
+static void bench_crc
+    (
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ MAX_LORA_MSG_SIZE ];      /* data sent                */
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* encoded frame            */
+uint8_t frame_size;                     /* bytes under the crc      */
+uint64_t start;                         /* time at start            */
+uint64_t best;                          /* fastest repeat           */
+uint32_t i;                             /* iterator                 */
+uint8_t repeat;                         /* repeat of case           */
+uint8_t engine;                         /* crc engine               */
+
+memset( data, 0x5A, sizeof( data ) );
+frame_size = ( uint8_t )( encode_message_ctx( &tx_ctx, rx_ctx.module, data, size, frame ) - 1 );
+
+for( engine = 0; engine < CRC8_ENGINE_COUNT; engine++ )
+    {
+    if( ! crc8_supported( ( crc8_engine ) engine ) )
+        {
+        continue;
+        }
+
+    best = UINT64_MAX;
+    for( repeat = 0; repeat < REPEATS; repeat++ )
+        {
+        start = now_ns();
+        for( i = 0; i < frames; i++ )
+            {
+            sink ^= crc8_update_with( ( crc8_engine ) engine, crc8_init(), frame, frame_size );
+            }
+        if( now_ns() - start < best )
+            {
+            best = now_ns() - start;
+            }
+        }
+
+    report( "crc", engine_names[ engine ], size, best );
+    }
+
+} /* bench_crc() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       bench_encode
+*
+*   DESCRIPTION:
+*       encode_message of size data bytes
+*
+*********************************************************************/
+static void bench_encode
+    (
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ MAX_LORA_MSG_SIZE ];      /* data sent                */
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* encoded frame            */
+uint64_t start;                         /* time at start            */
+uint64_t best;                          /* fastest repeat           */
+uint32_t i;                             /* iterator                 */
+uint8_t repeat;                         /* repeat of case           */
+
+memset( data, 0x5A, sizeof( data ) );
+best = UINT64_MAX;
+
+for( repeat = 0; repeat < REPEATS; repeat++ )
+    {
+    start = now_ns();
+    for( i = 0; i < frames; i++ )
+        {
+        sink ^= encode_message_ctx( &tx_ctx, rx_ctx.module, data, size, frame );
+        }
+    if( now_ns() - start < best )
+        {
+        best = now_ns() - start;
+        }
+    }
+
+report( "encode", "valid", size, best );
+
+} /* bench_encode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       load_mix
+*
+*   DESCRIPTION:
+*       fill the mock radio with MOCK_LORA_QUEUE_SIZE frames of
+*       traffic mix, each from the next sequence number. more
+*       frames than MSG_DEDUP_WINDOW means a frame seen again on
+*       the next lap is taken as new rather than as a duplicate
+*
+*********************************************************************/
+static void load_mix
+    (
+    traffic_mix mix,
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ MAX_LORA_MSG_SIZE ];      /* data sent                */
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* encoded frame            */
+uint8_t frame_size;                     /* size of frame[]          */
+traffic_mix kind;                       /* mix of this frame        */
+uint8_t i;                              /* iterator                 */
+
+memset( data, 0x5A, sizeof( data ) );
+mock_lora_reset();
+
+for( i = 0; i < MOCK_LORA_QUEUE_SIZE; i++ )
+    {
+    kind = mix;
+    if( mix == MIX_MIXED )
+        {
+        kind = ( i % 10 == 8 ) ? MIX_CORRUPT : ( i % 10 == 9 ) ? MIX_FOREIGN : MIX_VALID;
+        }
+
+    frame_size = encode_message_ctx( &tx_ctx, ( kind == MIX_FOREIGN ) ? FOREIGN_MODULE : rx_ctx.module,
+                                     data, size, frame );
+    if( kind == MIX_CORRUPT )
+        {
+        frame[ frame_size - 1 ] ^= 0x01;
+        }
+
+    ( void ) mock_lora_load( frame, frame_size );
+    }
+
+mock_lora_loop( true );
+
+} /* load_mix() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       bench_decode
+*
+*   DESCRIPTION:
+*       get_message through the LoRa transport, one frame a read
+*
+*********************************************************************/
+static void bench_decode
+    (
+    traffic_mix mix,
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+rx_message message;                     /* message received         */
+lora_errors errors;                     /* decode result            */
+uint64_t start;                         /* time at start            */
+uint64_t best;                          /* fastest repeat           */
+uint32_t received;                      /* messages taken           */
+uint32_t i;                             /* iterator                 */
+uint8_t repeat;                         /* repeat of case           */
+
+load_mix( mix, size );
+best        = UINT64_MAX;
+received    = 0;
+
+for( repeat = 0; repeat < REPEATS; repeat++ )
+    {
+    received = 0;
+    start = now_ns();
+    for( i = 0; i < frames; i++ )
+        {
+        if( get_message_ctx( &rx_ctx, &message, &errors ) && errors == RX_NO_ERROR )
+            {
+            received++;
+            }
+        }
+    if( now_ns() - start < best )
+        {
+        best = now_ns() - start;
+        }
+    }
+
+if( mix == MIX_VALID && received != frames )
+    {
+    fprintf( stderr, "decode valid size %u: %lu of %lu frames taken\n", size,
+             ( unsigned long ) received, ( unsigned long ) frames );
+    }
+
+report( "decode", mix_names[ mix ], size, best );
+
+} /* bench_decode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       bench_round_trip
+*
+*   DESCRIPTION:
+*       send_message from one context and get_message on the other
+*
+*********************************************************************/
+static void bench_round_trip
+    (
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+tx_message tx;                          /* message sent             */
+rx_message rx;                          /* message received         */
+lora_errors errors;                     /* decode result            */
+uint64_t start;                         /* time at start            */
+uint64_t best;                          /* fastest repeat           */
+uint32_t received;                      /* messages taken           */
+uint32_t i;                             /* iterator                 */
+uint8_t repeat;                         /* repeat of case           */
+
+memset( &tx, 0, sizeof( tx ) );
+memset( tx.message, 0x5A, size );
+tx.destination  = rx_ctx.module;
+tx.size         = size;
+best            = UINT64_MAX;
+received        = 0;
+
+mock_lora_reset();
+
+for( repeat = 0; repeat < REPEATS; repeat++ )
+    {
+    received = 0;
+    start = now_ns();
+    for( i = 0; i < frames; i++ )
+        {
+        ( void ) send_message_ctx( &tx_ctx, tx );
+        if( get_message_ctx( &rx_ctx, &rx, &errors ) && errors == RX_NO_ERROR )
+            {
+            received++;
+            }
+        }
+    if( now_ns() - start < best )
+        {
+        best = now_ns() - start;
+        }
+    }
+
+if( received != frames )
+    {
+    fprintf( stderr, "round trip size %u: %lu of %lu frames taken\n", size,
+             ( unsigned long ) received, ( unsigned long ) frames );
+    }
+
+report( "round_trip", "valid", size, best );
+
+} /* bench_round_trip() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       main
+*
+*   DESCRIPTION:
+*       run every case at each size
+*
+*   RETURN:
+*       0, 1 on a regression against the baseline, 2 on bad usage
+*
+*********************************************************************/
+int main
+    (
+    int argc,
+    char *argv[]
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_config config;                     /* unused by the mock       */
+uint8_t sizes[ sizeof( candidate_sizes ) + 1 ];
+                                        /* data sizes to run        */
+uint8_t size_count;                     /* entries in sizes[]       */
+uint8_t i;                              /* iterator                 */
+uint8_t mix;                            /* traffic mix              */
+int arg;                                /* argument index           */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+frames      = DEFAULT_FRAMES;
+tolerance   = DEFAULT_TOLERANCE;
+size_count  = 0;
+memset( &config, 0, sizeof( config ) );
+
+for( arg = 1; arg + 1 < argc; arg += 2 )
+    {
+    if( strcmp( argv[ arg ], "-n" ) == 0 )
+        {
+        frames = ( uint32_t ) strtoul( argv[ arg + 1 ], NULL, 10 );
+        }
+    else if( strcmp( argv[ arg ], "-t" ) == 0 )
+        {
+        tolerance = strtod( argv[ arg + 1 ], NULL );
+        }
+    else if( strcmp( argv[ arg ], "-b" ) == 0 )
+        {
+        if( ! load_baseline( argv[ arg + 1 ] ) )
+            {
+            fprintf( stderr, "can not read baseline %s\n", argv[ arg + 1 ] );
+            return 2;
+            }
+        }
+    else
+        {
+        break;
+        }
+    }
+
+if( arg < argc || frames == 0 )
+    {
+    fprintf( stderr, "usage: %s [-n frames] [-b baseline] [-t percent]\n", argv[ 0 ] );
+    return 2;
+    }
+
+/*----------------------------------------------------------
+Sizes from 0 up to MAX_MSG_LENGTH
+----------------------------------------------------------*/
+for( i = 0; i < sizeof( candidate_sizes ); i++ )
+    {
+    if( candidate_sizes[ i ] < MAX_MSG_LENGTH )
+        {
+        sizes[ size_count++ ] = candidate_sizes[ i ];
+        }
+    }
+sizes[ size_count++ ] = MAX_MSG_LENGTH;
+
+/*----------------------------------------------------------
+Two contexts on the LoRa transport share the mock radio
+----------------------------------------------------------*/
+mock_lora_reset();
+( void ) init_message_ctx( &tx_ctx, RPI_MODULE, NULL, config );
+( void ) init_message_ctx( &rx_ctx, TIVA_MODULE, NULL, config );
+
+for( i = 0; i < size_count; i++ )
+    {
+    bench_crc( sizes[ i ] );
+    bench_encode( sizes[ i ] );
+    for( mix = 0; mix < MIX_COUNT; mix++ )
+        {
+        bench_decode( ( traffic_mix ) mix, sizes[ i ] );
+        }
+    bench_round_trip( sizes[ i ] );
+    }
+
+return ( regressions > 0 ) ? 1 : 0;
+
+} /* main() */
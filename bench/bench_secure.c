@@ -0,0 +1,304 @@
+/*********************************************************************
+*
+*   NAME:
+*       bench_secure.c
+*
+*   DESCRIPTION:
+*       cycles per frame for secure mode against plain crc frames.
+*       each size is encoded (and sealed) and then decoded (and
+*       opened) through a transport that hands back the last frame
+*       sent. build on the host with
+*
+*           cc -O2 -I. -I<LoRa parent> -DMSG_USE_LORA_TRANSPORT=0
+*              bench/bench_secure.c messageAPI.c msg_crc.c msg_ascon.c
+*              msg_transport_loopback.c msg_transport_socket.c
+*
+*       on the Tiva define BENCH_DWT to count with the Cortex-M
+*       DWT cycle counter and print through the board's stdout
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "messageAPI.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined( BENCH_DWT )
+#elif defined( __x86_64__ ) || defined( __i386__ )
+    #include <x86intrin.h>
+#else
+    #include <time.h>
+#endif
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define ROUNDS              ( 2000 )    /* frames timed per size    */
+
+#define DWT_CTRL            ( *( volatile uint32_t * ) 0xE0001000 )
+
+#define DWT_CYCCNT          ( *( volatile uint32_t * ) 0xE0001004 )
+
+#define DEMCR               ( *( volatile uint32_t * ) 0xE000EDFC )
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+const location current_location = RPI_MODULE;
+
+static const uint8_t sizes[] = { 10, 51, 115, MAX_SECURE_LENGTH_V2 };
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static uint8_t held[ MAX_LORA_MSG_SIZE ];   /* last frame sent      */
+
+static uint8_t held_size;                   /* size of held[]       */
+
+static message_ctx tx_ctx;                  /* sending module       */
+
+static message_ctx rx_ctx;                  /* receiving module     */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       cycles
+*
+*   DESCRIPTION:
+*       cycle counter, or ns where the host has none to read
+*
+*********************************************************************/
+static uint64_t cycles
+    (
+    void
+    )
+{
+#if defined( BENCH_DWT )
+return DWT_CYCCNT;
+#elif defined( __x86_64__ ) || defined( __i386__ )
+return __rdtsc();
+#else
+struct timespec now;
+
+clock_gettime( CLOCK_MONOTONIC, &now );
+return ( uint64_t ) now.tv_sec * 1000000000u + ( uint64_t ) now.tv_nsec;
+#endif
+
+} /* cycles() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       bench_init / bench_send / bench_get / bench_rx_mode
+*
+*   DESCRIPTION:
+*       transport that keeps the last frame sent and reads it back
+*
+*********************************************************************/
+static lora_errors bench_init
+    (
+    void *port,
+    lora_config config_data
+    )
+{
+( void ) port;
+( void ) config_data;
+
+return RX_NO_ERROR;
+
+} /* bench_init() */
+
+static lora_errors bench_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+( void ) port;
+
+memcpy( held, message_array, size );
+held_size = size;
+
+return RX_NO_ERROR;
+
+} /* bench_send() */
+
+static bool bench_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+( void ) port;
+( void ) max_size;
+
+memcpy( message_array, held, held_size );
+*size   = held_size;
+*errors = RX_NO_ERROR;
+
+return true;
+
+} /* bench_get() */
+
+static bool bench_rx_mode
+    (
+    void *port
+    )
+{
+( void ) port;
+
+return true;
+
+} /* bench_rx_mode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       run
+*
+*   DESCRIPTION:
+*       time encode and decode of one data size
+*
+*********************************************************************/
+static void run
+    (
+    uint8_t size,
+    bool secure,
+    uint64_t *tx_cycles,
+    uint64_t *rx_cycles
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ MAX_LORA_MSG_SIZE ];      /* data sent                */
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* encoded frame            */
+msg_header header;                      /* destination              */
+msg_view view;                          /* decoded frame            */
+lora_errors errors;                     /* decode result            */
+uint64_t start;                         /* counter at start         */
+uint16_t i;                             /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( data, 0x5A, sizeof( data ) );
+memset( &header, 0, sizeof( header ) );
+header.destination = TIVA_MODULE;
+set_secure_ctx( &tx_ctx, secure, get_secure_counter_ctx( &tx_ctx ) );
+set_secure_ctx( &rx_ctx, secure, 0 );
+*tx_cycles = 0;
+*rx_cycles = 0;
+
+for( i = 0; i < ROUNDS; i++ )
+    {
+    start = cycles();
+    held_size = encode_message_header_ctx( &tx_ctx, &header, data, size, frame );
+    *tx_cycles += cycles() - start;
+    memcpy( held, frame, held_size );
+
+    start = cycles();
+    if( ! get_message_view_ctx( &rx_ctx, &view, &errors ) || ! view.valid )
+        {
+        printf( "decode failed, size %u error %d\n", size, errors );
+        return;
+        }
+    *rx_cycles += cycles() - start;
+    }
+
+*tx_cycles /= ROUNDS;
+*rx_cycles /= ROUNDS;
+
+} /* run() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       main
+*
+*   DESCRIPTION:
+*       print per frame cost of each size, plain and secure
+*
+*********************************************************************/
+int main
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;                /* read back transport      */
+lora_config config;                     /* unused                   */
+uint8_t key[ MSG_KEY_SIZE ];            /* shared key               */
+uint64_t plain_tx, plain_rx;            /* crc frame cost           */
+uint64_t secure_tx, secure_rx;          /* sealed frame cost        */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+#if defined( BENCH_DWT )
+DEMCR       |= 1u << 24;
+DWT_CYCCNT  = 0;
+DWT_CTRL    |= 1;
+#endif
+
+memset( &config, 0, sizeof( config ) );
+memset( key, 0x42, sizeof( key ) );
+transport.init      = bench_init;
+transport.send      = bench_send;
+transport.get       = bench_get;
+transport.rx_mode   = bench_rx_mode;
+transport.port      = NULL;
+transport.wait_fd   = NULL;
+
+( void ) init_message_ctx( &tx_ctx, RPI_MODULE, &transport, config );
+( void ) init_message_ctx( &rx_ctx, TIVA_MODULE, &transport, config );
+( void ) set_secure_key_ctx( &tx_ctx, TIVA_MODULE, key );
+( void ) set_secure_key_ctx( &rx_ctx, RPI_MODULE, key );
+
+#if defined( BENCH_DWT )
+printf( "data  plain tx  plain rx  secure tx  secure rx   (cycles/frame)\n" );
+#elif defined( __x86_64__ ) || defined( __i386__ )
+printf( "data  plain tx  plain rx  secure tx  secure rx   (TSC ticks/frame)\n" );
+#else
+printf( "data  plain tx  plain rx  secure tx  secure rx   (ns/frame)\n" );
+#endif
+
+for( i = 0; i < sizeof( sizes ); i++ )
+    {
+    run( sizes[ i ], false, &plain_tx, &plain_rx );
+    run( sizes[ i ], true, &secure_tx, &secure_rx );
+    printf( "%4u  %8llu  %8llu  %9llu  %9llu\n", sizes[ i ],
+            ( unsigned long long ) plain_tx, ( unsigned long long ) plain_rx,
+            ( unsigned long long ) secure_tx, ( unsigned long long ) secure_rx );
+    }
+
+return 0;
+
+} /* main() */
@@ -0,0 +1,397 @@
+/*********************************************************************
+*
+*   NAME:
+*       capture_replay.c
+*
+*   DESCRIPTION:
+*       plays a capture file written through msg_capture.c back
+*       through get_message at full speed. the file is mapped, one
+*       pass prints its records (with -d) and signal spread, then
+*       each timed pass decodes every record on a fresh context of
+*       the capturing module and prints the message path counters
+*
+*           capture_replay [-l location] [-k key] [-r passes] [-d]
+*                          file
+*
+*       location and key default to the ones in the file header.
+*       see bench/Makefile
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE                     /* clock_gettime under
+                                           -std=c11                 */
+
+#include "messageAPI.h"
+#include "msg_capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+const location current_location = RPI_MODULE;
+
+static const char * const error_names[ MSG_ERROR_COUNT ] =
+    { "ok", "timeout", "crc", "key", "double", "sizing",
+      "header", "array_size", "init" };
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static message_ctx ctx;                 /* replaying module         */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       now_ns
+*
+*   DESCRIPTION:
+*       monotonic time in ns
+*
+*********************************************************************/
+static uint64_t now_ns
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+struct timespec now;
+
+clock_gettime( CLOCK_MONOTONIC, &now );
+
+return ( uint64_t ) now.tv_sec * 1000000000u + ( uint64_t ) now.tv_nsec;
+
+} /* now_ns() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       stats_ns
+*
+*   DESCRIPTION:
+*       decode histogram clock, low 32 bits of ns
+*
+*********************************************************************/
+static uint32_t stats_ns
+    (
+    void
+    )
+{
+
+return ( uint32_t ) now_ns();
+
+} /* stats_ns() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       scan
+*
+*   DESCRIPTION:
+*       one untimed pass over the records, printing each with dump
+*       and the signal spread at the end
+*
+*   RETURN:
+*       records in the file
+*
+*********************************************************************/
+static uint32_t scan
+    (
+    capture_reader *reader,
+    bool dump
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+capture_record record;                  /* record read              */
+uint32_t records;                       /* records read             */
+uint64_t bytes;                         /* raw buffer bytes         */
+int64_t rssi_total;                     /* sum of rssi              */
+int64_t snr_total;                      /* sum of snr               */
+int16_t rssi_min;                       /* weakest rssi             */
+int16_t rssi_max;                       /* strongest rssi           */
+int8_t snr_min;                         /* lowest snr               */
+int8_t snr_max;                         /* highest snr              */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+records     = 0;
+bytes       = 0;
+rssi_total  = 0;
+snr_total   = 0;
+rssi_min    = INT16_MAX;
+rssi_max    = INT16_MIN;
+snr_min     = INT8_MAX;
+snr_max     = INT8_MIN;
+
+capture_rewind( reader );
+while( capture_next( reader, &record ) )
+    {
+    records++;
+    bytes       += record.size;
+    rssi_total  += record.rssi;
+    snr_total   += record.snr;
+    rssi_min    = ( record.rssi < rssi_min ) ? record.rssi : rssi_min;
+    rssi_max    = ( record.rssi > rssi_max ) ? record.rssi : rssi_max;
+    snr_min     = ( record.snr < snr_min ) ? record.snr : snr_min;
+    snr_max     = ( record.snr > snr_max ) ? record.snr : snr_max;
+
+    if( dump )
+        {
+        printf( "%llu.%06llu rssi %d snr %.2f %s %3u:",
+                ( unsigned long long )( record.time_us / 1000000u ),
+                ( unsigned long long )( record.time_us % 1000000u ),
+                record.rssi, record.snr / 4.0,
+                ( record.errors < MSG_ERROR_COUNT ) ? error_names[ record.errors ] : "?",
+                record.size );
+        for( i = 0; i < record.size; i++ )
+            {
+            printf( " %02x", record.data[ i ] );
+            }
+        printf( "\n" );
+        }
+    }
+
+printf( "records %lu, %llu buffer bytes%s\n", ( unsigned long ) records,
+        ( unsigned long long ) bytes, reader->truncated ? ", last record cut short" : "" );
+if( records > 0 )
+    {
+    printf( "rssi %d / %.1f / %d dBm, snr %.2f / %.2f / %.2f dB (min / mean / max)\n",
+            rssi_min, ( double ) rssi_total / records, rssi_max,
+            snr_min / 4.0, ( double ) snr_total / records / 4.0, snr_max / 4.0 );
+    }
+
+return records;
+
+} /* scan() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       replay
+*
+*   DESCRIPTION:
+*       decode every record on a fresh context
+*
+*   RETURN:
+*       ns taken
+*
+*********************************************************************/
+static uint64_t replay
+    (
+    capture_reader *reader,
+    location module,
+    uint8_t key,
+    uint32_t *messages
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;                /* plays the capture        */
+lora_config config;                     /* unused by the replay     */
+rx_message message;                     /* message decoded          */
+lora_errors errors;                     /* decode result            */
+uint64_t start;                         /* time at start            */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( &config, 0, sizeof( config ) );
+*messages = 0;
+
+capture_rewind( reader );
+transport = capture_replay_transport( reader );
+( void ) init_message_ctx( &ctx, module, &transport, config );
+update_key_ctx( &ctx, key );
+set_stats_clock_ctx( &ctx, stats_ns );
+
+/*----------------------------------------------------------
+Frames left in the last buffer are read after the capture
+runs out
+----------------------------------------------------------*/
+start = now_ns();
+while( true )
+    {
+    if( get_message_ctx( &ctx, &message, &errors ) )
+        {
+        if( errors == RX_NO_ERROR )
+            {
+            ( *messages )++;
+            }
+        }
+    else if( capture_at_end( reader ) )
+        {
+        break;
+        }
+    }
+
+return now_ns() - start;
+
+} /* replay() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       main
+*
+*   DESCRIPTION:
+*       map the capture, scan it and replay it
+*
+*   RETURN:
+*       0, 1 if the file can not be read, 2 on bad usage
+*
+*********************************************************************/
+int main
+    (
+    int argc,
+    char *argv[]
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+capture_reader reader;                  /* mapped capture           */
+msg_filter_stats filter;                /* rx filter counters       */
+msg_stats stats;                        /* message path counters    */
+location module;                        /* replaying module         */
+uint8_t key;                            /* key replayed with        */
+bool module_set;                        /* -l given                 */
+bool key_set;                           /* -k given                 */
+bool dump;                              /* print every record       */
+uint32_t passes;                        /* timed passes             */
+uint32_t records;                       /* records in the file      */
+uint32_t messages;                      /* messages decoded         */
+uint64_t ns;                            /* time of a pass           */
+uint32_t pass;                          /* iterator                 */
+uint8_t i;                              /* iterator                 */
+int arg;                                /* argument index           */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+module      = RPI_MODULE;
+key         = 0;
+module_set  = false;
+key_set     = false;
+dump        = false;
+passes      = 1;
+
+for( arg = 1; arg < argc - 1; arg++ )
+    {
+    if( strcmp( argv[ arg ], "-d" ) == 0 )
+        {
+        dump = true;
+        }
+    else if( strcmp( argv[ arg ], "-l" ) == 0 && arg + 2 < argc )
+        {
+        module      = ( location ) strtoul( argv[ ++arg ], NULL, 0 );
+        module_set  = true;
+        }
+    else if( strcmp( argv[ arg ], "-k" ) == 0 && arg + 2 < argc )
+        {
+        key         = ( uint8_t ) strtoul( argv[ ++arg ], NULL, 0 );
+        key_set     = true;
+        }
+    else if( strcmp( argv[ arg ], "-r" ) == 0 && arg + 2 < argc )
+        {
+        passes      = ( uint32_t ) strtoul( argv[ ++arg ], NULL, 0 );
+        }
+    else
+        {
+        break;
+        }
+    }
+
+if( arg != argc - 1 || passes == 0 )
+    {
+    fprintf( stderr, "usage: %s [-l location] [-k key] [-r passes] [-d] file\n", argv[ 0 ] );
+    return 2;
+    }
+
+if( ! capture_map( &reader, argv[ arg ] ) )
+    {
+    fprintf( stderr, "can not read capture %s\n", argv[ arg ] );
+    return 1;
+    }
+
+module  = module_set ? module : reader.header.location;
+key     = key_set ? key : reader.header.key;
+printf( "capture of module %u, key 0x%02x, replayed as module %u, key 0x%02x\n",
+        reader.header.location, reader.header.key, module, key );
+
+records = scan( &reader, dump );
+
+/*----------------------------------------------------------
+Timed passes, each on a fresh context so the duplicate
+filter starts empty
+----------------------------------------------------------*/
+messages = 0;
+for( pass = 0; pass < passes; pass++ )
+    {
+    ns = replay( &reader, module, key, &messages );
+    printf( "pass %lu: %llu ns, %.1f ns/record, %.0f records/s, %lu messages\n",
+            ( unsigned long )( pass + 1 ), ( unsigned long long ) ns,
+            records ? ( double ) ns / records : 0.0,
+            ns ? records * 1e9 / ns : 0.0, ( unsigned long ) messages );
+    }
+
+get_filter_stats_ctx( &ctx, &filter );
+get_message_stats_ctx( &ctx, &stats );
+
+printf( "frames seen %lu, filtered %lu, accepted %lu, duplicate %lu, grace key %lu\n",
+        ( unsigned long ) filter.frames_seen, ( unsigned long ) filter.frames_filtered,
+        ( unsigned long ) filter.frames_accepted, ( unsigned long ) filter.frames_duplicate,
+        ( unsigned long ) filter.frames_grace_key );
+
+printf( "errors:" );
+for( i = RX_NO_ERROR + 1; i < MSG_ERROR_COUNT; i++ )
+    {
+    printf( " %s %lu", error_names[ i ], ( unsigned long ) stats.rx_errors[ i ] );
+    }
+printf( "\n" );
+
+if( stats.decode.count > 0 )
+    {
+    printf( "decode %.1f ns mean, %lu ns max over %lu frames\n",
+            ( double ) stats.decode.total / stats.decode.count,
+            ( unsigned long ) stats.decode.max, ( unsigned long ) stats.decode.count );
+    }
+
+capture_unmap( &reader );
+
+return 0;
+
+} /* main() */
@@ -0,0 +1,1005 @@
+/*********************************************************************
+*
+*   NAME:
+*       loop_test.c
+*
+*   DESCRIPTION:
+*       checks of the message path and service ports on the
+*       in-memory loopback transport. each case prints ok or FAIL
+*       with the condition that did not hold, the exit code is
+*       the number of failures
+*
+*           loop_test
+*
+*       see bench/Makefile
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "messageAPI.h"
+#include "msg_transport.h"
+#include "msg_frag.h"
+#include "msg_arq.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define RELAY_MODULE        ( 5 )       /* address of ctx_r         */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+const location current_location = RPI_MODULE;
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static loopback_port self_port;         /* default context radio    */
+
+static loopback_port port_a;            /* radio of ctx_a           */
+
+static loopback_port port_b;            /* radio of ctx_b           */
+
+static loopback_port port_r;            /* radio of ctx_r           */
+
+static loopback_port port_x;            /* hand fed frames out      */
+
+static message_ctx ctx_a;               /* RPI_MODULE on port_a     */
+
+static message_ctx ctx_b;               /* module b on port_b       */
+
+static message_ctx ctx_r;               /* relay on port_r          */
+
+static frag_ctx frag_a;                 /* fragmentation on ctx_a   */
+
+static frag_ctx frag_b;                 /* fragmentation on ctx_b   */
+
+static arq_ctx arq_a;                   /* reliable delivery, ctx_a */
+
+static arq_ctx arq_b;                   /* reliable delivery, ctx_b */
+
+static uint32_t received_size;          /* size of last delivery    */
+
+static uint32_t received_count;         /* deliveries taken         */
+
+static uint8_t received[ FRAG_MAX_MESSAGE_SIZE ];
+                                        /* last delivery            */
+
+static int failures;                    /* checks that did not hold */
+
+static bool case_ok;                    /* current case passing     */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define expect( condition )                                         \
+    do                                                              \
+        {                                                           \
+        if( ! ( condition ) )                                       \
+            {                                                       \
+            printf( "    line %d: %s\n", __LINE__, #condition );    \
+            case_ok = false;                                        \
+            }                                                       \
+        } while( 0 )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       start_case / end_case
+*
+*   DESCRIPTION:
+*       bracket one case and print its result
+*
+*********************************************************************/
+static void start_case
+    (
+    void
+    )
+{
+
+case_ok = true;
+
+} /* start_case() */
+
+static void end_case
+    (
+    const char *name
+    )
+{
+
+printf( "%-4s %s\n", case_ok ? "ok" : "FAIL", name );
+failures += case_ok ? 0 : 1;
+
+} /* end_case() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       reset_default
+*
+*   DESCRIPTION:
+*       default context on a loopback to itself, nothing queued
+*
+*********************************************************************/
+static void reset_default
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_config config;                     /* unused by loopback       */
+
+memset( &config, 0, sizeof( config ) );
+set_transport( loopback_transport( &self_port, NULL ) );
+( void ) init_message( config );
+set_secure( false, 0 );
+
+} /* reset_default() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       on_message / on_data
+*
+*   DESCRIPTION:
+*       keep what frag and arq deliver
+*
+*********************************************************************/
+static void on_message
+    (
+    location source,
+    const uint8_t data[],
+    uint32_t size,
+    void *arg
+    )
+{
+( void ) source;
+( void ) arg;
+
+memcpy( received, data, size );
+received_size = size;
+received_count++;
+
+} /* on_message() */
+
+static void on_data
+    (
+    location source,
+    const uint8_t data[],
+    uint8_t size,
+    void *arg
+    )
+{
+
+on_message( source, data, size, arg );
+
+} /* on_data() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       reset_pair
+*
+*   DESCRIPTION:
+*       ctx_a as RPI_MODULE and ctx_b as module b on loopback
+*       ports wired to each other
+*
+*********************************************************************/
+static void reset_pair
+    (
+    location b
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_config config;                     /* unused by loopback       */
+msg_transport transport_a;              /* port_a sending to port_b */
+msg_transport transport_b;              /* port_b sending to port_a */
+
+memset( &config, 0, sizeof( config ) );
+transport_a = loopback_transport( &port_a, &port_b );
+transport_b = loopback_transport( &port_b, &port_a );
+( void ) init_message_ctx( &ctx_a, RPI_MODULE, &transport_a, config );
+( void ) init_message_ctx( &ctx_b, b, &transport_b, config );
+( void ) register_module_ctx( &ctx_a, b );
+
+received_size   = 0;
+received_count  = 0;
+
+} /* reset_pair() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       pump
+*
+*   DESCRIPTION:
+*       read both contexts until neither has a frame waiting.
+*       service port frames read as no message, so the queues
+*       are watched instead of the result
+*
+*********************************************************************/
+static void pump
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+rx_message message;                     /* message read             */
+lora_errors errors;                     /* read result              */
+
+while( port_a.count > 0 || port_b.count > 0
+    || ctx_a.rx_offset < ctx_a.rx_size || ctx_b.rx_offset < ctx_b.rx_size )
+    {
+    ( void ) get_message_ctx( &ctx_a, &message, &errors );
+    ( void ) get_message_ctx( &ctx_b, &message, &errors );
+    }
+
+} /* pump() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_secure_no_key
+*
+*   DESCRIPTION:
+*       secure mode with no key for the destination: encode gives
+*       0, fragment and reliable sends must fail with nothing put
+*       on the air
+*
+*********************************************************************/
+static void test_secure_no_key
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ 3 * FRAG_DATA_SIZE ];     /* fragmented message       */
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* empty frame              */
+rx_message message;                     /* anything on the air      */
+lora_errors errors;                     /* send result              */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+memset( data, 0x5A, sizeof( data ) );
+reset_default();
+frag_init( NULL, NULL );
+arq_init( NULL, NULL );
+set_secure( true, 0 );
+
+/*----------------------------------------------------------
+Check sends
+----------------------------------------------------------*/
+expect( send_frame( frame, 0 ) == RX_ARRAY_SIZE_ERR );
+expect( frag_send( TIVA_MODULE, data, sizeof( data ) ) == RX_ARRAY_SIZE_ERR );
+expect( ! arq_send( TIVA_MODULE, data, 10, &errors ) );
+expect( errors == RX_ARRAY_SIZE_ERR );
+expect( arq_window_free( TIVA_MODULE ) == ARQ_WINDOW_SIZE );
+
+arq_poll( 60000 );
+expect( ! get_message( &message, &errors ) );
+
+end_case( "secure mode without a key fails frag_send and arq_send" );
+
+} /* test_secure_no_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_two_contexts
+*
+*   DESCRIPTION:
+*       fragmentation and reliable delivery between two contexts
+*       in one process, with the default context in use as well
+*
+*********************************************************************/
+static void test_two_contexts
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ 3 * FRAG_DATA_SIZE ];     /* fragmented message       */
+uint8_t big[ FRAG_MAX_MESSAGE_SIZE + 1 ];
+                                        /* too large to rebuild     */
+frag_stats stats;                       /* default frag counters    */
+lora_errors errors;                     /* send result              */
+uint32_t i;                             /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+for( i = 0; i < sizeof( data ); i++ )
+    {
+    data[ i ] = ( uint8_t ) i;
+    }
+
+reset_default();
+frag_init( NULL, NULL );
+reset_pair( TIVA_MODULE );
+frag_init_ctx( &frag_a, &ctx_a, on_message, NULL );
+frag_init_ctx( &frag_b, &ctx_b, on_message, NULL );
+arq_init_ctx( &arq_a, &ctx_a, on_data, NULL );
+arq_init_ctx( &arq_b, &ctx_b, on_data, NULL );
+
+/*----------------------------------------------------------
+Fragments from ctx_a reach ctx_b only
+----------------------------------------------------------*/
+expect( frag_send_ctx( &frag_a, TIVA_MODULE, data, sizeof( data ) ) == RX_NO_ERROR );
+pump();
+expect( received_count == 1 );
+expect( received_size == sizeof( data ) && memcmp( received, data, sizeof( data ) ) == 0 );
+
+frag_get_stats( &stats );
+expect( stats.completed == 0 );
+
+memset( big, 0, sizeof( big ) );
+expect( frag_send_ctx( &frag_a, TIVA_MODULE, big, sizeof( big ) ) == RX_ARRAY_SIZE_ERR );
+expect( port_b.count == 0 );
+
+/*----------------------------------------------------------
+Reliable data the other way, acked back on ctx_b
+----------------------------------------------------------*/
+expect( arq_send_ctx( &arq_b, RPI_MODULE, data, 20, &errors ) && errors == RX_NO_ERROR );
+pump();
+arq_poll_ctx( &arq_a, 1000 );
+pump();
+expect( received_count == 2 && received_size == 20 );
+expect( arq_window_free_ctx( &arq_b, RPI_MODULE ) == ARQ_WINDOW_SIZE );
+
+end_case( "frag and arq on two contexts" );
+
+} /* test_two_contexts() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_arq_restart
+*
+*   DESCRIPTION:
+*       reliable delivery carries on when the sender restarts with
+*       frames unacked, and again when the receiver restarts
+*
+*********************************************************************/
+static void test_arq_restart
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ ARQ_DATA_SIZE ];          /* reliable frame           */
+arq_stats stats;                        /* receiver counters        */
+lora_errors errors;                     /* send result              */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+memset( data, 0x3C, sizeof( data ) );
+reset_pair( TIVA_MODULE );
+arq_init_ctx( &arq_a, &ctx_a, on_data, NULL );
+arq_init_ctx( &arq_b, &ctx_b, on_data, NULL );
+
+/*----------------------------------------------------------
+Three frames in, ack still delayed
+----------------------------------------------------------*/
+for( i = 0; i < 3; i++ )
+    {
+    expect( arq_send_ctx( &arq_b, RPI_MODULE, data, 10, &errors ) );
+    }
+pump();
+expect( received_count == 3 );
+expect( arq_window_free_ctx( &arq_b, RPI_MODULE ) == ARQ_WINDOW_SIZE - 3 );
+
+/*----------------------------------------------------------
+Sender restarts and starts over at seq 0, which must not
+read as a duplicate of the first session
+----------------------------------------------------------*/
+arq_init_ctx( &arq_b, &ctx_b, on_data, NULL );
+arq_seed_ctx( &arq_b, 2 );
+for( i = 0; i < 3; i++ )
+    {
+    expect( arq_send_ctx( &arq_b, RPI_MODULE, data, 12, &errors ) );
+    }
+pump();
+expect( received_count == 6 && received_size == 12 );
+
+arq_poll_ctx( &arq_a, 1000 );
+pump();
+expect( arq_window_free_ctx( &arq_b, RPI_MODULE ) == ARQ_WINDOW_SIZE );
+
+arq_get_stats_ctx( &arq_a, &stats );
+expect( stats.resets == 1 && stats.duplicates == 0 );
+
+/*----------------------------------------------------------
+Receiver restarts, the next frame starts its window
+----------------------------------------------------------*/
+arq_init_ctx( &arq_a, &ctx_a, on_data, NULL );
+expect( arq_send_ctx( &arq_b, RPI_MODULE, data, 14, &errors ) );
+pump();
+expect( received_count == 7 && received_size == 14 );
+
+arq_poll_ctx( &arq_a, 2000 );
+pump();
+expect( arq_window_free_ctx( &arq_b, RPI_MODULE ) == ARQ_WINDOW_SIZE );
+
+end_case( "arq carries on after either side restarts" );
+
+} /* test_arq_restart() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_arq_address
+*
+*   DESCRIPTION:
+*       reliable delivery with a module registered at run time,
+*       above the sys_def.h modules
+*
+*********************************************************************/
+static void test_arq_address
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t data[ 4 ];                      /* reliable frame           */
+lora_errors errors;                     /* send result              */
+location far;                           /* run time module          */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+memset( data, 0x11, sizeof( data ) );
+far = MSG_MAX_MODULES - 1;
+reset_pair( far );
+arq_init_ctx( &arq_a, &ctx_a, on_data, NULL );
+arq_init_ctx( &arq_b, &ctx_b, on_data, NULL );
+
+expect( arq_send_ctx( &arq_a, far, data, sizeof( data ), &errors ) );
+expect( arq_send_ctx( &arq_b, RPI_MODULE, data, sizeof( data ), &errors ) );
+pump();
+arq_poll_ctx( &arq_a, 1000 );
+arq_poll_ctx( &arq_b, 1000 );
+pump();
+expect( received_count == 2 );
+expect( arq_window_free_ctx( &arq_a, far ) == ARQ_WINDOW_SIZE );
+expect( arq_window_free_ctx( &arq_b, RPI_MODULE ) == ARQ_WINDOW_SIZE );
+
+end_case( "arq to a module registered at run time" );
+
+} /* test_arq_address() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_arq_raw
+*
+*   DESCRIPTION:
+*       ARQ data frame from ctx_b to ctx_a with size bytes of data
+*       after the header, built by hand so it can be too large
+*
+*********************************************************************/
+static void send_arq_raw
+    (
+    uint8_t seq,
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t payload[ MAX_LORA_MSG_SIZE ];   /* arq header and data      */
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* encoded frame            */
+msg_header msg;                         /* port header              */
+uint8_t frame_size;                     /* size of frame[]          */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( &msg, 0, sizeof( msg ) );
+memset( payload, 0x41, sizeof( payload ) );
+msg.destination = RPI_MODULE;
+msg.port        = MSG_PORT_ARQ;
+payload[ 0 ]    = 0;                    /* data frame               */
+payload[ 1 ]    = seq;
+payload[ 2 ]    = 0;                    /* sender base              */
+payload[ 3 ]    = 1;                    /* session                  */
+
+frame_size = encode_message_header_ctx( &ctx_b, &msg, payload, ARQ_HEADER_SIZE + size, frame );
+expect( frame_size != 0 );
+expect( send_frame_ctx( &ctx_b, frame, frame_size ) == RX_NO_ERROR );
+
+} /* send_arq_raw() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_arq_oversize
+*
+*   DESCRIPTION:
+*       an ARQ data frame with more data than a window slot holds
+*       is counted invalid and not delivered, a full one is
+*
+*********************************************************************/
+static void test_arq_oversize
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_stats stats;                        /* receiver counters        */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+reset_pair( TIVA_MODULE );
+arq_init_ctx( &arq_a, &ctx_a, on_data, NULL );
+
+send_arq_raw( 0, ARQ_DATA_SIZE + 1 );
+pump();
+arq_get_stats_ctx( &arq_a, &stats );
+expect( received_count == 0 );
+expect( stats.invalid == 1 );
+
+send_arq_raw( 0, ARQ_DATA_SIZE );
+pump();
+expect( received_count == 1 && received_size == ARQ_DATA_SIZE );
+
+end_case( "arq frame larger than a slot is invalid" );
+
+} /* test_arq_oversize() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       take_messages
+*
+*   DESCRIPTION:
+*       read every frame waiting on ctx_a
+*
+*   RETURN:
+*       messages read without error
+*
+*********************************************************************/
+static uint32_t take_messages
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+rx_message message;                     /* message read             */
+lora_errors errors;                     /* read result              */
+uint32_t count;                         /* messages read            */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+count = 0;
+
+while( port_a.count > 0 || ctx_a.rx_offset < ctx_a.rx_size )
+    {
+    if( get_message_ctx( &ctx_a, &message, &errors ) && errors == RX_NO_ERROR )
+        {
+        count++;
+        }
+    }
+
+return count;
+
+} /* take_messages() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_sequence_restart
+*
+*   DESCRIPTION:
+*       a sender that restarts after fewer frames than the
+*       duplicate window is not filtered, a real copy still is
+*
+*********************************************************************/
+static void test_sequence_restart
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+tx_message message;                     /* message to send          */
+msg_header msg;                         /* header of copied frame   */
+msg_filter_stats stats;                 /* ctx_a filter counters    */
+lora_config config;                     /* unused by loopback       */
+msg_transport transport;                /* port_b sending to port_a */
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* frame sent twice         */
+uint8_t frame_size;                     /* size of frame[]          */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+memset( &message, 0, sizeof( message ) );
+memset( &msg, 0, sizeof( msg ) );
+memset( &config, 0, sizeof( config ) );
+message.destination = RPI_MODULE;
+message.size        = 4;
+msg.destination     = RPI_MODULE;
+reset_pair( TIVA_MODULE );
+
+for( i = 0; i < 5; i++ )
+    {
+    expect( send_message_ctx( &ctx_b, message ) == RX_NO_ERROR );
+    }
+expect( take_messages() == 5 );
+
+/*----------------------------------------------------------
+ctx_b restarts, its first frame arrives twice
+----------------------------------------------------------*/
+transport = loopback_transport( &port_b, &port_a );
+( void ) init_message_ctx( &ctx_b, TIVA_MODULE, &transport, config );
+
+frame_size = encode_message_header_ctx( &ctx_b, &msg, message.message, message.size, frame );
+expect( frame_size != 0 );
+expect( send_frame_ctx( &ctx_b, frame, frame_size ) == RX_NO_ERROR );
+expect( send_frame_ctx( &ctx_b, frame, frame_size ) == RX_NO_ERROR );
+for( i = 0; i < 4; i++ )
+    {
+    expect( send_message_ctx( &ctx_b, message ) == RX_NO_ERROR );
+    }
+expect( take_messages() == 5 );
+
+get_filter_stats_ctx( &ctx_a, &stats );
+expect( stats.frames_duplicate == 1 );
+
+end_case( "sequence window starts over when a sender restarts" );
+
+} /* test_sequence_restart() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       read_a
+*
+*   DESCRIPTION:
+*       read one message on ctx_a
+*
+*   RETURN:
+*       read result
+*
+*********************************************************************/
+static lora_errors read_a
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+rx_message message;                     /* message read             */
+lora_errors errors;                     /* read result              */
+
+errors = RX_TIMEOUT;
+( void ) get_message_ctx( &ctx_a, &message, &errors );
+
+return errors;
+
+} /* read_a() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       seal_b
+*
+*   DESCRIPTION:
+*       encode a sealed app frame from ctx_b to RPI_MODULE
+*
+*   RETURN:
+*       frame size, 0 if it could not be sealed
+*
+*********************************************************************/
+static uint8_t seal_b
+    (
+    uint8_t frame[]
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_header msg;                         /* app header               */
+uint8_t data[ 6 ];                      /* message                  */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( &msg, 0, sizeof( msg ) );
+memset( data, 0x77, sizeof( data ) );
+msg.destination = RPI_MODULE;
+
+return encode_message_header_ctx( &ctx_b, &msg, data, sizeof( data ), frame );
+
+} /* seal_b() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_secure_frames
+*
+*   DESCRIPTION:
+*       sealed frames open with the shared key. a changed byte
+*       fails the tag, a frame sent again fails the counter check
+*       and a plain frame is refused
+*
+*********************************************************************/
+static void test_secure_frames
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+static const uint8_t key[ MSG_KEY_SIZE ] =
+    { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+      0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* sealed frame             */
+uint8_t frame_size;                     /* size of frame[]          */
+msg_secure_stats stats;                 /* ctx_a secure counters    */
+msg_filter_stats filter;                /* ctx_a filter counters    */
+tx_message message;                     /* plain message            */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+memset( &message, 0, sizeof( message ) );
+message.destination = RPI_MODULE;
+message.size        = 2;
+reset_pair( TIVA_MODULE );
+expect( set_secure_key_ctx( &ctx_a, TIVA_MODULE, key ) );
+expect( set_secure_key_ctx( &ctx_b, RPI_MODULE, key ) );
+set_secure_ctx( &ctx_a, true, 0 );
+set_secure_ctx( &ctx_b, true, 0 );
+
+/*----------------------------------------------------------
+Good frame, then the same frame again
+----------------------------------------------------------*/
+frame_size = seal_b( frame );
+expect( frame_size != 0 );
+expect( send_frame_ctx( &ctx_b, frame, frame_size ) == RX_NO_ERROR );
+expect( send_frame_ctx( &ctx_b, frame, frame_size ) == RX_NO_ERROR );
+expect( read_a() == RX_NO_ERROR );
+expect( read_a() == RX_KEY_ERR );
+
+/*----------------------------------------------------------
+One data bit changed, the crc byte is the tag so only the
+tag check can catch it
+----------------------------------------------------------*/
+frame_size = seal_b( frame );
+frame[ frame_size - 3 ] ^= 0x01;
+expect( send_frame_ctx( &ctx_b, frame, frame_size ) == RX_NO_ERROR );
+expect( read_a() == RX_CRC_ERROR );
+
+/*----------------------------------------------------------
+Plain frame to a secure receiver
+----------------------------------------------------------*/
+set_secure_ctx( &ctx_b, false, 0 );
+expect( send_message_ctx( &ctx_b, message ) == RX_NO_ERROR );
+expect( read_a() != RX_NO_ERROR );
+
+get_secure_stats_ctx( &ctx_a, &stats );
+expect( stats.decrypted == 1 );
+expect( stats.replayed == 1 );
+expect( stats.auth_failed == 1 );
+expect( stats.plain_rejected == 1 );
+
+get_filter_stats_ctx( &ctx_a, &filter );
+expect( filter.frames_accepted == 1 );
+
+end_case( "secure frames reject bad tags, replays and plain frames" );
+
+} /* test_secure_frames() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_secure_relay
+*
+*   DESCRIPTION:
+*       a relay with no keys forwards a sealed frame unopened and
+*       the destination opens it
+*
+*********************************************************************/
+static void test_secure_relay
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+static const uint8_t key[ MSG_KEY_SIZE ] =
+    { 0x0F, 0x1E, 0x2D, 0x3C, 0x4B, 0x5A, 0x69, 0x78,
+      0x87, 0x96, 0xA5, 0xB4, 0xC3, 0xD2, 0xE1, 0xF0 };
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* sealed routed frame      */
+uint8_t frame_size;                     /* size of frame[]          */
+lora_config config;                     /* unused by loopback       */
+msg_transport relay;                    /* port_r sending to port_a */
+msg_transport feed;                     /* port_x sending to port_r */
+msg_secure_stats stats;                 /* secure counters          */
+msg_relay_stats relay_stats;            /* relay counters           */
+rx_message message;                     /* relay read               */
+lora_errors errors;                     /* relay read result        */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+memset( &config, 0, sizeof( config ) );
+reset_pair( TIVA_MODULE );
+relay   = loopback_transport( &port_r, &port_a );
+feed    = loopback_transport( &port_x, &port_r );
+( void ) init_message_ctx( &ctx_r, RELAY_MODULE, &relay, config );
+( void ) register_module_ctx( &ctx_b, RELAY_MODULE );
+set_relay_ctx( &ctx_r, true, NULL );
+
+expect( set_secure_key_ctx( &ctx_a, TIVA_MODULE, key ) );
+expect( set_secure_key_ctx( &ctx_b, RPI_MODULE, key ) );
+set_secure_ctx( &ctx_a, true, 0 );
+set_secure_ctx( &ctx_b, true, 0 );
+expect( set_route_ctx( &ctx_b, RPI_MODULE, RELAY_MODULE ) );
+
+/*----------------------------------------------------------
+ctx_b's frame goes to the relay rather than to ctx_a
+----------------------------------------------------------*/
+frame_size = seal_b( frame );
+expect( frame_size != 0 );
+expect( feed.send( feed.port, frame, frame_size ) == RX_NO_ERROR );
+while( port_r.count > 0 || ctx_r.rx_offset < ctx_r.rx_size )
+    {
+    ( void ) get_message_ctx( &ctx_r, &message, &errors );
+    }
+
+get_relay_stats_ctx( &ctx_r, &relay_stats );
+expect( relay_stats.forwarded == 1 );
+get_secure_stats_ctx( &ctx_r, &stats );
+expect( stats.decrypted == 0 && stats.auth_failed == 0 );
+
+expect( read_a() == RX_NO_ERROR );
+get_secure_stats_ctx( &ctx_a, &stats );
+expect( stats.decrypted == 1 );
+
+end_case( "relay forwards a sealed frame without opening it" );
+
+} /* test_secure_relay() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       test_grace_key
+*
+*   DESCRIPTION:
+*       during a key change frames under the old key are taken
+*       only while it is the grace key
+*
+*********************************************************************/
+static void test_grace_key
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+tx_message message;                     /* plain message            */
+msg_filter_stats stats;                 /* ctx_a filter counters    */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_case();
+memset( &message, 0, sizeof( message ) );
+message.destination = RPI_MODULE;
+message.size        = 3;
+reset_pair( TIVA_MODULE );
+update_key_ctx( &ctx_a, 0x21 );
+update_key_ctx( &ctx_b, 0x21 );
+
+/*----------------------------------------------------------
+ctx_a moves to the new key, ctx_b has not yet
+----------------------------------------------------------*/
+rotate_key_ctx( &ctx_a, 0x42 );
+set_grace_key_ctx( &ctx_a, true, 0x21 );
+expect( send_message_ctx( &ctx_b, message ) == RX_NO_ERROR );
+expect( read_a() == RX_NO_ERROR );
+
+set_grace_key_ctx( &ctx_a, false, 0 );
+expect( send_message_ctx( &ctx_b, message ) == RX_NO_ERROR );
+expect( read_a() == RX_KEY_ERR );
+
+update_key_ctx( &ctx_b, 0x42 );
+expect( send_message_ctx( &ctx_b, message ) == RX_NO_ERROR );
+expect( read_a() == RX_NO_ERROR );
+
+get_filter_stats_ctx( &ctx_a, &stats );
+expect( stats.frames_grace_key == 1 );
+
+end_case( "grace key taken during a key change and not after" );
+
+} /* test_grace_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       main
+*
+*   DESCRIPTION:
+*       run every case
+*
+*   RETURN:
+*       number of failed cases
+*
+*********************************************************************/
+int main
+    (
+    void
+    )
+{
+
+failures = 0;
+
+test_secure_no_key();
+test_two_contexts();
+test_arq_restart();
+test_arq_address();
+test_arq_oversize();
+test_sequence_restart();
+test_secure_frames();
+test_secure_relay();
+test_grace_key();
+
+return failures;
+
+} /* main() */
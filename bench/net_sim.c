@@ -0,0 +1,1173 @@
+/*********************************************************************
+*
+*   NAME:
+*       net_sim.c
+*
+*   DESCRIPTION:
+*       discrete event network simulator. every node is a
+*       message_ctx on a transport that puts its frames on one
+*       shared simulated channel, so traffic runs through the real
+*       encode, filter, crc and duplicate code. time only moves
+*       from event to event, and all randomness comes from one
+*       seeded generator, so a run is the same on every host.
+*
+*       channel model:
+*           airtime     sched_airtime_us() for the radio settings
+*           path loss   log distance, 31.2 dB at 1 m (868 MHz free
+*                       space), exponent -x, fixed shadowing per
+*                       link with sigma -g
+*           range       frames below the SX127x sensitivity for the
+*                       spreading factor and bandwidth are not heard
+*           collisions  a frame survives an overlapping frame only
+*                       if it is CAPTURE_DB stronger at the receiver
+*           half duplex a node hears nothing while it transmits
+*           errors      a heard frame is corrupted with chance -e.
+*                       with the payload crc on (-c 1) the radio
+*                       reports RX_CRC_ERROR, with it off the bit
+*                       error reaches messageAPI's own crc
+*
+*       node 0 is the gateway at the centre, the rest are spread
+*       evenly over a disc. each node sends data frames at random
+*       (poisson) times to the gateway, or with -p peer to a random
+*       node, and queues frames while it is transmitting (pure
+*       aloha). one JSON line a node count reports goodput, packet
+*       delivery, latency percentiles and losses by cause
+*
+*           net_sim [-n 10,50,200] [-t hours] [-i interval s]
+*                   [-b data bytes] [-f sf] [-w bandwidth hz]
+*                   [-r radius m] [-x exponent] [-g sigma dB]
+*                   [-e per] [-c 0|1] [-p star|peer] [-s seed]
+*
+*       see bench/Makefile
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE                     /* clock_gettime under
+                                           -std=c11                 */
+
+#include "messageAPI.h"
+#include "msg_sched.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define SIM_MAX_NODES       ( MSG_MAX_MODULES ) /* node addresses   */
+
+#define SIM_MAX_AIR         ( 4096 )    /* frames on air or recent  */
+
+#define SIM_MAX_EVENTS      ( SIM_MAX_NODES + SIM_MAX_AIR )
+                                        /* events pending           */
+
+#define SIM_QUEUE_SIZE      ( 8 )       /* frames held per node     */
+
+#define SIM_MAX_COUNTS      ( 16 )      /* node counts in one sweep */
+
+#define SIM_PI              ( 3.14159265358979323846 )
+                                        /* M_PI is not in C11       */
+
+#define STAMP_SIZE          ( 8 )       /* send time in the data    */
+
+#define TX_POWER_DBM        ( 14.0 )    /* EU868 ERP limit          */
+
+#define PATH_LOSS_1M_DB     ( 31.2 )    /* free space at 1 m        */
+
+#define CAPTURE_DB          ( 6.0 )     /* margin to survive overlap */
+
+#define US_PER_HOUR         ( 3600000000ull )
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef enum                            /* event kinds              */
+    {
+    EVENT_GENERATE,                     /* node has data to send    */
+    EVENT_TX_END                        /* frame leaves the air     */
+    } event_type;
+
+typedef struct                          /* pending event            */
+    {
+    uint64_t time_us;                   /* when                     */
+    uint64_t order;                     /* ties in schedule order   */
+    event_type type;                    /* what                     */
+    uint16_t index;                     /* node or air slot         */
+    } sim_event;
+
+typedef struct                          /* frame on the air         */
+    {
+    uint16_t sender;                    /* node sending             */
+    uint64_t start_us;                  /* first symbol             */
+    uint64_t end_us;                    /* last symbol              */
+    uint8_t size;                       /* size of data[]           */
+    uint8_t data[ MAX_LORA_MSG_SIZE ];  /* raw frame                */
+    } sim_tx;
+
+typedef struct                          /* frame held by a node     */
+    {
+    uint8_t size;                       /* size of data[]           */
+    uint8_t data[ MAX_LORA_MSG_SIZE ];  /* raw frame                */
+    } sim_frame;
+
+typedef struct                          /* one node's radio         */
+    {
+    uint16_t node;                      /* node index and address   */
+    bool busy;                          /* transmitting             */
+    uint8_t head;                       /* oldest held frame        */
+    uint8_t count;                      /* frames held              */
+    sim_frame queue[ SIM_QUEUE_SIZE ];  /* waiting for the air      */
+    bool rx_ready;                      /* rx holds a frame         */
+    lora_errors rx_errors;              /* radio result for rx      */
+    sim_frame rx;                       /* frame heard              */
+    } sim_port;
+
+typedef struct                          /* simulation settings      */
+    {
+    double hours;                       /* traffic generated for    */
+    double interval_s;                  /* mean time between sends  */
+    uint8_t data_size;                  /* data bytes per message   */
+    sched_radio radio;                  /* for airtime              */
+    double radius_m;                    /* disc the nodes are on    */
+    double exponent;                    /* path loss exponent       */
+    double sigma_db;                    /* shadowing spread         */
+    double per;                         /* heard frame corrupted    */
+    bool peer;                          /* random destinations      */
+    uint64_t seed;                      /* generator seed           */
+    } sim_config;
+
+typedef struct                          /* losses and deliveries    */
+    {
+    uint64_t generated;                 /* messages made            */
+    uint64_t queue_drops;               /* node queue full          */
+    uint64_t sent;                      /* frames put on the air    */
+    uint64_t airtime_us;                /* total time on the air    */
+    uint64_t delivered;                 /* taken by destination     */
+    uint64_t bytes;                     /* data bytes delivered     */
+    uint64_t range;                     /* destination too far      */
+    uint64_t collision;                 /* lost to an overlap       */
+    uint64_t half_duplex;               /* destination was sending  */
+    uint64_t corrupted;                 /* hit by -e                */
+    uint64_t rx_errors[ MSG_ERROR_COUNT ];  /* decode results by
+                                           lora_errors code, summed
+                                           over all nodes           */
+    } sim_stats;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+const location current_location = RPI_MODULE;
+
+static const char * const error_names[ MSG_ERROR_COUNT ] =
+    { "ok", "timeout", "crc", "key", "double", "sizing",
+      "header", "array_size", "init" };
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static sim_config config;               /* settings                 */
+
+static uint16_t node_count;             /* nodes in this run        */
+
+static message_ctx *contexts;           /* one per node             */
+
+static sim_port ports[ SIM_MAX_NODES ]; /* one per node             */
+
+static float rssi[ SIM_MAX_NODES ][ SIM_MAX_NODES ];
+                                        /* dBm from row at column   */
+
+static double sensitivity_dbm;          /* weakest frame heard      */
+
+static uint64_t max_airtime_us;         /* longest frame            */
+
+static uint64_t now_us;                 /* simulated time           */
+
+static uint64_t end_us;                 /* no traffic made after    */
+
+static uint64_t random_state;           /* xorshift64* state        */
+
+static sim_event events[ SIM_MAX_EVENTS ];  /* binary heap          */
+
+static uint32_t event_count;            /* entries in events[]      */
+
+static uint64_t event_order;            /* next tie break           */
+
+static sim_tx air[ SIM_MAX_AIR ];       /* air slots                */
+
+static uint16_t air_free[ SIM_MAX_AIR ];/* unused slots             */
+
+static uint16_t air_free_count;         /* entries in air_free[]    */
+
+static uint16_t air_list[ SIM_MAX_AIR ];/* slots in use             */
+
+static uint16_t air_count;              /* entries in air_list[]    */
+
+static uint32_t *latencies;             /* delivery times in us     */
+
+static size_t latency_count;            /* entries in latencies[]   */
+
+static size_t latency_size;             /* room in latencies[]      */
+
+static sim_stats stats;                 /* this run                 */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define event_before( a, b ) \
+    ( ( a ).time_us < ( b ).time_us || ( ( a ).time_us == ( b ).time_us && ( a ).order < ( b ).order ) )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       random_next
+*
+*   DESCRIPTION:
+*       next xorshift64* value
+*
+*********************************************************************/
+static uint64_t random_next
+    (
+    void
+    )
+{
+
+random_state ^= random_state >> 12;
+random_state ^= random_state << 25;
+random_state ^= random_state >> 27;
+
+return random_state * 0x2545F4914F6CDD1Dull;
+
+} /* random_next() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       random_uniform
+*
+*   DESCRIPTION:
+*       uniform in [0, 1)
+*
+*********************************************************************/
+static double random_uniform
+    (
+    void
+    )
+{
+
+return ( double )( random_next() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+
+} /* random_uniform() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       random_gaussian
+*
+*   DESCRIPTION:
+*       normal with mean 0 and spread 1 (Box-Muller)
+*
+*********************************************************************/
+static double random_gaussian
+    (
+    void
+    )
+{
+
+return sqrt( -2.0 * log( 1.0 - random_uniform() ) ) * cos( 2.0 * SIM_PI * random_uniform() );
+
+} /* random_gaussian() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       schedule
+*
+*   DESCRIPTION:
+*       add an event to the heap
+*
+*********************************************************************/
+static void schedule
+    (
+    uint64_t time_us,
+    event_type type,
+    uint16_t index
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+sim_event event;
+uint32_t child;
+uint32_t parent;
+
+event.time_us   = time_us;
+event.order     = event_order++;
+event.type      = type;
+event.index     = index;
+
+child = event_count++;
+while( child > 0 )
+    {
+    parent = ( child - 1 ) / 2;
+    if( ! event_before( event, events[ parent ] ) )
+        {
+        break;
+        }
+    events[ child ] = events[ parent ];
+    child = parent;
+    }
+events[ child ] = event;
+
+} /* schedule() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       next_event
+*
+*   DESCRIPTION:
+*       take the earliest event off the heap
+*
+*   RETURN:
+*       T/F event taken y/n
+*
+*********************************************************************/
+static bool next_event
+    (
+    sim_event *event
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+sim_event last;
+uint32_t parent;
+uint32_t child;
+
+if( event_count == 0 )
+    {
+    return false;
+    }
+
+*event  = events[ 0 ];
+last    = events[ --event_count ];
+parent  = 0;
+
+while( ( child = 2 * parent + 1 ) < event_count )
+    {
+    if( child + 1 < event_count && event_before( events[ child + 1 ], events[ child ] ) )
+        {
+        child++;
+        }
+    if( ! event_before( events[ child ], last ) )
+        {
+        break;
+        }
+    events[ parent ] = events[ child ];
+    parent = child;
+    }
+events[ parent ] = last;
+
+return true;
+
+} /* next_event() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       purge_air
+*
+*   DESCRIPTION:
+*       free frames that ended before any frame still on the air
+*       could have started
+*
+*********************************************************************/
+static void purge_air
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint16_t i;
+
+i = 0;
+while( i < air_count )
+    {
+    if( air[ air_list[ i ] ].end_us + max_airtime_us < now_us )
+        {
+        air_free[ air_free_count++ ] = air_list[ i ];
+        air_list[ i ] = air_list[ --air_count ];
+        }
+    else
+        {
+        i++;
+        }
+    }
+
+} /* purge_air() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       start_tx
+*
+*   DESCRIPTION:
+*       put a node's oldest held frame on the air
+*
+*********************************************************************/
+static void start_tx
+    (
+    sim_port *port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+sim_frame *frame;
+sim_tx *tx;
+uint16_t slot;
+
+if( air_free_count == 0 )
+    {
+    purge_air();
+    }
+if( air_free_count == 0 )
+    {
+    fprintf( stderr, "more than %u frames on the air, raise SIM_MAX_AIR\n", SIM_MAX_AIR );
+    exit( 1 );
+    }
+
+frame       = &port->queue[ port->head ];
+slot        = air_free[ --air_free_count ];
+tx          = &air[ slot ];
+tx->sender  = port->node;
+tx->start_us= now_us;
+tx->end_us  = now_us + sched_airtime_us( &config.radio, frame->size );
+tx->size    = frame->size;
+memcpy( tx->data, frame->data, frame->size );
+
+air_list[ air_count++ ] = slot;
+port->head  = ( uint8_t )( ( port->head + 1 ) % SIM_QUEUE_SIZE );
+port->count--;
+port->busy  = true;
+
+stats.sent++;
+stats.airtime_us += tx->end_us - tx->start_us;
+schedule( tx->end_us, EVENT_TX_END, slot );
+
+} /* start_tx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sim_init / sim_send / sim_get / sim_rx_mode
+*
+*   DESCRIPTION:
+*       transport of one node on the simulated channel
+*
+*********************************************************************/
+static lora_errors sim_init
+    (
+    void *port,
+    lora_config config_data
+    )
+{
+( void ) port;
+( void ) config_data;
+
+return RX_NO_ERROR;
+
+} /* sim_init() */
+
+static lora_errors sim_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+sim_port *sim;
+sim_frame *frame;
+
+sim = ( sim_port * ) port;
+if( sim->count >= SIM_QUEUE_SIZE )
+    {
+    stats.queue_drops++;
+    return RX_NO_ERROR;
+    }
+
+frame = &sim->queue[ ( sim->head + sim->count ) % SIM_QUEUE_SIZE ];
+frame->size = size;
+memcpy( frame->data, message_array, size );
+sim->count++;
+
+if( ! sim->busy )
+    {
+    start_tx( sim );
+    }
+
+return RX_NO_ERROR;
+
+} /* sim_send() */
+
+static bool sim_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+sim_port *sim;
+
+sim = ( sim_port * ) port;
+if( ! sim->rx_ready || sim->rx.size > max_size )
+    {
+    return false;
+    }
+
+memcpy( message_array, sim->rx.data, sim->rx.size );
+*size           = sim->rx.size;
+*errors         = sim->rx_errors;
+sim->rx_ready   = false;
+
+return true;
+
+} /* sim_get() */
+
+static bool sim_rx_mode
+    (
+    void *port
+    )
+{
+( void ) port;
+
+return true;
+
+} /* sim_rx_mode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       receive
+*
+*   DESCRIPTION:
+*       hand a heard frame to a node and take what it decodes
+*
+*********************************************************************/
+static void receive
+    (
+    uint16_t node,
+    const sim_tx *tx,
+    bool corrupt
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+sim_port *port;
+rx_message message;
+lora_errors errors;
+uint64_t sent_us;
+uint8_t i;
+
+port = &ports[ node ];
+port->rx.size   = tx->size;
+port->rx_errors = RX_NO_ERROR;
+memcpy( port->rx.data, tx->data, tx->size );
+if( corrupt && config.radio.crc_on )
+    {
+    port->rx_errors = RX_CRC_ERROR;
+    }
+else if( corrupt )
+    {
+    port->rx.data[ random_next() % tx->size ] ^= ( uint8_t )( 1u << ( random_next() % 8 ) );
+    }
+port->rx_ready = true;
+
+while( get_message_ctx( &contexts[ node ], &message, &errors ) )
+    {
+    if( errors != RX_NO_ERROR || ! message.valid || message.size < STAMP_SIZE )
+        {
+        continue;
+        }
+
+    sent_us = 0;
+    for( i = 0; i < STAMP_SIZE; i++ )
+        {
+        sent_us |= ( uint64_t ) message.message[ i ] << ( 8 * i );
+        }
+
+    stats.delivered++;
+    stats.bytes += message.size;
+
+    /*----------------------------------------------------------
+    A bit error the crc8 missed can leave a stamp from the
+    future, such a frame gives no latency
+    ----------------------------------------------------------*/
+    if( sent_us > now_us )
+        {
+        continue;
+        }
+
+    if( latency_count == latency_size )
+        {
+        latency_size    = ( latency_size > 0 ) ? latency_size * 2 : 4096;
+        latencies       = realloc( latencies, latency_size * sizeof( *latencies ) );
+        if( latencies == NULL )
+            {
+            fprintf( stderr, "out of memory\n" );
+            exit( 1 );
+            }
+        }
+    latencies[ latency_count++ ] = ( uint32_t )( now_us - sent_us );
+    }
+
+} /* receive() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tx_end
+*
+*   DESCRIPTION:
+*       a frame leaves the air. every node that heard it clear of
+*       overlaps and its own transmissions decodes it, then the
+*       sender starts on its next held frame
+*
+*********************************************************************/
+static void tx_end
+    (
+    uint16_t slot
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+const sim_tx *tx;
+const sim_tx *other;
+uint16_t destination;
+uint16_t node;
+uint16_t i;
+bool lost;
+bool sending;
+
+tx          = &air[ slot ];
+destination = tx->data[ 0 ];
+
+for( node = 0; node < node_count; node++ )
+    {
+    if( node == tx->sender )
+        {
+        continue;
+        }
+
+    if( rssi[ tx->sender ][ node ] < sensitivity_dbm )
+        {
+        stats.range += ( node == destination );
+        continue;
+        }
+
+    /*----------------------------------------------------------
+    Any overlap the frame is not CAPTURE_DB above is fatal, as
+    is the receiver sending at any time during the frame
+    ----------------------------------------------------------*/
+    lost    = false;
+    sending = false;
+    for( i = 0; i < air_count && ! sending; i++ )
+        {
+        other = &air[ air_list[ i ] ];
+        if( other == tx || other->start_us >= tx->end_us || other->end_us <= tx->start_us )
+            {
+            continue;
+            }
+        if( other->sender == node )
+            {
+            sending = true;
+            }
+        else if( rssi[ other->sender ][ node ] + CAPTURE_DB > rssi[ tx->sender ][ node ] )
+            {
+            lost = true;
+            }
+        }
+
+    if( sending )
+        {
+        stats.half_duplex += ( node == destination );
+        continue;
+        }
+    if( lost )
+        {
+        stats.collision += ( node == destination );
+        continue;
+        }
+
+    if( random_uniform() < config.per )
+        {
+        stats.corrupted += ( node == destination );
+        receive( node, tx, true );
+        }
+    else
+        {
+        receive( node, tx, false );
+        }
+    }
+
+ports[ tx->sender ].busy = false;
+if( ports[ tx->sender ].count > 0 )
+    {
+    start_tx( &ports[ tx->sender ] );
+    }
+
+purge_air();
+
+} /* tx_end() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       generate
+*
+*   DESCRIPTION:
+*       a node sends one message stamped with the time, and picks
+*       its next send time
+*
+*********************************************************************/
+static void generate
+    (
+    uint16_t node
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+tx_message message;
+uint8_t i;
+
+memset( &message, 0, sizeof( message ) );
+message.size        = config.data_size;
+message.destination = 0;
+if( config.peer )
+    {
+    message.destination = ( location )( ( node + 1 + random_next() % ( node_count - 1 ) ) % node_count );
+    }
+
+for( i = 0; i < STAMP_SIZE; i++ )
+    {
+    message.message[ i ] = ( uint8_t )( now_us >> ( 8 * i ) );
+    }
+for( ; i < message.size; i++ )
+    {
+    message.message[ i ] = ( uint8_t ) random_next();
+    }
+
+stats.generated++;
+( void ) send_message_ctx( &contexts[ node ], message );
+
+schedule( now_us + ( uint64_t )( -log( 1.0 - random_uniform() ) * config.interval_s * 1e6 ),
+          EVENT_GENERATE, node );
+
+} /* generate() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       place_nodes
+*
+*   DESCRIPTION:
+*       spread the nodes over the disc and work out the received
+*       power of every link
+*
+*********************************************************************/
+static void place_nodes
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+double x[ SIM_MAX_NODES ];
+double y[ SIM_MAX_NODES ];
+double distance;
+double angle;
+double loss;
+uint16_t i;
+uint16_t j;
+
+x[ 0 ] = 0;
+y[ 0 ] = 0;
+for( i = 1; i < node_count; i++ )
+    {
+    distance    = config.radius_m * sqrt( random_uniform() );
+    angle       = 2.0 * SIM_PI * random_uniform();
+    x[ i ]      = distance * cos( angle );
+    y[ i ]      = distance * sin( angle );
+    }
+
+for( i = 0; i < node_count; i++ )
+    {
+    rssi[ i ][ i ] = ( float ) TX_POWER_DBM;
+    for( j = ( uint16_t )( i + 1 ); j < node_count; j++ )
+        {
+        distance = hypot( x[ i ] - x[ j ], y[ i ] - y[ j ] );
+        loss     = PATH_LOSS_1M_DB + 10.0 * config.exponent * log10( ( distance > 1.0 ) ? distance : 1.0 )
+                 + config.sigma_db * random_gaussian();
+        rssi[ i ][ j ] = ( float )( TX_POWER_DBM - loss );
+        rssi[ j ][ i ] = rssi[ i ][ j ];
+        }
+    }
+
+} /* place_nodes() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       compare_latency
+*
+*   DESCRIPTION:
+*       qsort order of latencies
+*
+*********************************************************************/
+static int compare_latency
+    (
+    const void *a,
+    const void *b
+    )
+{
+
+return ( *( const uint32_t * ) a > *( const uint32_t * ) b ) - ( *( const uint32_t * ) a < *( const uint32_t * ) b );
+
+} /* compare_latency() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       percentile_ms
+*
+*   DESCRIPTION:
+*       latency at fraction of the sorted latencies
+*
+*********************************************************************/
+static double percentile_ms
+    (
+    double fraction
+    )
+{
+
+if( latency_count == 0 )
+    {
+    return 0.0;
+    }
+
+return latencies[ ( size_t )( fraction * ( double )( latency_count - 1 ) ) ] / 1000.0;
+
+} /* percentile_ms() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       run
+*
+*   DESCRIPTION:
+*       simulate nodes for config.hours and print the result
+*
+*********************************************************************/
+static void run
+    (
+    uint16_t nodes
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+lora_config radio_config;
+msg_stats node_stats;
+sim_event event;
+struct timespec wall_start;
+struct timespec wall_end;
+uint16_t i;
+uint16_t j;
+uint8_t e;
+
+/*----------------------------------------------------------
+Reset state, same seed for every node count
+----------------------------------------------------------*/
+node_count      = nodes;
+random_state    = ( config.seed != 0 ) ? config.seed : 1;
+now_us          = 0;
+end_us          = ( uint64_t )( config.hours * US_PER_HOUR );
+event_count     = 0;
+event_order     = 0;
+air_count       = 0;
+air_free_count  = 0;
+latency_count   = 0;
+memset( &stats, 0, sizeof( stats ) );
+memset( ports, 0, sizeof( ports ) );
+memset( &radio_config, 0, sizeof( radio_config ) );
+for( i = 0; i < SIM_MAX_AIR; i++ )
+    {
+    air_free[ air_free_count++ ] = ( uint16_t )( SIM_MAX_AIR - 1 - i );
+    }
+
+clock_gettime( CLOCK_MONOTONIC, &wall_start );
+place_nodes();
+
+for( i = 0; i < node_count; i++ )
+    {
+    ports[ i ].node     = i;
+    transport.init      = sim_init;
+    transport.send      = sim_send;
+    transport.get       = sim_get;
+    transport.rx_mode   = sim_rx_mode;
+    transport.port      = &ports[ i ];
+    transport.wait_fd   = NULL;
+    ( void ) init_message_ctx( &contexts[ i ], ( location ) i, &transport, radio_config );
+    for( j = 0; j < node_count; j++ )
+        {
+        ( void ) register_module_ctx( &contexts[ i ], ( location ) j );
+        }
+    if( i > 0 || config.peer )
+        {
+        schedule( ( uint64_t )( random_uniform() * config.interval_s * 1e6 ), EVENT_GENERATE, i );
+        }
+    }
+
+/*----------------------------------------------------------
+Traffic stops at end_us, frames then on the air or held
+still finish
+----------------------------------------------------------*/
+while( next_event( &event ) )
+    {
+    now_us = event.time_us;
+    if( event.type == EVENT_TX_END )
+        {
+        tx_end( event.index );
+        }
+    else if( now_us < end_us )
+        {
+        generate( event.index );
+        }
+    }
+
+for( i = 0; i < node_count; i++ )
+    {
+    get_message_stats_ctx( &contexts[ i ], &node_stats );
+    for( e = 0; e < MSG_ERROR_COUNT; e++ )
+        {
+        stats.rx_errors[ e ] += node_stats.rx_errors[ e ];
+        }
+    }
+
+qsort( latencies, latency_count, sizeof( *latencies ), compare_latency );
+clock_gettime( CLOCK_MONOTONIC, &wall_end );
+
+printf( "{\"nodes\":%u,\"hours\":%g,\"generated\":%llu,\"sent\":%llu,\"delivered\":%llu,"
+        "\"pdr\":%.4f,\"goodput_bps\":%.1f,\"channel_load\":%.4f,"
+        "\"latency_ms\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f},"
+        "\"lost\":{\"range\":%llu,\"collision\":%llu,\"half_duplex\":%llu,\"corrupted\":%llu,\"queue_full\":%llu},"
+        "\"rx_errors\":{",
+        nodes, config.hours,
+        ( unsigned long long ) stats.generated, ( unsigned long long ) stats.sent,
+        ( unsigned long long ) stats.delivered,
+        stats.generated ? ( double ) stats.delivered / stats.generated : 0.0,
+        end_us ? stats.bytes * 8.0 * 1e6 / end_us : 0.0,
+        end_us ? ( double ) stats.airtime_us / end_us : 0.0,
+        percentile_ms( 0.50 ), percentile_ms( 0.90 ), percentile_ms( 0.99 ), percentile_ms( 1.0 ),
+        ( unsigned long long ) stats.range, ( unsigned long long ) stats.collision,
+        ( unsigned long long ) stats.half_duplex, ( unsigned long long ) stats.corrupted,
+        ( unsigned long long ) stats.queue_drops );
+for( e = RX_NO_ERROR + 1; e < MSG_ERROR_COUNT; e++ )
+    {
+    printf( "%s\"%s\":%llu", ( e > RX_NO_ERROR + 1 ) ? "," : "", error_names[ e ],
+            ( unsigned long long ) stats.rx_errors[ e ] );
+    }
+printf( "}}\n" );
+
+fprintf( stderr, "%u nodes: %g simulated hours in %.3f s\n", nodes, config.hours,
+         ( wall_end.tv_sec - wall_start.tv_sec ) + ( wall_end.tv_nsec - wall_start.tv_nsec ) / 1e9 );
+
+} /* run() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       main
+*
+*   DESCRIPTION:
+*       read the settings and run each node count
+*
+*   RETURN:
+*       0, 2 on bad usage
+*
+*********************************************************************/
+int main
+    (
+    int argc,
+    char *argv[]
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+static const double sensitivity_125k[] =   /* SX1276, SF6 to 12   */
+    { -118.0, -123.0, -126.0, -129.0, -132.0, -133.0, -136.0 };
+
+uint16_t counts[ SIM_MAX_COUNTS ];      /* node counts to run       */
+uint8_t count_total;                    /* entries in counts[]      */
+const char *list;                       /* -n argument              */
+char *next;                             /* end of a number          */
+unsigned long value;                    /* number read              */
+bool usage;                             /* bad argument             */
+uint8_t i;                              /* iterator                 */
+int arg;                                /* argument index           */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+config.hours                    = 1.0;
+config.interval_s               = 60.0;
+config.data_size                = 16;
+config.radio.spreading_factor   = 7;
+config.radio.bandwidth_hz       = 125000;
+config.radio.coding_rate        = 1;
+config.radio.preamble_length    = 8;
+config.radio.crc_on             = true;
+config.radio.implicit_header    = false;
+config.radius_m                 = 3000.0;
+config.exponent                 = 2.7;
+config.sigma_db                 = 4.0;
+config.per                      = 0.01;
+config.peer                     = false;
+config.seed                     = 1;
+list                            = "10,25,50,100,200";
+usage                           = false;
+
+for( arg = 1; arg + 1 < argc && ! usage; arg += 2 )
+    {
+    if( strcmp( argv[ arg ], "-n" ) == 0 )
+        {
+        list = argv[ arg + 1 ];
+        }
+    else if( strcmp( argv[ arg ], "-t" ) == 0 )
+        {
+        config.hours = strtod( argv[ arg + 1 ], NULL );
+        }
+    else if( strcmp( argv[ arg ], "-i" ) == 0 )
+        {
+        config.interval_s = strtod( argv[ arg + 1 ], NULL );
+        }
+    else if( strcmp( argv[ arg ], "-b" ) == 0 )
+        {
+        value = strtoul( argv[ arg + 1 ], NULL, 0 );
+        usage = ( value < STAMP_SIZE || value > MAX_MSG_LENGTH );
+        config.data_size = ( uint8_t ) value;
+        }
+    else if( strcmp( argv[ arg ], "-f" ) == 0 )
+        {
+        value = strtoul( argv[ arg + 1 ], NULL, 0 );
+        usage = ( value < 6 || value > 12 );
+        config.radio.spreading_factor = ( uint8_t ) value;
+        }
+    else if( strcmp( argv[ arg ], "-w" ) == 0 )
+        {
+        config.radio.bandwidth_hz = ( uint32_t ) strtoul( argv[ arg + 1 ], NULL, 0 );
+        }
+    else if( strcmp( argv[ arg ], "-r" ) == 0 )
+        {
+        config.radius_m = strtod( argv[ arg + 1 ], NULL );
+        }
+    else if( strcmp( argv[ arg ], "-x" ) == 0 )
+        {
+        config.exponent = strtod( argv[ arg + 1 ], NULL );
+        }
+    else if( strcmp( argv[ arg ], "-g" ) == 0 )
+        {
+        config.sigma_db = strtod( argv[ arg + 1 ], NULL );
+        }
+    else if( strcmp( argv[ arg ], "-e" ) == 0 )
+        {
+        config.per = strtod( argv[ arg + 1 ], NULL );
+        }
+    else if( strcmp( argv[ arg ], "-c" ) == 0 )
+        {
+        config.radio.crc_on = ( strtoul( argv[ arg + 1 ], NULL, 0 ) != 0 );
+        }
+    else if( strcmp( argv[ arg ], "-p" ) == 0 )
+        {
+        config.peer = ( strcmp( argv[ arg + 1 ], "peer" ) == 0 );
+        usage = ! config.peer && strcmp( argv[ arg + 1 ], "star" ) != 0;
+        }
+    else if( strcmp( argv[ arg ], "-s" ) == 0 )
+        {
+        config.seed = strtoull( argv[ arg + 1 ], NULL, 0 );
+        }
+    else
+        {
+        usage = true;
+        }
+    }
+
+/*----------------------------------------------------------
+Node counts, each from 2 up to the address space
+----------------------------------------------------------*/
+count_total = 0;
+while( ! usage && *list != '\0' && count_total < SIM_MAX_COUNTS )
+    {
+    value = strtoul( list, &next, 10 );
+    usage = ( next == list || value < 2 || value > SIM_MAX_NODES );
+    counts[ count_total++ ] = ( uint16_t ) value;
+    list = ( *next == ',' ) ? next + 1 : next;
+    }
+
+if( usage || arg < argc || count_total == 0 || config.hours <= 0 || config.interval_s <= 0
+ || config.radio.bandwidth_hz == 0 )
+    {
+    fprintf( stderr, "usage: %s [-n 10,50,200] [-t hours] [-i interval s] [-b data bytes]\n"
+                     "       [-f sf] [-w bandwidth hz] [-r radius m] [-x exponent]\n"
+                     "       [-g sigma dB] [-e per] [-c 0|1] [-p star|peer] [-s seed]\n"
+                     "node counts from 2 to %u\n", argv[ 0 ], SIM_MAX_NODES );
+    return 2;
+    }
+
+sensitivity_dbm = sensitivity_125k[ config.radio.spreading_factor - 6 ]
+                + 10.0 * log10( config.radio.bandwidth_hz / 125000.0 );
+max_airtime_us  = sched_airtime_us( &config.radio, MAX_LORA_MSG_SIZE );
+
+contexts = calloc( SIM_MAX_NODES, sizeof( *contexts ) );
+if( contexts == NULL )
+    {
+    fprintf( stderr, "out of memory\n" );
+    return 1;
+    }
+
+for( i = 0; i < count_total; i++ )
+    {
+    run( counts[ i ] );
+    }
+
+free( contexts );
+free( latencies );
+
+return 0;
+
+} /* main() */
@@ -15,6 +15,7 @@
 --------------------------------------------------------------------*/
 
 #include "messageAPI.h"
+#include "msg_crc.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -25,7 +26,9 @@
 --------------------------------------------------------------------*/
 #define API_VERSION         ( 1 )       /* message API v1                  */
 
-#define MAXIMUM_MSG_LENGTH  ( 10 )      /* maximum size of message data    */
+#define API_VERSION_2       ( 2 )       /* message API v2, 8 bit size      */
+
+#define MAXIMUM_MSG_LENGTH  ( MAX_MSG_LENGTH_V1 ) /* maximum size of v1 data */
 
 #define MINIMUM_MSG_LENGTH  ( 6 )       /* minium size of empty message    */
 
@@ -33,6 +36,8 @@
 
 #define SOURCE_BYTE         ( 1 )       /* source byte array index         */
  
+#define SEQUENCE_BYTE       ( 2 )       /* v1 sequence byte (old pad)      */
+
 #define VERSION_BYTE        ( 3 )       /* version byte array index        */
 
 #define VERSION_MASK        ( 0xF0 )    /* version byte mask               */
@@ -41,514 +46,3613 @@
 
 #define SIZE_MASK           ( 0x0F )    /* size byte mask                  */
 
+#define SIZE_V2_BYTE        ( 2 )       /* v2 size byte array index        */
+
+#define FLAGS_MASK          ( 0x0F )    /* v2 flags in version byte        */
+
+#define FLAG_PORT           ( 0x01 )    /* v2 port byte follows key        */
+
+#define FLAG_SEQUENCE       ( 0x02 )    /* v2 sequence byte follows port   */
+
+#define FLAG_ROUTE          ( 0x04 )    /* v2 final destination and ttl
+                                           bytes follow sequence           */
+
+#define FLAG_SECURE         ( 0x08 )    /* v2 counter and tag bytes follow
+                                           route, data is encrypted        */
+
+#define KNOWN_FLAGS         ( FLAG_PORT | FLAG_SEQUENCE | FLAG_ROUTE | FLAG_SECURE )
+                                        /* v2 flags this build reads       */
+
+#define SECURE_OPTION_BYTES ( MSG_COUNTER_SIZE + MSG_TAG_SIZE - 1 )
+                                        /* counter and all tag bytes but
+                                           the last, which takes the crc
+                                           byte                            */
+
+#define MAX_OPTION_BYTES    ( 2 + MSG_ROUTE_OVERHEAD + SECURE_OPTION_BYTES )
+                                        /* v2 port, sequence, route and
+                                           secure                          */
+
+#define MAX_AD_BYTES        ( HEADER_BYTE_COUNT + 2 + MSG_COUNTER_SIZE )
+                                        /* secure frame associated data    */
+
+#define MAX_DATA_AND_OPTIONS ( MAX_LORA_MSG_SIZE - MINIMUM_MSG_LENGTH )
+                                        /* v2 bytes between key and crc    */
+
 #define KEY_BYTE            ( 4 )       /* key byte array index            */
 
-#define DATA_START_BYTE     ( 5 )       /* data byte(s) array start index  */
+#define DATA_START_BYTE     ( MSG_DATA_OFFSET ) /* data byte(s) array start index */
 
 #define HEADER_BYTE_COUNT   ( 5 )       /* count of non CRC header bytes   */
 
+#define MAX_FRAME_LENGTH    ( MAX_MSG_LENGTH + MSG_MAX_FRAME_OVERHEAD )
+                                        /* frame for largest tx_message    */
+
+#if( MSG_MAX_MODULES > 0xDE )
+#error MSG_MAX_MODULES must stay below MODULE_NONE
+#endif
+
+#if( MSG_TAG_SIZE < 1 || MSG_TAG_SIZE > ASCON_TAG_SIZE )
+#error MSG_TAG_SIZE must be 1 to 16
+#endif
+
 /*--------------------------------------------------------------------
                                 TYPES
 --------------------------------------------------------------------*/
 
-typedef struct                              /* lora message format  */
-    {
-    location source;                        /* source               */
-    location destination;                   /* destination          */
-    uint8_t pad;                            /* future update space  */
-    uint8_t version;                        /* version of API used  */
-    uint8_t size;                           /* size of message[]    */
-    uint8_t key;                            /* key                  */
-    uint8_t message[ MAX_LORA_MSG_SIZE ];   /* data buffer          */
-    uint8_t crc;                            /* crc                  */
-    } lora_message;
-
 /*--------------------------------------------------------------------
                            MEMORY CONSTANTS
 --------------------------------------------------------------------*/
-/*----------------------------------------------------------
-This CRC lookup table is for polynomal 0x7
-----------------------------------------------------------*/
-static uint8_t const crc8_table[] = {
-0x00, 0x91, 0xE3, 0x72, 0x07, 0x96, 0xE4, 0x75, 0x0E, 0x9F, 0xED, 0x7C, 0x09, 0x98, 0xEA, 0x7B,
-0x1C, 0x8D, 0xFF, 0x6E, 0x1B, 0x8A, 0xF8, 0x69, 0x12, 0x83, 0xF1, 0x60, 0x15, 0x84, 0xF6, 0x67,
-0x38, 0xA9, 0xDB, 0x4A, 0x3F, 0xAE, 0xDC, 0x4D, 0x36, 0xA7, 0xD5, 0x44, 0x31, 0xA0, 0xD2, 0x43,
-0x24, 0xB5, 0xC7, 0x56, 0x23, 0xB2, 0xC0, 0x51, 0x2A, 0xBB, 0xC9, 0x58, 0x2D, 0xBC, 0xCE, 0x5F,
-0x70, 0xE1, 0x93, 0x02, 0x77, 0xE6, 0x94, 0x05, 0x7E, 0xEF, 0x9D, 0x0C, 0x79, 0xE8, 0x9A, 0x0B,
-0x6C, 0xFD, 0x8F, 0x1E, 0x6B, 0xFA, 0x88, 0x19, 0x62, 0xF3, 0x81, 0x10, 0x65, 0xF4, 0x86, 0x17,
-0x48, 0xD9, 0xAB, 0x3A, 0x4F, 0xDE, 0xAC, 0x3D, 0x46, 0xD7, 0xA5, 0x34, 0x41, 0xD0, 0xA2, 0x33,
-0x54, 0xC5, 0xB7, 0x26, 0x53, 0xC2, 0xB0, 0x21, 0x5A, 0xCB, 0xB9, 0x28, 0x5D, 0xCC, 0xBE, 0x2F,
-0xE0, 0x71, 0x03, 0x92, 0xE7, 0x76, 0x04, 0x95, 0xEE, 0x7F, 0x0D, 0x9C, 0xE9, 0x78, 0x0A, 0x9B,
-0xFC, 0x6D, 0x1F, 0x8E, 0xFB, 0x6A, 0x18, 0x89, 0xF2, 0x63, 0x11, 0x80, 0xF5, 0x64, 0x16, 0x87,
-0xD8, 0x49, 0x3B, 0xAA, 0xDF, 0x4E, 0x3C, 0xAD, 0xD6, 0x47, 0x35, 0xA4, 0xD1, 0x40, 0x32, 0xA3,
-0xC4, 0x55, 0x27, 0xB6, 0xC3, 0x52, 0x20, 0xB1, 0xCA, 0x5B, 0x29, 0xB8, 0xCD, 0x5C, 0x2E, 0xBF,
-0x90, 0x01, 0x73, 0xE2, 0x97, 0x06, 0x74, 0xE5, 0x9E, 0x0F, 0x7D, 0xEC, 0x99, 0x08, 0x7A, 0xEB,
-0x8C, 0x1D, 0x6F, 0xFE, 0x8B, 0x1A, 0x68, 0xF9, 0x82, 0x13, 0x61, 0xF0, 0x85, 0x14, 0x66, 0xF7,
-0xA8, 0x39, 0x4B, 0xDA, 0xAF, 0x3E, 0x4C, 0xDD, 0xA6, 0x37, 0x45, 0xD4, 0xA1, 0x30, 0x42, 0xD3,
-0xB4, 0x25, 0x57, 0xC6, 0xB3, 0x22, 0x50, 0xC1, 0xBA, 0x2B, 0x59, 0xC8, 0xBD, 0x2C, 0x5E, 0xCF};
 
 /*--------------------------------------------------------------------
                               VARIABLES
 --------------------------------------------------------------------*/
-static uint8_t current_key; 
+static message_ctx default_ctx;             /* context behind the
+                                               plain API calls      */
+
+static msg_transport default_transport;     /* set_transport backend */
+
+static bool default_transport_valid;        /* set_transport called? */
+
 /*--------------------------------------------------------------------
                                 MACROS
 --------------------------------------------------------------------*/
+#define module_known( ctx, module ) \
+    ( ( module ) < MSG_MAX_MODULES && ( ( ( ctx )->modules[ ( module ) / 32 ] >> ( ( module ) % 32 ) ) & 1 ) )
+
+#define grace_key_match( ctx, key ) \
+    ( ( ctx )->grace_key_valid && ( key ) == ( ctx )->grace_key )
+
+#if( MSG_STATS )
+#define stats_now( ctx ) \
+    ( ( ( ctx )->stats_clock != NULL ) ? ( ctx )->stats_clock() : 0 )
+
+#define count_rx_error( ctx, code ) \
+    ( ( ( uint32_t )( code ) < MSG_ERROR_COUNT ) ? ( void )( ctx )->stats.rx_errors[ ( code ) ]++ : ( void ) 0 )
+#else
+#define count_rx_error( ctx, code )     ( ( void ) 0 )
+#endif
 
 /*--------------------------------------------------------------------
                               PROCEDURES
 --------------------------------------------------------------------*/
 uint8_t calculate_crc
     (
-    uint8_t message_array[],  /* message array to caclulate crc       */
+    const uint8_t message_array[], /* message array to caclulate crc  */
     uint8_t size              /* size of message_array                */
     );
 
-lora_message covert_message
+static bool frame_layout
+    (
+    const uint8_t message_array[], /* frame header                    */
+    uint8_t *data_size,        /* pointer to store size of data        */
+    uint8_t *option_size,      /* pointer to store v2 option bytes     */
+    uint8_t *flags             /* pointer to store v2 flags            */
+    );
+
+static uint8_t covert_message
     (
-    uint8_t message_array[],   /* message array to caclulate crc       */
+    const uint8_t message_array[], /* frame(s) to decode              */
     uint8_t size,              /* size of message_array                */
+    msg_view *view,            /* view to fill in                      */
     lora_errors *error_ptr     /* pointer to error variable            */
     );
 
-/*********************************************************************
-*
-*   PROCEDURE NAME:
-*       covert_message
-*
-*   DESCRIPTION:
-*       convert message from array to rx_message type
-*
-*********************************************************************/
-lora_message covert_message
+static bool fill_rx_buffer
     (
-    uint8_t message_array[],
-    uint8_t size,
-    lora_errors *error_ptr
-    )
-{
-/*----------------------------------------------------------
-Local variables
-----------------------------------------------------------*/
-lora_message return_msg;
-uint8_t crc_byte_index;
-uint8_t i;
+    message_ctx *ctx,          /* context                              */
+    lora_errors *errors        /* pointer to store errors received     */
+    );
 
-/*----------------------------------------------------------
-Initilize local variables
-----------------------------------------------------------*/
-memset( &return_msg, 0, sizeof( return_msg ) );
-crc_byte_index = 0;
-i = 0;
+static bool address_match
+    (
+    message_ctx *ctx,          /* context                              */
+    uint8_t destination        /* destination byte of frame            */
+    );
 
-/*----------------------------------------------------------
-Check for less than one message
-----------------------------------------------------------*/
-if ( size > MINIMUM_MSG_LENGTH )
-    {
-    /*----------------------------------------------------------
-    Convert header data
-    Byte 0 -- destination byte
-    Byte 1 -- source byte
-    Byte 2 -- pad (future expantion)
-    Byte 3 -- version/size byte (upper/lower bits)
-    Byte 4 -- key byte
-    Byte 5 -- start of data region
-    Byte X -- crc (last byte) 
-    ----------------------------------------------------------*/
-    return_msg.destination  = message_array[ DESTINATION_BYTE ];
-    return_msg.source       = message_array[ SOURCE_BYTE ];
-    return_msg.version      = ( message_array[ VERSION_BYTE ] & VERSION_MASK ) >> 4;
-    return_msg.size         = ( message_array[ SIZE_BYTE ] & SIZE_MASK );
-    return_msg.key          = message_array[ KEY_BYTE ];
+static bool decode_frame
+    (
+    message_ctx *ctx,          /* context                              */
+    msg_view *view,            /* view to fill in                      */
+    lora_errors *errors        /* pointer to store errors received     */
+    );
 
-    /*----------------------------------------------------------
-    Issue with message size variable
-    ----------------------------------------------------------*/
-    if( return_msg.size > MAXIMUM_MSG_LENGTH )
-        {
-        *error_ptr = RX_INVALID_HEADER;
-        return return_msg;
-        }
-    else
-        {
-        /*----------------------------------------------------------
-        Retrive crc byte from end
-        ----------------------------------------------------------*/
-        crc_byte_index = return_msg.size + DATA_START_BYTE;
-        return_msg.crc = message_array[ crc_byte_index ];
+static bool decode_next_frame
+    (
+    message_ctx *ctx,          /* context                              */
+    msg_view *view,            /* view to fill in                      */
+    lora_errors *errors        /* pointer to store errors received     */
+    );
 
-        /*----------------------------------------------------------
-        Retrive message
-        ----------------------------------------------------------*/
-        for ( i = 0; i < return_msg.size; i++ )
-            {
-            return_msg.message[ i ] = message_array[ i + DATA_START_BYTE ];
-            }
-        /*----------------------------------------------------------
-        Check for more than one message by using size and verifying
-        all bytes were looked at
-        ----------------------------------------------------------*/
-        if ( crc_byte_index != ( size - 1 ) )
-            {
-            *error_ptr = RX_DOUBLE;
-            }
+static bool copy_view
+    (
+    const msg_view *view,      /* decoded frame                        */
+    rx_message *message        /* message to fill in                   */
+    );
 
-        return return_msg;
-        }
-    }
-else
-    {
-    *error_ptr = RX_SIZING;
-    return return_msg;
+static bool is_duplicate
+    (
+    message_ctx *ctx,          /* context                              */
+    location source,           /* sending module                       */
+    uint8_t sequence           /* frame sequence number                */
+    );
 
-    }
-} /* covert_message() */
+static const msg_route * find_route
+    (
+    const message_ctx *ctx,    /* context                              */
+    location destination       /* final destination                    */
+    );
 
+static void relay_frame
+    (
+    message_ctx *ctx,          /* context                              */
+    const uint8_t frame[],     /* received frame                       */
+    uint8_t size               /* size of frame[]                      */
+    );
 
-/*********************************************************************
-*
-*   PROCEDURE NAME:
-*       calculate_crc
-*
-*   DESCRIPTION:
-*       caculates crc8 based on inputted message array
-*
-*********************************************************************/
-uint8_t calculate_crc
+static const ascon_key * find_secure_key
     (
-    uint8_t message_array[],
-    uint8_t size
-    )
-{
-/*----------------------------------------------------------
-Local variables
-----------------------------------------------------------*/
-uint8_t crc;                                 /* crc value */
-uint8_t i;                                   /* iterator  */
+    const message_ctx *ctx,    /* context                              */
+    location peer              /* module, MSG_BROADCAST for network    */
+    );
 
-/*----------------------------------------------------------
-Initilize local variables
-----------------------------------------------------------*/
-crc = 0;
-i   = 0;
+static uint8_t secure_ad
+    (
+    const uint8_t frame[],     /* secure frame                         */
+    location destination,      /* final destination                    */
+    uint8_t counter_index,     /* index of counter in frame[]          */
+    uint8_t ad[]               /* MAX_AD_BYTES array to fill           */
+    );
 
-/*----------------------------------------------------------
-Calculate crc
-----------------------------------------------------------*/
-for( i = 0; i < size; i++ )
-    {
-    crc = crc8_table[ crc ^ message_array[i] ];
-    }
+static void seal_frame
+    (
+    message_ctx *ctx,          /* context                              */
+    const ascon_key *key,      /* key for destination                  */
+    uint8_t frame[],           /* encoded frame, data in clear         */
+    location destination,      /* final destination                    */
+    uint8_t counter_index,     /* index of counter in frame[]          */
+    uint8_t size               /* size of frame[]                      */
+    );
 
-return crc;
+static lora_errors open_frame
+    (
+    message_ctx *ctx,          /* context                              */
+    uint8_t frame[],           /* received secure frame                */
+    uint8_t size,              /* size of frame[]                      */
+    const msg_view *view       /* decoded header of frame              */
+    );
 
-} /* calculate_crc() */
+static uint8_t encode_frame
+    (
+    message_ctx *ctx,          /* context                              */
+    const msg_header *header,  /* destination and options              */
+    const uint8_t data[],      /* data to send                         */
+    uint8_t size,              /* size of data[]                       */
+    uint8_t frame[]            /* array to hold encoded frame          */
+    );
+
+static lora_errors transmit_frame
+    (
+    message_ctx *ctx,          /* context                              */
+    uint8_t frame[],           /* encoded frame                        */
+    uint8_t size               /* size of frame[]                      */
+    );
+
+#if( MSG_STATS )
+static void record_latency
+    (
+    msg_latency *latency,      /* histogram to add to                  */
+    uint32_t ticks             /* sample                               */
+    );
+
+static void record_rx
+    (
+    message_ctx *ctx,          /* context                              */
+    const msg_view *view,      /* decoded frame                        */
+    bool accepted,             /* frame taken for this module          */
+    const uint8_t frame[],     /* start of frame in rx_buffer          */
+    uint8_t size,              /* rx_buffer bytes used by frame        */
+    lora_errors errors,        /* result of the frame                  */
+    uint32_t start             /* clock before decoding                */
+    );
+
+static void record_tx
+    (
+    message_ctx *ctx,          /* context                              */
+    const uint8_t frame[],     /* frame sent                           */
+    uint8_t size,              /* size of frame[]                      */
+    lora_errors errors,        /* result of the send                   */
+    uint32_t start             /* clock before sending                 */
+    );
+#endif
 
 /*********************************************************************
 *
 *   PROCEDURE NAME:
-*       get_message
+*       frame_layout
 *
 *   DESCRIPTION:
-*       procedure for receiving messages in messageAPI format 
-*       through LoRa
+*       read size of data region and of the v2 option bytes between
+*       key and data from a v1 or v2 header
 *
 *   RETURN:
-*       T/F message received y/n
+*       T/F header valid y/n
 *
 *********************************************************************/
-bool get_message
+static bool frame_layout
     (
-    rx_message *message,       /* pointer to store message received */
-    lora_errors *errors        /* pointer to store errors received  */
+    const uint8_t message_array[],
+    uint8_t *data_size,
+    uint8_t *option_size,
+    uint8_t *flags
     )
 {
-/*----------------------------------------------------------
-Local variables
-----------------------------------------------------------*/
-uint8_t return_message[ MAX_LORA_MSG_SIZE ]; /* array holding return message */
-uint8_t return_message_size;                 /* size of return message array */
-lora_errors return_message_errors;           /* errors from lora comm layer  */
-lora_message formatted_array;                /* message array formated       */   
 
-/*----------------------------------------------------------
-Initilize local variables
-----------------------------------------------------------*/
-memset( &return_message, 0, sizeof( return_message ) );
-return_message_size     = 0;
-return_message_errors   = RX_TIMEOUT;
+*option_size    = 0;
+*flags          = 0;
 
-/*----------------------------------------------------------
-Check is message has been received, if not exit
-----------------------------------------------------------*/
-if( lora_get_message( return_message, MAX_LORA_MSG_SIZE, &return_message_size, &return_message_errors ) )
+switch( ( message_array[ VERSION_BYTE ] & VERSION_MASK ) >> 4 )
     {
     /*----------------------------------------------------------
-    if issues with lora_get_message, update global error
-    and return false
-    ----------------------------------------------------------*/
-    if ( return_message_errors != RX_NO_ERROR )
-        {
-        *errors = return_message_errors;
-        return false;
-        }
-
-    /*----------------------------------------------------------
-    Convert message
+    v1 -- size in lower bits of version byte
     ----------------------------------------------------------*/
-    formatted_array = covert_message( return_message, return_message_size, &return_message_errors);
+    case API_VERSION:
+        *data_size = message_array[ SIZE_BYTE ] & SIZE_MASK;
+        return ( *data_size <= MAXIMUM_MSG_LENGTH );
 
     /*----------------------------------------------------------
-    Update errors
+    v2 -- size in pad byte, flags select option bytes
     ----------------------------------------------------------*/
-    *errors = return_message_errors;
+    case API_VERSION_2:
+        *flags = message_array[ VERSION_BYTE ] & FLAGS_MASK;
+        *data_size = message_array[ SIZE_V2_BYTE ];
 
-    /*----------------------------------------------------------
-    Verify message
-    ----------------------------------------------------------*/
-    if ( *errors == RX_NO_ERROR )
-        {
-        /*----------------------------------------------------------
-        Calculate and verify CRC and key
-        ----------------------------------------------------------*/
-        if ( formatted_array.crc != calculate_crc( return_message, ( formatted_array.size + HEADER_BYTE_COUNT ) ) )
+        if( *flags & FLAG_PORT )
             {
-            message->valid = false;
-            *errors = RX_CRC_ERROR;
+            *option_size += 1;
             }
-        else if ( formatted_array.key != current_key )
+
+        if( *flags & FLAG_SEQUENCE )
             {
-            message->valid = false;
-            *errors = RX_KEY_ERR;
+            *option_size += 1;
             }
-        }
-    else
-        {
-        /*----------------------------------------------------------
-        Since errors were detected, mark as invalid
-        ----------------------------------------------------------*/
-        message->valid = false;
-        }
-    
-    /*----------------------------------------------------------
-    Update rx_message
-    ----------------------------------------------------------*/
-    message->size           = formatted_array.size;
-    memcpy( message->message, formatted_array.message, formatted_array.size );
 
-    /*----------------------------------------------------------
-    Verify destination is a valid location
-    ----------------------------------------------------------*/
-    if( formatted_array.destination >= NUM_OF_MODULES )
-        {
-        /*----------------------------------------------------------
-        Verify destination is our modules
-        ----------------------------------------------------------*/
-        if( formatted_array.destination == current_location )
+        if( *flags & FLAG_ROUTE )
             {
-            /*----------------------------------------------------------
-            Verify source location
-            ----------------------------------------------------------*/
-            if( formatted_array.source >= NUM_OF_MODULES )
-                {
-                message->source = INVALID_LOCATION;
-                }
-            else
-                {
-                message->source = ( location ) formatted_array.source;
-                }
-
-            /*----------------------------------------------------------
-            Verify key
-            ----------------------------------------------------------*/
-            if ( current_key != formatted_array.key && *errors == RX_NO_ERROR )
-                {
-                *errors = RX_KEY_ERR;
-                }
-
-            return true;
+            *option_size += MSG_ROUTE_OVERHEAD;
             }
-        else
+
+        if( *flags & FLAG_SECURE )
             {
-            /*----------------------------------------------------------
-            Message valid but not current location
-            ----------------------------------------------------------*/
-            return false;
+            *option_size += SECURE_OPTION_BYTES;
             }
-        }
-    else
-        {
-        /*----------------------------
-        sys_def.h is not up to date
-        ----------------------------*/
-        *errors = RX_INVALID_HEADER;
-        return false;
-        }
-    }
-else
-    {
-    /*----------------------------------------------------------
-    Set return value false
-    ----------------------------------------------------------*/
-    return false;
 
-    }
+        return ( ( *flags & ~KNOWN_FLAGS ) == 0 )
+            && ( *data_size + *option_size <= MAX_DATA_AND_OPTIONS );
 
-} /* get_message() */
+    default:
+        *data_size = 0;
+        return false;
+    }
 
+} /* frame_layout() */
 
 /*********************************************************************
 *
 *   PROCEDURE NAME:
-*       send_message
+*       covert_message
 *
 *   DESCRIPTION:
-*       procedure for sending messages in messageAPI format 
-*       through LoRa
+*       decode header of first frame in array into view. size is
+*       the number of bytes left in the buffer, which can hold more
+*       frames back-to-back. the payload is not copied, view points
+*       into message_array
+*
+*   RETURN:
+*       bytes used by the frame, 0 on error
 *
 *********************************************************************/
-lora_errors send_message
+static uint8_t covert_message
     (
-    tx_message message                           /* message to send */
+    const uint8_t message_array[],
+    uint8_t size,
+    msg_view *view,
+    lora_errors *error_ptr
     )
 {
 /*----------------------------------------------------------
 Local variables
 ----------------------------------------------------------*/
-uint8_t message_array[ MAX_LORA_MSG_SIZE ];     /* array to send through LoRa */
-lora_errors errors;                             /* lora related errors        */
-uint8_t i;                                      /* interator                  */
-uint8_t array_size;                             /* size of message_array[]    */
-/*----------------------------------------------------------
-Initilize local variables
-----------------------------------------------------------*/
-errors      = RX_NO_ERROR;
-i           = 0;
-array_size  = 0;
-memset( message_array, 0, sizeof( message_array ) );
+uint8_t crc_byte_index;
+uint8_t option_size;
+uint8_t option_index;
+uint8_t flags;
 
 /*----------------------------------------------------------
-Verify message size
+Check for less than one message
 ----------------------------------------------------------*/
-if( message.size > MAX_MSG_LENGTH )
+if ( size < MINIMUM_MSG_LENGTH )
     {
-    return RX_ARRAY_SIZE_ERR;
+    view->size = 0;
+    *error_ptr = RX_SIZING;
+    return 0;
     }
 
 /*----------------------------------------------------------
-Convert tx_message to array
-
+Convert header data
 Byte 0 -- destination byte
 Byte 1 -- source byte
-Byte 2 -- pad (future expantion)
-Byte 3 -- version/size byte (upper/lower bits)
+Byte 2 -- v1: sequence (old pad) / v2: size byte
+Byte 3 -- v1: version/size byte (upper/lower bits)
+          v2: version/flags byte (upper/lower bits)
 Byte 4 -- key byte
-Byte 5 -- start of data region
-Byte X -- crc (last byte) 
+Byte 5 -- v2: option bytes selected by flags (port, sequence,
+          final destination and ttl, counter and tag)
+Byte 5 -- start of data region (after any option bytes)
+Byte X -- crc, or last tag byte (last byte)
 ----------------------------------------------------------*/
-message_array[ DESTINATION_BYTE ] = ( uint8_t ) message.destination;
-message_array[ SOURCE_BYTE ] = ( uint8_t ) current_location;
-message_array[ SIZE_BYTE ] = ( API_VERSION << 4 ) + message.size;
-message_array[ KEY_BYTE ] = current_key;
+view->destination  = message_array[ DESTINATION_BYTE ];
+view->source       = message_array[ SOURCE_BYTE ];
+view->key          = message_array[ KEY_BYTE ];
+view->port         = MSG_PORT_APP;
+view->sequence     = 0;
 
-for( i = 0; i < message.size; i++ )
+/*----------------------------------------------------------
+Issue with version or message size variable
+----------------------------------------------------------*/
+if( ! frame_layout( message_array, &view->size, &option_size, &flags ) )
     {
-    message_array[ i + DATA_START_BYTE ] = message.message[ i ];
-    
+    view->size = 0;
+    *error_ptr = RX_INVALID_HEADER;
+    return 0;
     }
 
 /*----------------------------------------------------------
-Calulate CRC and put in last byte of array
-
-we do not use crc byte in crc caculation so when passing
-in size, we pass in ( array_size + HEADER BYTE COUNT )
+Verify whole frame is in buffer
 ----------------------------------------------------------*/
-array_size = message.size + MINIMUM_MSG_LENGTH;
-
-message_array[ array_size - 1 ] = calculate_crc( message_array, ( message.size + HEADER_BYTE_COUNT) );
+crc_byte_index = option_size + view->size + DATA_START_BYTE;
+if( crc_byte_index >= size )
+    {
+    view->size = 0;
+    *error_ptr = RX_SIZING;
+    return 0;
+    }
 
 /*----------------------------------------------------------
-Send message
+Read option bytes
 ----------------------------------------------------------*/
-errors = lora_send_message(message_array, array_size );
+option_index = DATA_START_BYTE;
+
+if( flags & FLAG_PORT )
+    {
+    view->port = message_array[ option_index++ ];
+    }
+
+if( flags & FLAG_SEQUENCE )
+    {
+    view->sequence = message_array[ option_index++ ];
+    }
+else if( ( message_array[ VERSION_BYTE ] & VERSION_MASK ) >> 4 == API_VERSION )
+    {
+    view->sequence = message_array[ SEQUENCE_BYTE ];
+    }
 
 /*----------------------------------------------------------
-Revert to rx continious mode
+Relayed frames are reported with their final destination,
+the destination byte only names the next hop
 ----------------------------------------------------------*/
-if( ! lora_init_continious_rx() )
+if( flags & FLAG_ROUTE )
     {
-    errors = RX_INIT_ERR;
+    view->destination = message_array[ option_index ];
     }
 
+view->payload = &message_array[ DATA_START_BYTE + option_size ];
+
 /*----------------------------------------------------------
-return errors
+Report frame length, any bytes past the crc belong to
+the next frame
 ----------------------------------------------------------*/
-return errors;
+return crc_byte_index + 1;
+
+} /* covert_message() */
 
-} /* send_message() */
 
 /*********************************************************************
 *
 *   PROCEDURE NAME:
-*       init_message
+*       calculate_crc
 *
 *   DESCRIPTION:
-*       procedure for setting up message API
+*       caculates crc8 based on inputted message array
 *
 *********************************************************************/
-lora_errors init_message
+uint8_t calculate_crc
     (
-    lora_config config_data                  /* SPI Interface info  */
+    const uint8_t message_array[],
+    uint8_t size
     )
 {
-/*----------------------------------------------------------
-Local variables
-----------------------------------------------------------*/
-lora_errors init_errors;
 
-/*----------------------------------------------------------
-Initilize local variables
-----------------------------------------------------------*/
-init_errors = RX_NO_ERROR;
+return crc8_final( crc8_update( crc8_init(), message_array, size ) );
 
-/*----------------------------------------------------------
-Initilize static variables
-----------------------------------------------------------*/
-current_key = 0x00;
+} /* calculate_crc() */
 
-/*----------------------------------------------------------
-Initilize port statics
-----------------------------------------------------------*/
-lora_port_init( config_data );
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       fill_rx_buffer
+*
+*   DESCRIPTION:
+*       read next buffer from the transport into rx_buffer
+*
+*   RETURN:
+*       T/F buffer with frames available y/n
+*
+*********************************************************************/
+static bool fill_rx_buffer
+    (
+    message_ctx *ctx,          /* context                           */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t return_message_size;                 /* size of return message array */
+lora_errors return_message_errors;           /* errors from lora comm layer  */
 
 /*----------------------------------------------------------
-Put into rx mode
+Initilize local variables
+----------------------------------------------------------*/
+return_message_size     = 0;
+return_message_errors   = RX_TIMEOUT;
+ctx->rx_offset               = 0;
+ctx->rx_size                 = 0;
+
+/*----------------------------------------------------------
+In event mode leave the radio alone until message_rx_isr
+has flagged a frame. the flag is cleared before the read
+so an interrupt during the read is not lost, and set again
+after a good read in case more frames are waiting
 ----------------------------------------------------------*/
-if( ! lora_init_continious_rx() )
+if( ctx->rx_events )
     {
-    init_errors = RX_INIT_ERR;
+    if( ! ctx->rx_pending )
+        {
+        return false;
+        }
+    ctx->rx_pending = 0;
     }
 
-return init_errors;
+/*----------------------------------------------------------
+Check is message has been received, if not exit
+----------------------------------------------------------*/
+if( ! ctx->transport.get( ctx->transport.port, ctx->rx_buffer, MAX_LORA_MSG_SIZE, &return_message_size, &return_message_errors ) )
+    {
+    return false;
+    }
 
-} /* init_message() */
+if( ctx->rx_events )
+    {
+    ctx->rx_pending = 1;
+    }
+
+/*----------------------------------------------------------
+if issues with lora_get_message, update global error
+and return false
+----------------------------------------------------------*/
+if ( return_message_errors != RX_NO_ERROR )
+    {
+    count_rx_error( ctx, return_message_errors );
+    *errors = return_message_errors;
+    return false;
+    }
+
+ctx->rx_size = return_message_size;
+
+return true;
+
+} /* fill_rx_buffer() */
 
 /*********************************************************************
 *
 *   PROCEDURE NAME:
-*       update_key 
+*       address_match
 *
 *   DESCRIPTION:
-*       procedure for updating key used in messageAPI
+*       check destination against current location and the groups
+*       enabled in group_mask. MSG_BROADCAST is a group every
+*       context is in
+*
+*   RETURN:
+*       T/F frame addressed to this module y/n
 *
 *********************************************************************/
-void update_key
+static bool address_match
     (
-    uint8_t new_key                                      /* new key */
+    message_ctx *ctx,          /* context                           */
+    uint8_t destination        /* destination byte of frame         */
     )
 {
 
-current_key = new_key;
+if( destination == ctx->module )
+    {
+    return true;
+    }
+
+return ( destination >= MSG_GROUP_BASE )
+    && ( ( ctx->group_mask >> ( destination - MSG_GROUP_BASE ) ) & 1 );
 
-} /* update_key() */
+} /* address_match() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       is_duplicate
+*
+*   DESCRIPTION:
+*       check sequence against the last MSG_DEDUP_WINDOW sequences
+*       seen from source and record it. sequence 1 is only sent as
+*       the first frame after a sender starts, so it, or a sequence
+*       further behind than the window, is taken as the source
+*       restarting
+*
+*   RETURN:
+*       T/F frame seen before y/n
+*
+*********************************************************************/
+static bool is_duplicate
+    (
+    message_ctx *ctx,
+    location source,
+    uint8_t sequence
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t ahead;                  /* sequence past newest     */
+uint8_t behind;                 /* sequence before newest   */
+
+/*----------------------------------------------------------
+Senders without sequence numbers are never filtered
+----------------------------------------------------------*/
+if( sequence == 0 || source >= MSG_MAX_MODULES )
+    {
+    return false;
+    }
+
+ahead   = ( uint8_t )( sequence - ctx->rx_sequences[ source ].newest );
+behind  = ( uint8_t )( ctx->rx_sequences[ source ].newest - sequence );
+
+/*----------------------------------------------------------
+Sender restarted, its old sequences may still sit in the
+window so start it over. a copy of the first frame while it
+is still the newest is a duplicate
+----------------------------------------------------------*/
+if( sequence == MSG_FIRST_SEQUENCE && ctx->rx_sequences[ source ].valid && behind != 0 )
+    {
+    ctx->rx_sequences[ source ].seen     = 1;
+    ctx->rx_sequences[ source ].newest   = sequence;
+    return false;
+    }
+
+/*----------------------------------------------------------
+Newer frame, slide window forward
+----------------------------------------------------------*/
+if( ! ctx->rx_sequences[ source ].valid || ( ahead != 0 && ahead < 0x80 ) )
+    {
+    ctx->rx_sequences[ source ].seen = ( ctx->rx_sequences[ source ].valid && ahead < MSG_DEDUP_WINDOW )
+                                ? ( ctx->rx_sequences[ source ].seen << ahead ) | 1 : 1;
+    ctx->rx_sequences[ source ].newest   = sequence;
+    ctx->rx_sequences[ source ].valid    = true;
+    return false;
+    }
+
+/*----------------------------------------------------------
+Older frame inside window, check its bit
+----------------------------------------------------------*/
+if( behind < MSG_DEDUP_WINDOW )
+    {
+    if( ( ctx->rx_sequences[ source ].seen >> behind ) & 1 )
+        {
+        return true;
+        }
+
+    ctx->rx_sequences[ source ].seen |= ( uint32_t ) 1 << behind;
+    return false;
+    }
+
+ctx->rx_sequences[ source ].seen     = 1;
+ctx->rx_sequences[ source ].newest   = sequence;
+
+return false;
+
+} /* is_duplicate() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       find_route
+*
+*   DESCRIPTION:
+*       look up next hop table entry for destination
+*
+*   RETURN:
+*       entry, NULL if destination is sent to directly
+*
+*********************************************************************/
+static const msg_route * find_route
+    (
+    const message_ctx *ctx,
+    location destination
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t i;                      /* iterator                 */
+
+for( i = 0; i < MSG_ROUTE_COUNT; i++ )
+    {
+    if( ctx->routes[ i ].in_use && ctx->routes[ i ].destination == destination )
+        {
+        return &ctx->routes[ i ];
+        }
+    }
+
+return NULL;
+
+} /* find_route() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       relay_frame
+*
+*   DESCRIPTION:
+*       forward a routed frame toward its final destination. the
+*       destination byte is rewritten to the next hop, ttl is
+*       counted down and the crc redone; source, key and sequence
+*       are left as the sender wrote them. secure frames keep their
+*       tag, which does not cover the bytes changed. frames this
+*       relay has already forwarded, including copies heard back
+*       from other relays, are dropped
+*
+*********************************************************************/
+static void relay_frame
+    (
+    message_ctx *ctx,
+    const uint8_t frame[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t copy[ MAX_LORA_MSG_SIZE ];      /* frame being forwarded    */
+const msg_route *route;                 /* next hop for destination */
+uint8_t data_size;                      /* v2 data size             */
+uint8_t option_size;                    /* v2 option bytes          */
+uint8_t flags;                          /* v2 flags                 */
+uint8_t route_index;                    /* final destination byte   */
+uint16_t seen;                          /* source << 8 | sequence   */
+uint32_t start;                         /* clock at arrival         */
+uint32_t elapsed;                       /* time spent forwarding    */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start = ( ctx->relay_clock != NULL ) ? ctx->relay_clock() : 0;
+
+if( ! frame_layout( frame, &data_size, &option_size, &flags )
+ || ! ( flags & FLAG_ROUTE ) || frame[ SOURCE_BYTE ] == ctx->module )
+    {
+    return;
+    }
+
+route_index = DATA_START_BYTE + option_size - MSG_ROUTE_OVERHEAD
+            - ( ( flags & FLAG_SECURE ) ? SECURE_OPTION_BYTES : 0 );
+
+/*----------------------------------------------------------
+Suppress frames already forwarded. every relayed frame
+carries a sequence byte right before the route bytes
+----------------------------------------------------------*/
+seen = ( uint16_t )( ( frame[ SOURCE_BYTE ] << 8 ) | frame[ route_index - 1 ] );
+for( i = 0; i < MSG_RELAY_CACHE_SIZE; i++ )
+    {
+    if( ctx->relay_seen[ i ] == seen )
+        {
+        ctx->relay_stats.duplicates++;
+        return;
+        }
+    }
+
+ctx->relay_seen[ ctx->relay_seen_next ] = seen;
+ctx->relay_seen_next = ( uint8_t )( ( ctx->relay_seen_next + 1 ) % MSG_RELAY_CACHE_SIZE );
+
+if( frame[ route_index + 1 ] == 0 )
+    {
+    ctx->relay_stats.ttl_expired++;
+    return;
+    }
+
+/*----------------------------------------------------------
+Send on to next hop, or straight to the destination when
+no route is set
+----------------------------------------------------------*/
+route = find_route( ctx, frame[ route_index ] );
+
+memcpy( copy, frame, size );
+copy[ DESTINATION_BYTE ]    = ( uint8_t )( ( route != NULL ) ? route->next_hop : frame[ route_index ] );
+copy[ route_index + 1 ]     = frame[ route_index + 1 ] - 1;
+if( ! ( flags & FLAG_SECURE ) )
+    {
+    copy[ size - 1 ] = calculate_crc( copy, size - 1 );
+    }
+
+if( send_frame_ctx( ctx, copy, size ) != RX_NO_ERROR )
+    {
+    ctx->relay_stats.send_errors++;
+    return;
+    }
+
+ctx->relay_stats.forwarded++;
+
+if( ctx->relay_clock != NULL )
+    {
+    elapsed = ctx->relay_clock() - start;
+    ctx->relay_stats.latency_total += elapsed;
+    if( elapsed > ctx->relay_stats.latency_max )
+        {
+        ctx->relay_stats.latency_max = elapsed;
+        }
+    }
+
+} /* relay_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       find_secure_key
+*
+*   DESCRIPTION:
+*       key shared with peer, else the network key
+*
+*   RETURN:
+*       key, NULL if neither is set
+*
+*********************************************************************/
+static const ascon_key * find_secure_key
+    (
+    const message_ctx *ctx,
+    location peer
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+const ascon_key *network;               /* key for MSG_BROADCAST    */
+uint8_t i;                              /* iterator                 */
+
+network = NULL;
+for( i = 0; i < MSG_SECURE_KEYS; i++ )
+    {
+    if( ! ctx->secure_keys[ i ].in_use )
+        {
+        continue;
+        }
+
+    if( ctx->secure_keys[ i ].peer == peer )
+        {
+        return &ctx->secure_keys[ i ].key;
+        }
+
+    if( ctx->secure_keys[ i ].peer == MSG_BROADCAST )
+        {
+        network = &ctx->secure_keys[ i ].key;
+        }
+    }
+
+return network;
+
+} /* find_secure_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       secure_ad
+*
+*   DESCRIPTION:
+*       gather the header bytes a secure frame authenticates. the
+*       destination byte and ttl are left out as relays rewrite
+*       them, the final destination is used in their place
+*
+*   RETURN:
+*       bytes written to ad[]
+*
+*********************************************************************/
+static uint8_t secure_ad
+    (
+    const uint8_t frame[],
+    location destination,
+    uint8_t counter_index,
+    uint8_t ad[]
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t size;                           /* bytes in ad[]            */
+uint8_t fixed;                          /* port and sequence bytes  */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+fixed = ( ( frame[ VERSION_BYTE ] & FLAG_PORT ) ? 1 : 0 )
+      + ( ( frame[ VERSION_BYTE ] & FLAG_SEQUENCE ) ? 1 : 0 );
+
+ad[ 0 ] = ( uint8_t ) destination;
+memcpy( &ad[ 1 ], &frame[ SOURCE_BYTE ], HEADER_BYTE_COUNT - 1 );
+size = HEADER_BYTE_COUNT;
+
+memcpy( &ad[ size ], &frame[ DATA_START_BYTE ], fixed );
+size += fixed;
+
+memcpy( &ad[ size ], &frame[ counter_index ], MSG_COUNTER_SIZE );
+size += MSG_COUNTER_SIZE;
+
+return size;
+
+} /* secure_ad() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       seal_frame
+*
+*   DESCRIPTION:
+*       encrypt the data of an encoded frame in place and write the
+*       tag, all but its last byte after the counter and the last
+*       byte where the crc would go. the nonce is the source and
+*       the frame counter, so a key never sees a nonce twice
+*
+*********************************************************************/
+static void seal_frame
+    (
+    message_ctx *ctx,
+    const ascon_key *key,
+    uint8_t frame[],
+    location destination,
+    uint8_t counter_index,
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t ad[ MAX_AD_BYTES ];             /* associated data          */
+uint8_t nonce[ ASCON_NONCE_SIZE ];      /* source and counter       */
+uint8_t tag[ MSG_TAG_SIZE ];            /* tag of frame             */
+uint8_t ad_size;                        /* bytes in ad[]            */
+uint8_t data_index;                     /* first data byte          */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( nonce, 0, sizeof( nonce ) );
+nonce[ 0 ] = frame[ SOURCE_BYTE ];
+memcpy( &nonce[ 1 ], &frame[ counter_index ], MSG_COUNTER_SIZE );
+ad_size     = secure_ad( frame, destination, counter_index, ad );
+data_index  = counter_index + SECURE_OPTION_BYTES;
+
+ascon_encrypt( key, nonce, ad, ad_size, &frame[ data_index ], size - data_index - 1, tag, MSG_TAG_SIZE );
+
+memcpy( &frame[ counter_index + MSG_COUNTER_SIZE ], tag, MSG_TAG_SIZE - 1 );
+frame[ size - 1 ] = tag[ MSG_TAG_SIZE - 1 ];
+
+ctx->secure_stats.encrypted++;
+
+} /* seal_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       open_frame
+*
+*   DESCRIPTION:
+*       check the tag of a secure frame and decrypt its data in
+*       place. frames sent to this module use the key shared with
+*       the source, group frames the network key. the counter must
+*       be newer than the last one taken from the source
+*
+*   RETURN:
+*       RX_CRC_ERROR on a bad tag, RX_KEY_ERR with no key or on a
+*       replayed counter
+*
+*********************************************************************/
+static lora_errors open_frame
+    (
+    message_ctx *ctx,
+    uint8_t frame[],
+    uint8_t size,
+    const msg_view *view
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t ad[ MAX_AD_BYTES ];             /* associated data          */
+uint8_t nonce[ ASCON_NONCE_SIZE ];      /* source and counter       */
+uint8_t tag[ MSG_TAG_SIZE ];            /* tag received             */
+uint8_t ad_size;                        /* bytes in ad[]            */
+uint8_t data_index;                     /* first data byte          */
+uint8_t counter_index;                  /* first counter byte       */
+uint32_t counter;                       /* frame counter            */
+location source;                        /* sending module           */
+const ascon_key *key;                   /* key for source           */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+source          = frame[ SOURCE_BYTE ];
+data_index      = ( uint8_t )( view->payload - frame );
+counter_index   = data_index - SECURE_OPTION_BYTES;
+counter         = ( ( uint32_t ) frame[ counter_index ] << 24 )
+                | ( ( uint32_t ) frame[ counter_index + 1 ] << 16 )
+                | ( ( uint32_t ) frame[ counter_index + 2 ] << 8 )
+                | frame[ counter_index + 3 ];
+key             = find_secure_key( ctx, ( view->destination == ctx->module ) ? source : MSG_BROADCAST );
+
+if( key == NULL || source >= MSG_MAX_MODULES )
+    {
+    ctx->secure_stats.no_key++;
+    return RX_KEY_ERR;
+    }
+
+if( counter <= ctx->rx_counters[ source ] )
+    {
+    ctx->secure_stats.replayed++;
+    return RX_KEY_ERR;
+    }
+
+/*----------------------------------------------------------
+Check tag and decrypt
+----------------------------------------------------------*/
+memset( nonce, 0, sizeof( nonce ) );
+nonce[ 0 ] = source;
+memcpy( &nonce[ 1 ], &frame[ counter_index ], MSG_COUNTER_SIZE );
+memcpy( tag, &frame[ counter_index + MSG_COUNTER_SIZE ], MSG_TAG_SIZE - 1 );
+tag[ MSG_TAG_SIZE - 1 ] = frame[ size - 1 ];
+ad_size = secure_ad( frame, view->destination, counter_index, ad );
+
+if( ! ascon_decrypt( key, nonce, ad, ad_size, &frame[ data_index ], view->size, tag, MSG_TAG_SIZE ) )
+    {
+    ctx->secure_stats.auth_failed++;
+    return RX_CRC_ERROR;
+    }
+
+ctx->rx_counters[ source ] = counter;
+ctx->secure_stats.decrypted++;
+
+return RX_NO_ERROR;
+
+} /* open_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       decode_frame
+*
+*   DESCRIPTION:
+*       decode frame at rx_offset into view and step past it. frames
+*       for other modules are skipped on their destination and size
+*       bytes alone, before any crc work. a frame that fails its
+*       size, crc or tag check leaves no trustworthy boundary so the
+*       rest of the buffer is dropped with it. secure frames are
+*       decrypted in place
+*
+*   RETURN:
+*       T/F message for current location y/n
+*
+*********************************************************************/
+static bool decode_frame
+    (
+    message_ctx *ctx,          /* context                           */
+    msg_view *view,            /* view to fill in                   */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t *frame;                              /* start of frame in rx_buffer  */
+uint8_t frame_size;                          /* bytes used by frame          */
+uint8_t option_size;                         /* v2 option bytes in frame     */
+uint8_t flags;                               /* v2 flags of frame            */
+uint8_t remaining;                           /* bytes left in rx_buffer      */
+uint8_t data_size;                           /* data bytes in frame          */
+bool sealed;                                 /* secure frame                 */
+bool in_transit;                             /* sealed, only to be relayed   */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+frame       = &ctx->rx_buffer[ ctx->rx_offset ];
+remaining   = ctx->rx_size - ctx->rx_offset;
+*errors     = RX_NO_ERROR;
+view->valid = false;
+in_transit  = false;
+
+ctx->filter_stats.frames_seen++;
+
+/*----------------------------------------------------------
+Drop frames for other modules before decoding them
+----------------------------------------------------------*/
+if( remaining >= MINIMUM_MSG_LENGTH && ! address_match( ctx, frame[ DESTINATION_BYTE ] ) )
+    {
+    ctx->filter_stats.frames_filtered++;
+
+    if( ! frame_layout( frame, &frame_size, &option_size, &flags )
+     || frame_size + option_size + MINIMUM_MSG_LENGTH > remaining )
+        {
+        ctx->rx_offset = ctx->rx_size;
+        }
+    else
+        {
+        ctx->rx_offset += frame_size + option_size + MINIMUM_MSG_LENGTH;
+        }
+
+    /*----------------------------
+    module registry is not up to
+    date
+    ----------------------------*/
+    if( ! module_known( ctx, frame[ DESTINATION_BYTE ] ) && frame[ DESTINATION_BYTE ] < MSG_GROUP_BASE )
+        {
+        *errors = RX_INVALID_HEADER;
+        }
+
+    return false;
+    }
+
+/*----------------------------------------------------------
+Convert message
+----------------------------------------------------------*/
+frame_size = covert_message( frame, remaining, view, errors );
+
+/*----------------------------------------------------------
+Verify message
+----------------------------------------------------------*/
+if ( *errors == RX_NO_ERROR )
+    {
+    ctx->rx_offset += frame_size;
+    sealed = ( ( frame[ VERSION_BYTE ] & VERSION_MASK ) >> 4 == API_VERSION_2 )
+          && ( frame[ VERSION_BYTE ] & FLAG_SECURE );
+
+    /*----------------------------------------------------------
+    Calculate and verify CRC, or tag, and key. secure frames
+    only passing through are relayed unopened, their tag is
+    checked where they end up
+    ----------------------------------------------------------*/
+    if( sealed && ! address_match( ctx, view->destination ) )
+        {
+        in_transit = true;
+        }
+    else if( sealed )
+        {
+        *errors = open_frame( ctx, frame, frame_size, view );
+        if( *errors == RX_CRC_ERROR )
+            {
+            ctx->rx_offset = ctx->rx_size;
+            }
+        }
+    else if ( frame[ frame_size - 1 ] != calculate_crc( frame, frame_size - 1 ) )
+        {
+        *errors = RX_CRC_ERROR;
+        ctx->rx_offset = ctx->rx_size;
+        }
+    else if( ctx->secure )
+        {
+        ctx->secure_stats.plain_rejected++;
+        *errors = RX_KEY_ERR;
+        }
+
+    /*----------------------------------------------------------
+    The key byte is the key epoch, during a rotation the key
+    on either side of it is taken as well
+    ----------------------------------------------------------*/
+    if( *errors == RX_NO_ERROR && ! in_transit )
+        {
+        if ( view->key == ctx->key )
+            {
+            view->valid = true;
+            }
+        else if( grace_key_match( ctx, view->key ) )
+            {
+            ctx->filter_stats.frames_grace_key++;
+            view->valid = true;
+            }
+        else
+            {
+            *errors = RX_KEY_ERR;
+            }
+        }
+    }
+else
+    {
+    /*----------------------------------------------------------
+    Since errors were detected, drop rest of buffer
+    ----------------------------------------------------------*/
+    ctx->rx_offset = ctx->rx_size;
+
+    if( remaining < MINIMUM_MSG_LENGTH )
+        {
+        return false;
+        }
+    }
+
+/*----------------------------------------------------------
+Relay frames on their way to another module. only those
+also sent to a group this module is in are kept, less
+this module's own frames flooded back to it
+----------------------------------------------------------*/
+if( ( view->valid || in_transit ) && view->destination != ctx->module )
+    {
+    if( ctx->relay_enabled )
+        {
+        relay_frame( ctx, frame, frame_size );
+        }
+
+    if( ! address_match( ctx, view->destination )
+     || ( frame[ SOURCE_BYTE ] == ctx->module
+       && frame_layout( frame, &data_size, &option_size, &flags ) && ( flags & FLAG_ROUTE ) ) )
+        {
+        ctx->filter_stats.frames_filtered++;
+        return false;
+        }
+    }
+
+/*----------------------------------------------------------
+Verify source location
+----------------------------------------------------------*/
+if( ! module_known( ctx, view->source ) )
+    {
+    view->source = INVALID_LOCATION;
+    }
+
+/*----------------------------------------------------------
+Drop frames already delivered from this source
+----------------------------------------------------------*/
+if( view->valid && is_duplicate( ctx, view->source, view->sequence ) )
+    {
+    ctx->filter_stats.frames_duplicate++;
+    count_rx_error( ctx, RX_DOUBLE );
+    return false;
+    }
+
+/*----------------------------------------------------------
+Frames with errors are still returned to be counted, only
+good ones are accepted
+----------------------------------------------------------*/
+if( *errors == RX_NO_ERROR && view->valid )
+    {
+    ctx->filter_stats.frames_accepted++;
+    }
+
+return true;
+
+} /* decode_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       decode_next_frame
+*
+*   DESCRIPTION:
+*       decode frame at rx_offset, count and time it, then hand
+*       frames for a registered service port to their handler.
+*       handler time is left out of the decode histogram
+*
+*   RETURN:
+*       T/F message for the caller y/n
+*
+*********************************************************************/
+static bool decode_next_frame
+    (
+    message_ctx *ctx,          /* context                           */
+    msg_view *view,            /* view to fill in                   */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+bool accepted;                               /* frame for this module        */
+#if( MSG_STATS )
+uint32_t start;                              /* clock before decoding        */
+uint8_t offset;                              /* start of frame in rx_buffer  */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start   = stats_now( ctx );
+offset  = ctx->rx_offset;
+#endif
+
+accepted = decode_frame( ctx, view, errors );
+
+#if( MSG_STATS )
+record_rx( ctx, view, accepted, &ctx->rx_buffer[ offset ], ( uint8_t )( ctx->rx_offset - offset ), *errors, start );
+#endif
+
+/*----------------------------------------------------------
+Hand frames for a registered service port to its handler
+----------------------------------------------------------*/
+if( accepted && view->valid && view->port != MSG_PORT_APP && view->port < MSG_PORT_COUNT
+ && ctx->port_handlers[ view->port ].handler != NULL )
+    {
+    ctx->port_handlers[ view->port ].handler( view, ctx->port_handlers[ view->port ].arg );
+    return false;
+    }
+
+return accepted;
+
+} /* decode_next_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       copy_view
+*
+*   DESCRIPTION:
+*       copy decoded frame into caller owned rx_message
+*
+*   RETURN:
+*       T/F data fit in rx_message y/n
+*
+*********************************************************************/
+static bool copy_view
+    (
+    const msg_view *view,      /* decoded frame                     */
+    rx_message *message        /* message to fill in                */
+    )
+{
+
+message->source = view->source;
+
+/*----------------------------------------------------------
+v2 data larger than this build's rx_message can only be
+read through get_message_view
+----------------------------------------------------------*/
+if( view->size > MAX_MSG_LENGTH )
+    {
+    message->size   = 0;
+    message->valid  = false;
+    return false;
+    }
+
+message->size   = view->size;
+message->valid  = view->valid;
+memcpy( message->message, view->payload, view->size );
+
+return true;
+
+} /* copy_view() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_message_view_ctx
+*
+*   DESCRIPTION:
+*       receive next message without copying it. view points into
+*       the receive buffer and stays valid until the next receive
+*       call. frames left over from a buffer holding several
+*       back-to-back frames are returned before the transport is
+*       read again
+*
+*   RETURN:
+*       T/F message received y/n
+*
+*********************************************************************/
+bool get_message_view_ctx
+    (
+    message_ctx *ctx,          /* context                           */
+    msg_view *view,            /* view of message received          */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+
+/*----------------------------------------------------------
+Read transport once all buffered frames were handed out
+----------------------------------------------------------*/
+if( ctx->rx_offset >= ctx->rx_size && ! fill_rx_buffer( ctx, errors ) )
+    {
+    return false;
+    }
+
+return decode_next_frame( ctx, view, errors );
+
+} /* get_message_view_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_message_ctx
+*
+*   DESCRIPTION:
+*       procedure for receiving messages in messageAPI format 
+*       through LoRa
+*
+*   RETURN:
+*       T/F message received y/n
+*
+*********************************************************************/
+bool get_message_ctx
+    (
+    message_ctx *ctx,          /* context                           */
+    rx_message *message,       /* pointer to store message received */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_view view;                               /* view into rx_buffer          */
+
+/*----------------------------------------------------------
+Only application data fits an rx_message
+----------------------------------------------------------*/
+if( ! get_message_view_ctx( ctx, &view, errors ) || view.port != MSG_PORT_APP )
+    {
+    return false;
+    }
+
+if( ! copy_view( &view, message ) )
+    {
+    *errors = RX_ARRAY_SIZE_ERR;
+    }
+
+return true;
+
+} /* get_message_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_messages_ctx
+*
+*   DESCRIPTION:
+*       walk every frame of the next receive buffer and store each
+*       message for the current location in messages[]. frames
+*       beyond max_messages are kept for the next call. errors
+*       holds the last error seen, RX_NO_ERROR if every frame
+*       decoded cleanly
+*
+*   RETURN:
+*       number of messages stored
+*
+*********************************************************************/
+uint8_t get_messages_ctx
+    (
+    message_ctx *ctx,          /* context                           */
+    rx_message messages[],     /* array to store messages received  */
+    uint8_t max_messages,      /* size of messages[]                */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t count;                               /* messages stored              */
+lora_errors frame_errors;                    /* errors from current frame    */
+msg_view view;                               /* view into rx_buffer          */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+count           = 0;
+frame_errors    = RX_NO_ERROR;
+*errors         = RX_NO_ERROR;
+
+/*----------------------------------------------------------
+Read transport once all buffered frames were handed out
+----------------------------------------------------------*/
+if( ctx->rx_offset >= ctx->rx_size && ! fill_rx_buffer( ctx, errors ) )
+    {
+    return 0;
+    }
+
+/*----------------------------------------------------------
+Demultiplex frames in buffer
+----------------------------------------------------------*/
+while( ctx->rx_offset < ctx->rx_size && count < max_messages )
+    {
+    if( decode_next_frame( ctx, &view, &frame_errors ) && view.port == MSG_PORT_APP )
+        {
+        if( ! copy_view( &view, &messages[ count ] ) )
+            {
+            frame_errors = RX_ARRAY_SIZE_ERR;
+            }
+        count++;
+        }
+
+    if( frame_errors != RX_NO_ERROR )
+        {
+        *errors = frame_errors;
+        }
+    }
+
+return count;
+
+} /* get_messages_ctx() */
+
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       encode_frame
+*
+*   DESCRIPTION:
+*       write header and crc around data straight into frame[],
+*       which must hold size + MSG_MAX_FRAME_OVERHEAD bytes. data may
+*       already sit in frame[] at MSG_DATA_OFFSET (or at
+*       MSG_PORT_DATA_OFFSET for a port frame). data that fits a v1
+*       frame is sent as v1 so older modules can still read it,
+*       larger data or data for a service port uses a v2 frame.
+*       every frame takes the next sequence number. in secure mode
+*       every frame is v2, sealed with the key for its destination
+*
+*   RETURN:
+*       size of frame, 0 if data is too large or there is no key
+*
+*********************************************************************/
+static uint8_t encode_frame
+    (
+    message_ctx *ctx,               /* context                      */
+    const msg_header *header,       /* destination and options      */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t array_size;                             /* size of frame[]            */
+uint8_t crc;                                    /* crc of frame so far        */
+uint8_t options[ MAX_OPTION_BYTES ];            /* v2 option bytes            */
+uint8_t option_size;                            /* v2 option bytes used       */
+uint8_t flags;                                  /* v2 flags                   */
+uint8_t *frame_data;                            /* start of data in frame[]   */
+const msg_route *route;                         /* next hop to destination    */
+const ascon_key *key;                           /* secure mode key            */
+uint8_t counter_index;                          /* counter option in frame[]  */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+flags           = 0;
+option_size     = 0;
+counter_index   = 0;
+route           = find_route( ctx, header->destination );
+key             = NULL;
+
+/*----------------------------------------------------------
+Secure frames need a key and a counter not used before
+----------------------------------------------------------*/
+if( ctx->secure )
+    {
+    key = find_secure_key( ctx, ( header->destination < MSG_GROUP_BASE ) ? header->destination : MSG_BROADCAST );
+    if( key == NULL )
+        {
+        ctx->secure_stats.no_key++;
+        return 0;
+        }
+
+    if( ctx->tx_counter == UINT32_MAX )
+        {
+        return 0;
+        }
+    }
+
+/*----------------------------------------------------------
+Take next sequence number, 0 is left for senders without
+and MSG_FIRST_SEQUENCE marks the first frame after start,
+so the count wraps past both
+----------------------------------------------------------*/
+ctx->tx_sequence++;
+if( ctx->tx_sequence == 0 )
+    {
+    ctx->tx_sequence = MSG_FIRST_SEQUENCE + 1;
+    }
+
+/*----------------------------------------------------------
+v1 frames carry the sequence in the old pad byte, v2
+frames add it as an option byte. destinations reached
+through a relay need v2 for the route bytes
+----------------------------------------------------------*/
+if( header->port != MSG_PORT_APP || size > MAXIMUM_MSG_LENGTH || route != NULL || key != NULL )
+    {
+    if( header->port != MSG_PORT_APP )
+        {
+        flags |= FLAG_PORT;
+        options[ option_size++ ] = header->port;
+        }
+
+    flags |= FLAG_SEQUENCE;
+    options[ option_size++ ] = ctx->tx_sequence;
+
+    if( route != NULL )
+        {
+        flags |= FLAG_ROUTE;
+        options[ option_size++ ] = ( uint8_t ) header->destination;
+        options[ option_size++ ] = MSG_ROUTE_TTL;
+        }
+
+    if( key != NULL )
+        {
+        flags |= FLAG_SECURE;
+        counter_index = DATA_START_BYTE + option_size;
+        ctx->tx_counter++;
+        options[ option_size++ ] = ( uint8_t )( ctx->tx_counter >> 24 );
+        options[ option_size++ ] = ( uint8_t )( ctx->tx_counter >> 16 );
+        options[ option_size++ ] = ( uint8_t )( ctx->tx_counter >> 8 );
+        options[ option_size++ ] = ( uint8_t )( ctx->tx_counter );
+        memset( &options[ option_size ], 0, MSG_TAG_SIZE - 1 );
+        option_size += MSG_TAG_SIZE - 1;
+        }
+    }
+
+frame_data = &frame[ DATA_START_BYTE + option_size ];
+
+/*----------------------------------------------------------
+Verify message size
+----------------------------------------------------------*/
+if( size + option_size > MAX_DATA_AND_OPTIONS )
+    {
+    return 0;
+    }
+
+/*----------------------------------------------------------
+Convert data to array
+
+Byte 0 -- destination byte
+Byte 1 -- source byte
+Byte 2 -- v1: sequence (old pad) / v2: size byte
+Byte 3 -- v1: version/size byte (upper/lower bits)
+          v2: version/flags byte (upper/lower bits)
+Byte 4 -- key byte
+Byte 5 -- v2: option bytes selected by flags (port, sequence,
+          final destination and ttl, counter and tag)
+Byte 5 -- start of data region (after any option bytes)
+Byte X -- crc, or last tag byte (last byte)
+----------------------------------------------------------*/
+frame[ DESTINATION_BYTE ] = ( uint8_t )( ( route != NULL ) ? route->next_hop : header->destination );
+frame[ SOURCE_BYTE ] = ( uint8_t ) ctx->module;
+frame[ KEY_BYTE ] = ctx->key;
+
+if( flags == 0 )
+    {
+    frame[ SEQUENCE_BYTE ] = ctx->tx_sequence;
+    frame[ SIZE_BYTE ] = ( API_VERSION << 4 ) + size;
+    }
+else
+    {
+    frame[ SIZE_V2_BYTE ] = size;
+    frame[ VERSION_BYTE ] = ( API_VERSION_2 << 4 ) | flags;
+    }
+
+/*----------------------------------------------------------
+Calulate CRC as the frame is built, header first then
+data while it is still in cache. data built in place at
+MSG_DATA_OFFSET is moved past the option bytes before they
+are written. crc goes in last byte, or the frame is sealed
+once it is complete
+----------------------------------------------------------*/
+crc = crc8_init();
+if( key == NULL )
+    {
+    crc = crc8_update( crc, frame, HEADER_BYTE_COUNT );
+    crc = crc8_update( crc, options, option_size );
+    crc = crc8_update( crc, data, size );
+    }
+
+if( data != frame_data )
+    {
+    memmove( frame_data, data, size );
+    }
+
+memcpy( &frame[ DATA_START_BYTE ], options, option_size );
+
+array_size = size + option_size + MINIMUM_MSG_LENGTH;
+
+if( key != NULL )
+    {
+    seal_frame( ctx, key, frame, header->destination, counter_index, array_size );
+    }
+else
+    {
+    frame[ array_size - 1 ] = crc8_final( crc );
+    }
+
+return array_size;
+
+} /* encode_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       encode_message_header_ctx
+*
+*   DESCRIPTION:
+*       encode data for header into frame[], see encode_frame. the
+*       time taken goes into the encode histogram
+*
+*   RETURN:
+*       size of frame, 0 if data is too large or there is no key
+*
+*********************************************************************/
+uint8_t encode_message_header_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    const msg_header *header,       /* destination and options      */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    )
+{
+#if( MSG_STATS )
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t start;                                 /* clock before encoding      */
+uint8_t array_size;                             /* size of frame[]            */
+
+if( ctx->stats_clock == NULL )
+    {
+    return encode_frame( ctx, header, data, size, frame );
+    }
+
+start       = ctx->stats_clock();
+array_size  = encode_frame( ctx, header, data, size, frame );
+record_latency( &ctx->stats.encode, ctx->stats_clock() - start );
+
+return array_size;
+#else
+return encode_frame( ctx, header, data, size, frame );
+#endif
+
+} /* encode_message_header_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       encode_message_ctx
+*
+*   DESCRIPTION:
+*       write application data frame for destination into frame[],
+*       see encode_message_header
+*
+*   RETURN:
+*       size of frame, 0 if data is too large
+*
+*********************************************************************/
+uint8_t encode_message_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_header header;                              /* plain application header   */
+
+memset( &header, 0, sizeof( header ) );
+header.destination  = destination;
+header.port         = MSG_PORT_APP;
+
+return encode_message_header_ctx( ctx, &header, data, size, frame );
+
+} /* encode_message_ctx() */
+
+#if( MSG_STATS )
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       record_latency
+*
+*   DESCRIPTION:
+*       add a sample to a histogram, bucket n holds samples of n
+*       significant bits
+*
+*********************************************************************/
+static void record_latency
+    (
+    msg_latency *latency,      /* histogram to add to               */
+    uint32_t ticks             /* sample                            */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t bucket;                              /* histogram bucket             */
+
+#if defined( __GNUC__ )
+bucket = ( ticks == 0 ) ? 0 : ( uint8_t )( 32 - __builtin_clz( ticks ) );
+#else
+bucket = 0;
+while( bucket < 32 && ( ticks >> bucket ) != 0 )
+    {
+    bucket++;
+    }
+#endif
+
+if( bucket >= MSG_LATENCY_BUCKETS )
+    {
+    bucket = MSG_LATENCY_BUCKETS - 1;
+    }
+
+latency->count++;
+latency->total += ticks;
+latency->buckets[ bucket ]++;
+if( ticks > latency->max )
+    {
+    latency->max = ticks;
+    }
+
+} /* record_latency() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       record_rx
+*
+*   DESCRIPTION:
+*       count a decoded frame by result and source and trace it.
+*       frames filtered on their address are only timed
+*
+*********************************************************************/
+static void record_rx
+    (
+    message_ctx *ctx,          /* context                           */
+    const msg_view *view,      /* decoded frame                     */
+    bool accepted,             /* frame taken for this module       */
+    const uint8_t frame[],     /* start of frame in rx_buffer       */
+    uint8_t size,              /* rx_buffer bytes used by frame     */
+    lora_errors errors,        /* result of the frame               */
+    uint32_t start             /* clock before decoding             */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t ticks;                              /* decode time                  */
+msg_trace_event event;                       /* traced frame                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+ticks = 0;
+
+if( ctx->stats_clock != NULL )
+    {
+    ticks = ctx->stats_clock() - start;
+    record_latency( &ctx->stats.decode, ticks );
+    }
+
+if( errors != RX_NO_ERROR )
+    {
+    count_rx_error( ctx, errors );
+    }
+else if( ! accepted )
+    {
+    return;
+    }
+else if( view->valid && view->source < MSG_MAX_MODULES )
+    {
+    ctx->stats.peers[ view->source ].rx_frames++;
+    ctx->stats.peers[ view->source ].rx_bytes += size;
+    }
+
+if( ctx->trace_hook != NULL )
+    {
+    event.type      = MSG_TRACE_RX;
+    event.peer      = ( size > SOURCE_BYTE ) ? frame[ SOURCE_BYTE ] : INVALID_LOCATION;
+    event.size      = size;
+    event.errors    = errors;
+    event.ticks     = ticks;
+    ctx->trace_hook( &event, ctx->trace_arg );
+    }
+
+} /* record_rx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       record_tx
+*
+*   DESCRIPTION:
+*       count a sent frame by result and destination byte, time it
+*       and trace it
+*
+*********************************************************************/
+static void record_tx
+    (
+    message_ctx *ctx,          /* context                           */
+    const uint8_t frame[],     /* frame sent                        */
+    uint8_t size,              /* size of frame[]                   */
+    lora_errors errors,        /* result of the send                */
+    uint32_t start             /* clock before sending              */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t ticks;                              /* send time                    */
+msg_trace_event event;                       /* traced frame                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+ticks = 0;
+
+if( ctx->stats_clock != NULL )
+    {
+    ticks = ctx->stats_clock() - start;
+    record_latency( &ctx->stats.transmit, ticks );
+    }
+
+if( ( uint32_t ) errors < MSG_ERROR_COUNT )
+    {
+    ctx->stats.tx_errors[ errors ]++;
+    }
+
+if( errors == RX_NO_ERROR && frame[ DESTINATION_BYTE ] < MSG_MAX_MODULES )
+    {
+    ctx->stats.peers[ frame[ DESTINATION_BYTE ] ].tx_frames++;
+    ctx->stats.peers[ frame[ DESTINATION_BYTE ] ].tx_bytes += size;
+    }
+
+if( ctx->trace_hook != NULL )
+    {
+    event.type      = MSG_TRACE_TX;
+    event.peer      = frame[ DESTINATION_BYTE ];
+    event.size      = size;
+    event.errors    = errors;
+    event.ticks     = ticks;
+    ctx->trace_hook( &event, ctx->trace_arg );
+    }
+
+} /* record_tx() */
+#endif
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       transmit_frame
+*
+*   DESCRIPTION:
+*       hand frame to the transport, counting and timing the send
+*
+*********************************************************************/
+static lora_errors transmit_frame
+    (
+    message_ctx *ctx,               /* context                      */
+    uint8_t frame[],                /* encoded frame                */
+    uint8_t size                    /* size of frame[]              */
+    )
+{
+#if( MSG_STATS )
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t start;                                 /* clock before sending       */
+lora_errors errors;                             /* lora related errors        */
+
+start   = stats_now( ctx );
+errors  = ctx->transport.send( ctx->transport.port, frame, size );
+record_tx( ctx, frame, size, errors, start );
+
+return errors;
+#else
+return ctx->transport.send( ctx->transport.port, frame, size );
+#endif
+
+} /* transmit_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_frame_ctx
+*
+*   DESCRIPTION:
+*       transmit a frame built by encode_message and put the radio
+*       back into rx mode
+*
+*   RETURN:
+*       RX_ARRAY_SIZE_ERR when size is 0 (the encode failed)
+*
+*********************************************************************/
+lora_errors send_frame_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    uint8_t frame[],                /* encoded frame                */
+    uint8_t size                    /* size of frame[]              */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_errors errors;                             /* lora related errors        */
+
+/*----------------------------------------------------------
+A size of 0 is an encode that failed, there is no frame
+----------------------------------------------------------*/
+if( size == 0 )
+    {
+    return RX_ARRAY_SIZE_ERR;
+    }
+
+/*----------------------------------------------------------
+Send message
+----------------------------------------------------------*/
+errors = transmit_frame( ctx, frame, size );
+
+/*----------------------------------------------------------
+Revert to rx continious mode
+----------------------------------------------------------*/
+if( ! ctx->transport.rx_mode( ctx->transport.port ) )
+    {
+    errors = RX_INIT_ERR;
+    }
+
+/*----------------------------------------------------------
+return errors
+----------------------------------------------------------*/
+return errors;
+
+} /* send_frame_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_data_ctx
+*
+*   DESCRIPTION:
+*       send data[] to destination without staging it in a
+*       tx_message first
+*
+*********************************************************************/
+lora_errors send_data_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size                    /* size of data[]               */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t message_array[ MAX_FRAME_LENGTH ];      /* array to send through LoRa */
+uint8_t array_size;                             /* size of message_array[]    */
+
+/*----------------------------------------------------------
+Larger data must be encoded into a caller buffer
+----------------------------------------------------------*/
+if( size > MAX_MSG_LENGTH )
+    {
+    return RX_ARRAY_SIZE_ERR;
+    }
+
+/*----------------------------------------------------------
+Convert data to array
+----------------------------------------------------------*/
+array_size = encode_message_ctx( ctx, destination, data, size, message_array );
+if( array_size == 0 )
+    {
+    return RX_ARRAY_SIZE_ERR;
+    }
+
+return send_frame_ctx( ctx, message_array, array_size );
+
+} /* send_data_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_message_ctx
+*
+*   DESCRIPTION:
+*       procedure for sending messages in messageAPI format 
+*       through LoRa
+*
+*********************************************************************/
+lora_errors send_message_ctx
+    (
+    message_ctx *ctx,                            /* context         */
+    tx_message message                           /* message to send */
+    )
+{
+
+return send_data_ctx( ctx, message.destination, message.message, message.size );
+
+} /* send_message_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_messages_ctx
+*
+*   DESCRIPTION:
+*       send a burst of messages. frames are encoded into the burst
+*       buffer up front and sent back-to-back, the radio is put
+*       back into rx mode once after the last frame. errors[i] holds
+*       the result for messages[i]
+*
+*   RETURN:
+*       RX_NO_ERROR if every message was sent, else the last error
+*
+*********************************************************************/
+lora_errors send_messages_ctx
+    (
+    message_ctx *ctx,                           /* context          */
+    const tx_message messages[],                /* messages to send */
+    uint8_t count,                              /* size of messages[] */
+    lora_errors errors[]            /* per message errors, or NULL  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_errors burst_errors;                       /* overall burst result       */
+lora_errors frame_errors;                       /* result of one message      */
+uint8_t frame_sizes[ MSG_BURST_MESSAGES ];      /* size of each encoded frame */
+uint16_t used;                                  /* burst_buffer bytes in use  */
+uint8_t first;                                  /* first message of chunk     */
+uint8_t last;                                   /* end of chunk               */
+uint8_t i;                                      /* interator                  */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+burst_errors    = RX_NO_ERROR;
+first           = 0;
+
+/*----------------------------------------------------------
+Bursts larger than the burst buffer go out in chunks,
+still without leaving tx mode in between
+----------------------------------------------------------*/
+while( first < count )
+    {
+    /*----------------------------------------------------------
+    Encode frames up front
+    ----------------------------------------------------------*/
+    used = 0;
+    for( last = first; last < count && ( last - first ) < MSG_BURST_MESSAGES; last++ )
+        {
+        if( used + MAX_FRAME_LENGTH > MSG_BURST_BUFFER_SIZE )
+            {
+            break;
+            }
+
+        frame_sizes[ last - first ] = 0;
+        if( messages[ last ].size <= MAX_MSG_LENGTH )
+            {
+            frame_sizes[ last - first ] = encode_message_ctx( ctx, messages[ last ].destination, messages[ last ].message,
+                                                              messages[ last ].size, &ctx->burst_buffer[ used ] );
+            }
+        used += frame_sizes[ last - first ];
+        }
+
+    /*----------------------------------------------------------
+    Send frames back-to-back
+    ----------------------------------------------------------*/
+    used = 0;
+    for( i = first; i < last; i++ )
+        {
+        if( frame_sizes[ i - first ] == 0 )
+            {
+            frame_errors = RX_ARRAY_SIZE_ERR;
+            }
+        else
+            {
+            frame_errors = transmit_frame( ctx, &ctx->burst_buffer[ used ], frame_sizes[ i - first ] );
+            used += frame_sizes[ i - first ];
+            }
+
+        if( errors != NULL )
+            {
+            errors[ i ] = frame_errors;
+            }
+
+        if( frame_errors != RX_NO_ERROR )
+            {
+            burst_errors = frame_errors;
+            }
+        }
+
+    first = last;
+    }
+
+/*----------------------------------------------------------
+Revert to rx continious mode once for whole burst
+----------------------------------------------------------*/
+if( ! ctx->transport.rx_mode( ctx->transport.port ) )
+    {
+    burst_errors = RX_INIT_ERR;
+    }
+
+return burst_errors;
+
+} /* send_messages_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       init_message_ctx
+*
+*   DESCRIPTION:
+*       set up ctx as module on transport, or on the LoRa API when
+*       transport is NULL. every field of ctx is reset, so service
+*       port handlers are registered after this call. the module
+*       registry starts with the sys_def.h modules and module, and
+*       only MSG_BROADCAST is received until set_group_mask. contexts
+*       share no state and can each be driven from their own thread
+*
+*********************************************************************/
+lora_errors init_message_ctx
+    (
+    message_ctx *ctx,                        /* context             */
+    location module,                         /* this module         */
+    const msg_transport *transport,          /* backend or NULL     */
+    lora_config config_data                  /* SPI Interface info  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_errors init_errors;
+location i;
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+init_errors = RX_NO_ERROR;
+
+/*----------------------------------------------------------
+Initilize context
+----------------------------------------------------------*/
+memset( ctx, 0, sizeof( *ctx ) );
+ctx->module = module;
+set_group_mask_ctx( ctx, 0 );
+
+for( i = 0; i < NUM_OF_MODULES; i++ )
+    {
+    ( void ) register_module_ctx( ctx, i );
+    }
+( void ) register_module_ctx( ctx, module );
+
+if( transport != NULL )
+    {
+    ctx->transport          = *transport;
+    ctx->transport_valid    = true;
+    }
+
+/*----------------------------------------------------------
+Fall back to the LoRa backend if no transport was set
+----------------------------------------------------------*/
+#if( MSG_USE_LORA_TRANSPORT )
+if( ! ctx->transport_valid )
+    {
+    ctx->transport          = lora_transport();
+    ctx->transport_valid    = true;
+    }
+#endif
+
+if( ! ctx->transport_valid )
+    {
+    return RX_INIT_ERR;
+    }
+
+/*----------------------------------------------------------
+Pick crc engine now rather than racing on it from
+several radio threads later
+----------------------------------------------------------*/
+( void ) crc8_selected();
+
+/*----------------------------------------------------------
+Initilize port statics
+----------------------------------------------------------*/
+init_errors = ctx->transport.init( ctx->transport.port, config_data );
+
+/*----------------------------------------------------------
+Put into rx mode
+----------------------------------------------------------*/
+if( init_errors == RX_NO_ERROR && ! ctx->transport.rx_mode( ctx->transport.port ) )
+    {
+    init_errors = RX_INIT_ERR;
+    }
+
+return init_errors;
+
+} /* init_message_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       update_key_ctx
+*
+*   DESCRIPTION:
+*       procedure for updating key used in messageAPI
+*
+*********************************************************************/
+void update_key_ctx
+    (
+    message_ctx *ctx,                                    /* context */
+    uint8_t new_key                                      /* new key */
+    )
+{
+
+ctx->key = new_key;
+
+} /* update_key_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_key_ctx
+*
+*   DESCRIPTION:
+*       key frames are sent with
+*
+*********************************************************************/
+uint8_t get_key_ctx
+    (
+    message_ctx *ctx                                     /* context */
+    )
+{
+
+return ctx->key;
+
+} /* get_key_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rotate_key_ctx
+*
+*   DESCRIPTION:
+*       send with new_key from now on and keep taking frames under
+*       the old key as the grace key, so frames already on their
+*       way are not lost. end the grace window with set_grace_key
+*
+*********************************************************************/
+void rotate_key_ctx
+    (
+    message_ctx *ctx,                                    /* context */
+    uint8_t new_key                                      /* new key */
+    )
+{
+
+if( new_key != ctx->key )
+    {
+    ctx->grace_key       = ctx->key;
+    ctx->grace_key_valid = true;
+    ctx->key             = new_key;
+    }
+
+} /* rotate_key_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_grace_key_ctx
+*
+*   DESCRIPTION:
+*       accept frames under key as well as the current key. used
+*       ahead of a rotation for the key peers will move to, and
+*       after it for the key they are moving from
+*
+*********************************************************************/
+void set_grace_key_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    bool enable,                        /* accept key as well       */
+    uint8_t key                         /* key to accept            */
+    )
+{
+
+ctx->grace_key_valid = enable;
+ctx->grace_key       = key;
+
+} /* set_grace_key_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_transport
+*
+*   DESCRIPTION:
+*       select the backend used to move frames. must be called
+*       before init_message, otherwise the LoRa API is used
+*
+*********************************************************************/
+void set_transport
+    (
+    msg_transport new_transport            /* backend to use        */
+    )
+{
+
+default_transport       = new_transport;
+default_transport_valid = true;
+
+default_ctx.transport       = new_transport;
+default_ctx.transport_valid = true;
+
+} /* set_transport() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_group_mask_ctx
+*
+*   DESCRIPTION:
+*       select multicast groups to receive. bit n of mask accepts
+*       frames sent to MSG_GROUP_ADDRESS( n ). MSG_BROADCAST is
+*       always accepted
+*
+*********************************************************************/
+void set_group_mask_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    uint32_t mask                       /* groups to accept         */
+    )
+{
+
+ctx->group_mask = mask | ( ( uint32_t ) 1 << MSG_BROADCAST_GROUP );
+
+} /* set_group_mask_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       register_module_ctx
+*
+*   DESCRIPTION:
+*       add module to the registry so frames from it are accepted
+*       and frames to it are not reported as RX_INVALID_HEADER
+*
+*   RETURN:
+*       T/F address below MSG_MAX_MODULES y/n
+*
+*********************************************************************/
+bool register_module_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location module                     /* address to accept        */
+    )
+{
+
+if( module >= MSG_MAX_MODULES )
+    {
+    return false;
+    }
+
+ctx->modules[ module / 32 ] |= ( uint32_t ) 1 << ( module % 32 );
+
+return true;
+
+} /* register_module_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       unregister_module_ctx
+*
+*   DESCRIPTION:
+*       remove module from the registry, its sequence window is
+*       reset so it starts fresh if registered again
+*
+*********************************************************************/
+void unregister_module_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location module                     /* address to forget        */
+    )
+{
+
+if( module >= MSG_MAX_MODULES )
+    {
+    return;
+    }
+
+ctx->modules[ module / 32 ] &= ~( ( uint32_t ) 1 << ( module % 32 ) );
+ctx->rx_sequences[ module ].valid = false;
+
+} /* unregister_module_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       module_registered_ctx
+*
+*   DESCRIPTION:
+*       check module against the registry
+*
+*   RETURN:
+*       T/F module registered y/n
+*
+*********************************************************************/
+bool module_registered_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location module                     /* address to check         */
+    )
+{
+
+return module_known( ctx, module );
+
+} /* module_registered_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_route_ctx
+*
+*   DESCRIPTION:
+*       send frames for destination via the relay next_hop. they
+*       go out as v2 with a final destination and MSG_ROUTE_TTL, so
+*       keep data to MAX_ROUTED_LENGTH_V2. a next_hop of MODULE_NONE
+*       removes the route. relays use the same table to pick where
+*       a frame goes next
+*
+*   RETURN:
+*       T/F route stored y/n, false when the table is full
+*
+*********************************************************************/
+bool set_route_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location destination,               /* final destination        */
+    location next_hop                   /* relay or MODULE_NONE     */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_route *route;                       /* entry to fill            */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Replace destination's entry or take a free one
+----------------------------------------------------------*/
+route = ( msg_route * ) find_route( ctx, destination );
+for( i = 0; i < MSG_ROUTE_COUNT && route == NULL; i++ )
+    {
+    if( ! ctx->routes[ i ].in_use )
+        {
+        route = &ctx->routes[ i ];
+        }
+    }
+
+if( next_hop == MODULE_NONE )
+    {
+    if( route != NULL )
+        {
+        route->in_use = false;
+        }
+    return true;
+    }
+
+if( route == NULL )
+    {
+    return false;
+    }
+
+route->in_use       = true;
+route->destination  = destination;
+route->next_hop     = next_hop;
+
+return true;
+
+} /* set_route_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_relay_ctx
+*
+*   DESCRIPTION:
+*       turn relay mode on or off. a relay forwards routed frames
+*       addressed through it to another module. clock, if given, is
+*       read before and after each forward to collect per hop
+*       latency in the units it counts
+*
+*********************************************************************/
+void set_relay_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    bool enable,                        /* forward routed frames    */
+    msg_clock clock                     /* forward timer or NULL    */
+    )
+{
+
+ctx->relay_enabled  = enable;
+ctx->relay_clock    = clock;
+
+} /* set_relay_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_relay_stats_ctx
+*
+*   DESCRIPTION:
+*       copy relay counters. latency_total / forwarded is the mean
+*       time a frame spent in this hop
+*
+*********************************************************************/
+void get_relay_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_relay_stats *stats              /* pointer to store counters */
+    )
+{
+
+*stats = ctx->relay_stats;
+
+} /* get_relay_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_filter_stats_ctx
+*
+*   DESCRIPTION:
+*       copy receive address filter counters
+*
+*********************************************************************/
+void get_filter_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_filter_stats *stats             /* pointer to store counters */
+    )
+{
+
+*stats = ctx->filter_stats;
+
+} /* get_filter_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_port_handler_ctx
+*
+*   DESCRIPTION:
+*       register handler for frames sent to a service port. valid
+*       frames for the port are passed to handler while the receive
+*       calls run and are not returned to the caller. pass NULL to
+*       release the port
+*
+*********************************************************************/
+void set_port_handler_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    uint8_t port,                       /* service port             */
+    msg_port_handler handler,           /* frame handler or NULL    */
+    void *arg                           /* passed to handler        */
+    )
+{
+
+if( port == MSG_PORT_APP || port >= MSG_PORT_COUNT )
+    {
+    return;
+    }
+
+ctx->port_handlers[ port ].handler   = handler;
+ctx->port_handlers[ port ].arg       = arg;
+
+} /* set_port_handler_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_rx_callback_ctx
+*
+*   DESCRIPTION:
+*       switch context to event driven receive. the receive calls
+*       only read the transport after message_rx_isr_ctx, and
+*       callback runs from the interrupt to wake the application.
+*       callback may be NULL. call after init_message_ctx
+*
+*********************************************************************/
+void set_rx_callback_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    msg_rx_callback callback,           /* rx event hook or NULL    */
+    void *arg                           /* passed to callback       */
+    )
+{
+
+ctx->rx_callback        = callback;
+ctx->rx_callback_arg    = arg;
+ctx->rx_pending         = 1;
+ctx->rx_events          = true;
+
+} /* set_rx_callback_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       message_rx_isr_ctx
+*
+*   DESCRIPTION:
+*       call from the radio RxDone (DIO0) interrupt. flags a frame
+*       for the next receive call and runs the rx callback
+*
+*********************************************************************/
+void message_rx_isr_ctx
+    (
+    message_ctx *ctx                    /* context                  */
+    )
+{
+
+ctx->rx_pending = 1;
+
+if( ctx->rx_callback != NULL )
+    {
+    ctx->rx_callback( ctx->rx_callback_arg );
+    }
+
+} /* message_rx_isr_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_secure_key_ctx
+*
+*   DESCRIPTION:
+*       load the key shared with peer, or the network key for
+*       MSG_BROADCAST, which covers group frames and peers with no
+*       key of their own. the key is loaded into cipher words here
+*       so no per frame setup is left. a NULL key removes the entry
+*
+*   RETURN:
+*       T/F key stored y/n, false when the table is full
+*
+*********************************************************************/
+bool set_secure_key_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location peer,                      /* module or MSG_BROADCAST  */
+    const uint8_t key[]                 /* MSG_KEY_SIZE bytes, or
+                                           NULL to remove           */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_secure_key *entry;                  /* entry to fill            */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Take the entry for peer, else a free one
+----------------------------------------------------------*/
+entry = NULL;
+for( i = 0; i < MSG_SECURE_KEYS; i++ )
+    {
+    if( ctx->secure_keys[ i ].in_use && ctx->secure_keys[ i ].peer == peer )
+        {
+        entry = &ctx->secure_keys[ i ];
+        break;
+        }
+
+    if( ! ctx->secure_keys[ i ].in_use && entry == NULL )
+        {
+        entry = &ctx->secure_keys[ i ];
+        }
+    }
+
+if( key == NULL )
+    {
+    if( entry != NULL && entry->in_use )
+        {
+        memset( entry, 0, sizeof( *entry ) );
+        }
+    return true;
+    }
+
+if( entry == NULL )
+    {
+    return false;
+    }
+
+entry->in_use   = true;
+entry->peer     = peer;
+ascon_load_key( &entry->key, key );
+
+return true;
+
+} /* set_secure_key_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_secure_ctx
+*
+*   DESCRIPTION:
+*       turn secure mode on or off. while on, every frame sent is
+*       encrypted and tagged and frames without a good tag are
+*       rejected. tx_counter is the last counter used; keep it
+*       (get_secure_counter) across resets so that no counter is
+*       sent twice under one key
+*
+*********************************************************************/
+void set_secure_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    bool enable,                        /* seal and require tags    */
+    uint32_t tx_counter                 /* counter to start after   */
+    )
+{
+
+ctx->secure     = enable;
+ctx->tx_counter = tx_counter;
+
+} /* set_secure_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_secure_counter_ctx
+*
+*   DESCRIPTION:
+*       last frame counter sent, to be stored before a reset
+*
+*********************************************************************/
+uint32_t get_secure_counter_ctx
+    (
+    message_ctx *ctx                    /* context                  */
+    )
+{
+
+return ctx->tx_counter;
+
+} /* get_secure_counter_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_secure_stats_ctx
+*
+*   DESCRIPTION:
+*       copy secure mode counters
+*
+*********************************************************************/
+void get_secure_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_secure_stats *stats             /* pointer to store counters */
+    )
+{
+
+*stats = ctx->secure_stats;
+
+} /* get_secure_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_message_stats_ctx
+*
+*   DESCRIPTION:
+*       copy message path counters and histograms. all zero when
+*       built with MSG_STATS 0. call from the thread using ctx
+*
+*********************************************************************/
+void get_message_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_stats *stats                    /* pointer to store counters */
+    )
+{
+
+#if( MSG_STATS )
+*stats = ctx->stats;
+#else
+( void ) ctx;
+memset( stats, 0, sizeof( *stats ) );
+#endif
+
+} /* get_message_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       reset_message_stats_ctx
+*
+*   DESCRIPTION:
+*       zero message path counters and histograms
+*
+*********************************************************************/
+void reset_message_stats_ctx
+    (
+    message_ctx *ctx                    /* context                  */
+    )
+{
+
+#if( MSG_STATS )
+memset( &ctx->stats, 0, sizeof( ctx->stats ) );
+#else
+( void ) ctx;
+#endif
+
+} /* reset_message_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_stats_clock_ctx
+*
+*   DESCRIPTION:
+*       tick source for the encode, decode and transmit histograms,
+*       e.g. the DWT cycle counter on the Tiva. with no clock only
+*       the counters are kept
+*
+*********************************************************************/
+void set_stats_clock_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    msg_clock clock                     /* tick source or NULL      */
+    )
+{
+
+#if( MSG_STATS )
+ctx->stats_clock = clock;
+#else
+( void ) ctx;
+( void ) clock;
+#endif
+
+} /* set_stats_clock_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_trace_hook_ctx
+*
+*   DESCRIPTION:
+*       call hook for every frame decoded for this module and every
+*       frame sent, from the thread using ctx
+*
+*********************************************************************/
+void set_trace_hook_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    msg_trace_hook hook,                /* trace hook or NULL       */
+    void *arg                           /* passed to hook           */
+    )
+{
+
+#if( MSG_STATS )
+ctx->trace_hook = hook;
+ctx->trace_arg  = arg;
+#else
+( void ) ctx;
+( void ) hook;
+( void ) arg;
+#endif
+
+} /* set_trace_hook_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       init_message
+*
+*   DESCRIPTION:
+*       procedure for setting up message API on the default
+*       context as current_location. the sequence counter carries
+*       over so peers do not see a re-init as repeated frames
+*
+*********************************************************************/
+lora_errors init_message
+    (
+    lora_config config_data                  /* SPI Interface info  */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_errors init_errors;
+uint8_t tx_sequence;
+
+tx_sequence = default_ctx.tx_sequence;
+init_errors = init_message_ctx( &default_ctx, current_location,
+                                default_transport_valid ? &default_transport : NULL, config_data );
+default_ctx.tx_sequence = tx_sequence;
+
+return init_errors;
+
+} /* init_message() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_message
+*
+*   DESCRIPTION:
+*       procedure for sending messages in messageAPI format 
+*       through LoRa
+*
+*********************************************************************/
+lora_errors send_message
+    (
+    tx_message message                           /* message to send */
+    )
+{
+
+return send_message_ctx( &default_ctx, message );
+
+} /* send_message() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_messages
+*
+*   DESCRIPTION:
+*       send_messages_ctx on the default context
+*
+*********************************************************************/
+lora_errors send_messages
+    (
+    const tx_message messages[],                /* messages to send */
+    uint8_t count,                              /* size of messages[] */
+    lora_errors errors[]            /* per message errors, or NULL  */
+    )
+{
+
+return send_messages_ctx( &default_ctx, messages, count, errors );
+
+} /* send_messages() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_data
+*
+*   DESCRIPTION:
+*       send_data_ctx on the default context
+*
+*********************************************************************/
+lora_errors send_data
+    (
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size                    /* size of data[]               */
+    )
+{
+
+return send_data_ctx( &default_ctx, destination, data, size );
+
+} /* send_data() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       encode_message
+*
+*   DESCRIPTION:
+*       encode_message_ctx on the default context
+*
+*********************************************************************/
+uint8_t encode_message
+    (
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    )
+{
+
+return encode_message_ctx( &default_ctx, destination, data, size, frame );
+
+} /* encode_message() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       encode_message_header
+*
+*   DESCRIPTION:
+*       encode_message_header_ctx on the default context
+*
+*********************************************************************/
+uint8_t encode_message_header
+    (
+    const msg_header *header,       /* destination and options      */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    )
+{
+
+return encode_message_header_ctx( &default_ctx, header, data, size, frame );
+
+} /* encode_message_header() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_frame
+*
+*   DESCRIPTION:
+*       send_frame_ctx on the default context
+*
+*********************************************************************/
+lora_errors send_frame
+    (
+    uint8_t frame[],                /* encoded frame                */
+    uint8_t size                    /* size of frame[]              */
+    )
+{
+
+return send_frame_ctx( &default_ctx, frame, size );
+
+} /* send_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_message
+*
+*   DESCRIPTION:
+*       procedure for receiving messages in messageAPI format 
+*       through LoRa
+*
+*********************************************************************/
+bool get_message
+    (
+    rx_message *message,       /* pointer to store message received */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+
+return get_message_ctx( &default_ctx, message, errors );
+
+} /* get_message() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_message_view
+*
+*   DESCRIPTION:
+*       get_message_view_ctx on the default context
+*
+*********************************************************************/
+bool get_message_view
+    (
+    msg_view *view,            /* view of message received          */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+
+return get_message_view_ctx( &default_ctx, view, errors );
+
+} /* get_message_view() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_messages
+*
+*   DESCRIPTION:
+*       get_messages_ctx on the default context
+*
+*********************************************************************/
+uint8_t get_messages
+    (
+    rx_message messages[],     /* array to store messages received  */
+    uint8_t max_messages,      /* size of messages[]                */
+    lora_errors *errors        /* pointer to store errors received  */
+    )
+{
+
+return get_messages_ctx( &default_ctx, messages, max_messages, errors );
+
+} /* get_messages() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       update_key
+*
+*   DESCRIPTION:
+*       procedure for updating key used in messageAPI
+*
+*********************************************************************/
+void update_key
+    (
+    uint8_t new_key                                      /* new key */
+    )
+{
+
+update_key_ctx( &default_ctx, new_key );
+
+} /* update_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_key
+*
+*   DESCRIPTION:
+*       get_key_ctx on the default context
+*
+*********************************************************************/
+uint8_t get_key
+    (
+    void
+    )
+{
+
+return get_key_ctx( &default_ctx );
+
+} /* get_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rotate_key
+*
+*   DESCRIPTION:
+*       rotate_key_ctx on the default context
+*
+*********************************************************************/
+void rotate_key
+    (
+    uint8_t new_key                                      /* new key */
+    )
+{
+
+rotate_key_ctx( &default_ctx, new_key );
+
+} /* rotate_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_grace_key
+*
+*   DESCRIPTION:
+*       set_grace_key_ctx on the default context
+*
+*********************************************************************/
+void set_grace_key
+    (
+    bool enable,                        /* accept key as well       */
+    uint8_t key                         /* key to accept            */
+    )
+{
+
+set_grace_key_ctx( &default_ctx, enable, key );
+
+} /* set_grace_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_group_mask
+*
+*   DESCRIPTION:
+*       set_group_mask_ctx on the default context
+*
+*********************************************************************/
+void set_group_mask
+    (
+    uint32_t mask                       /* groups to accept         */
+    )
+{
+
+set_group_mask_ctx( &default_ctx, mask );
+
+} /* set_group_mask() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_filter_stats
+*
+*   DESCRIPTION:
+*       get_filter_stats_ctx on the default context
+*
+*********************************************************************/
+void get_filter_stats
+    (
+    msg_filter_stats *stats             /* pointer to store counters */
+    )
+{
+
+get_filter_stats_ctx( &default_ctx, stats );
+
+} /* get_filter_stats() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_port_handler
+*
+*   DESCRIPTION:
+*       set_port_handler_ctx on the default context
+*
+*********************************************************************/
+void set_port_handler
+    (
+    uint8_t port,                       /* service port             */
+    msg_port_handler handler,           /* frame handler or NULL    */
+    void *arg                           /* passed to handler        */
+    )
+{
+
+set_port_handler_ctx( &default_ctx, port, handler, arg );
+
+} /* set_port_handler() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_rx_callback
+*
+*   DESCRIPTION:
+*       set_rx_callback_ctx on the default context
+*
+*********************************************************************/
+void set_rx_callback
+    (
+    msg_rx_callback callback,           /* rx event hook or NULL    */
+    void *arg                           /* passed to callback       */
+    )
+{
+
+set_rx_callback_ctx( &default_ctx, callback, arg );
+
+} /* set_rx_callback() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       message_rx_isr
+*
+*   DESCRIPTION:
+*       message_rx_isr_ctx on the default context
+*
+*********************************************************************/
+void message_rx_isr
+    (
+    void
+    )
+{
+
+message_rx_isr_ctx( &default_ctx );
+
+} /* message_rx_isr() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       register_module
+*
+*   DESCRIPTION:
+*       register_module_ctx on the default context
+*
+*********************************************************************/
+bool register_module
+    (
+    location module                     /* address to accept        */
+    )
+{
+
+return register_module_ctx( &default_ctx, module );
+
+} /* register_module() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       unregister_module
+*
+*   DESCRIPTION:
+*       unregister_module_ctx on the default context
+*
+*********************************************************************/
+void unregister_module
+    (
+    location module                     /* address to forget        */
+    )
+{
+
+unregister_module_ctx( &default_ctx, module );
+
+} /* unregister_module() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       module_registered
+*
+*   DESCRIPTION:
+*       module_registered_ctx on the default context
+*
+*********************************************************************/
+bool module_registered
+    (
+    location module                     /* address to check         */
+    )
+{
+
+return module_registered_ctx( &default_ctx, module );
+
+} /* module_registered() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_route
+*
+*   DESCRIPTION:
+*       set_route_ctx on the default context
+*
+*********************************************************************/
+bool set_route
+    (
+    location destination,               /* final destination        */
+    location next_hop                   /* relay or MODULE_NONE     */
+    )
+{
+
+return set_route_ctx( &default_ctx, destination, next_hop );
+
+} /* set_route() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_relay
+*
+*   DESCRIPTION:
+*       set_relay_ctx on the default context
+*
+*********************************************************************/
+void set_relay
+    (
+    bool enable,                        /* forward routed frames    */
+    msg_clock clock                     /* forward timer or NULL    */
+    )
+{
+
+set_relay_ctx( &default_ctx, enable, clock );
+
+} /* set_relay() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_relay_stats
+*
+*   DESCRIPTION:
+*       get_relay_stats_ctx on the default context
+*
+*********************************************************************/
+void get_relay_stats
+    (
+    msg_relay_stats *stats              /* pointer to store counters */
+    )
+{
+
+get_relay_stats_ctx( &default_ctx, stats );
+
+} /* get_relay_stats() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_secure_key
+*
+*   DESCRIPTION:
+*       set_secure_key_ctx on the default context
+*
+*********************************************************************/
+bool set_secure_key
+    (
+    location peer,                      /* module or MSG_BROADCAST  */
+    const uint8_t key[]                 /* MSG_KEY_SIZE bytes, or
+                                           NULL to remove           */
+    )
+{
+
+return set_secure_key_ctx( &default_ctx, peer, key );
+
+} /* set_secure_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_secure
+*
+*   DESCRIPTION:
+*       set_secure_ctx on the default context
+*
+*********************************************************************/
+void set_secure
+    (
+    bool enable,                        /* seal and require tags    */
+    uint32_t tx_counter                 /* counter to start after   */
+    )
+{
+
+set_secure_ctx( &default_ctx, enable, tx_counter );
+
+} /* set_secure() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_secure_counter
+*
+*   DESCRIPTION:
+*       get_secure_counter_ctx on the default context
+*
+*********************************************************************/
+uint32_t get_secure_counter
+    (
+    void
+    )
+{
+
+return get_secure_counter_ctx( &default_ctx );
+
+} /* get_secure_counter() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_secure_stats
+*
+*   DESCRIPTION:
+*       get_secure_stats_ctx on the default context
+*
+*********************************************************************/
+void get_secure_stats
+    (
+    msg_secure_stats *stats             /* pointer to store counters */
+    )
+{
+
+get_secure_stats_ctx( &default_ctx, stats );
+
+} /* get_secure_stats() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_message_stats
+*
+*   DESCRIPTION:
+*       get_message_stats_ctx on the default context
+*
+*********************************************************************/
+void get_message_stats
+    (
+    msg_stats *stats                    /* pointer to store counters */
+    )
+{
+
+get_message_stats_ctx( &default_ctx, stats );
+
+} /* get_message_stats() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       reset_message_stats
+*
+*   DESCRIPTION:
+*       reset_message_stats_ctx on the default context
+*
+*********************************************************************/
+void reset_message_stats
+    (
+    void
+    )
+{
+
+reset_message_stats_ctx( &default_ctx );
+
+} /* reset_message_stats() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_stats_clock
+*
+*   DESCRIPTION:
+*       set_stats_clock_ctx on the default context
+*
+*********************************************************************/
+void set_stats_clock
+    (
+    msg_clock clock                     /* tick source or NULL      */
+    )
+{
+
+set_stats_clock_ctx( &default_ctx, clock );
+
+} /* set_stats_clock() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       set_trace_hook
+*
+*   DESCRIPTION:
+*       set_trace_hook_ctx on the default context
+*
+*********************************************************************/
+void set_trace_hook
+    (
+    msg_trace_hook hook,                /* trace hook or NULL       */
+    void *arg                           /* passed to hook           */
+    )
+{
+
+set_trace_hook_ctx( &default_ctx, hook, arg );
+
+} /* set_trace_hook() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_default_ctx
+*
+*   DESCRIPTION:
+*       context behind the plain calls, for layers with both plain
+*       and _ctx entry points
+*
+*********************************************************************/
+message_ctx * get_default_ctx
+    (
+    void
+    )
+{
+
+return &default_ctx;
+
+} /* get_default_ctx() */
@@ -6,6 +6,8 @@
 *   Copyright 2020 Nate Lenze
 *
 *********************************************************************/
+#ifndef MESSAGE_API_H
+#define MESSAGE_API_H
 
 /*--------------------------------------------------------------------
                            GENERAL INCLUDES
@@ -15,12 +17,130 @@
 #include <stdbool.h>
 
 #include "sys_def.h"
-#include "LoRa/LoraAPI.h"
+#include "msg_transport.h"
+#include "msg_ascon.h"
 
 /*--------------------------------------------------------------------
                           LITERAL CONSTANTS
 --------------------------------------------------------------------*/
-#define MAX_MSG_LENGTH      ( 10 )      /* maximum size of message  */
+#define MSG_DATA_OFFSET     ( 5 )       /* data index within frame  */
+
+#define MSG_FRAME_OVERHEAD  ( 7 )       /* header + crc bytes, v2
+                                           with sequence byte       */
+
+#define MSG_PORT_DATA_OFFSET ( 7 )      /* data index, port frame   */
+
+#define MAX_MSG_LENGTH_V1   ( 10 )      /* maximum size of v1 data  */
+
+#define MAX_MSG_LENGTH_V2   ( MAX_LORA_MSG_SIZE - MSG_FRAME_OVERHEAD )
+                                        /* maximum size of v2 data  */
+
+#define MSG_ROUTE_OVERHEAD  ( 2 )       /* final destination and ttl
+                                           on a relayed frame       */
+
+#define MAX_ROUTED_LENGTH_V2 ( MAX_MSG_LENGTH_V2 - MSG_ROUTE_OVERHEAD )
+                                        /* maximum v2 data on a
+                                           frame sent via a relay   */
+
+#define MSG_KEY_SIZE        ( ASCON_KEY_SIZE ) /* secure mode key  */
+
+#ifndef MSG_TAG_SIZE
+#define MSG_TAG_SIZE        ( 4 )       /* secure frame tag bytes,
+                                           1 to 16, same on every
+                                           module                   */
+#endif
+
+#define MSG_COUNTER_SIZE    ( 4 )       /* secure frame counter     */
+
+#define MSG_SECURE_OVERHEAD ( MSG_COUNTER_SIZE + MSG_TAG_SIZE - 1 )
+                                        /* counter and tag, less the
+                                           crc the tag replaces     */
+
+#define MAX_SECURE_LENGTH_V2 ( MAX_ROUTED_LENGTH_V2 - MSG_SECURE_OVERHEAD )
+                                        /* maximum v2 data on a
+                                           secure routed frame      */
+
+#ifndef MSG_SECURE_KEYS
+#define MSG_SECURE_KEYS     ( 8 )       /* peer and network keys    */
+#endif
+
+#define MSG_MAX_FRAME_OVERHEAD ( MSG_FRAME_OVERHEAD + MSG_ROUTE_OVERHEAD + MSG_SECURE_OVERHEAD )
+                                        /* bytes encode_message may
+                                           add to application data  */
+
+#ifndef MSG_ROUTE_COUNT
+#define MSG_ROUTE_COUNT     ( 8 )       /* next hop table entries   */
+#endif
+
+#ifndef MSG_ROUTE_TTL
+#define MSG_ROUTE_TTL       ( 4 )       /* relays a frame may pass  */
+#endif
+
+#ifndef MSG_RELAY_CACHE_SIZE
+#define MSG_RELAY_CACHE_SIZE ( 16 )     /* frames a relay remembers
+                                           having forwarded         */
+#endif
+
+#define MSG_DEDUP_WINDOW    ( 32 )      /* sequence numbers a source
+                                           is checked against       */
+
+#define MSG_FIRST_SEQUENCE  ( 1 )       /* sequence of the first frame
+                                           after a sender starts,
+                                           not reused on wrap       */
+
+#ifndef MAX_MSG_LENGTH                  /* rx/tx_message data size, */
+#define MAX_MSG_LENGTH      ( MAX_MSG_LENGTH_V1 ) /* up to v2 size  */
+#endif
+
+#ifndef MSG_MAX_MODULES
+#define MSG_MAX_MODULES     ( 32 )      /* module addresses 0 to n-1
+                                           the registry can hold    */
+#endif
+
+#define MSG_MODULE_WORDS    ( ( MSG_MAX_MODULES + 31 ) / 32 )
+                                        /* registry bitmap size     */
+
+#define MSG_GROUP_BASE      ( 0xE0 )    /* first multicast address  */
+
+#define MSG_GROUP_COUNT     ( 32 )      /* multicast groups         */
+
+#define MSG_BROADCAST_GROUP ( MSG_GROUP_COUNT - 1 )
+                                        /* group every module is in */
+
+#define MSG_BROADCAST       ( MSG_GROUP_BASE + MSG_BROADCAST_GROUP )
+                                        /* all modules address 0xFF */
+
+#define MSG_PORT_APP        ( 0 )       /* application data port    */
+
+#define MSG_PORT_FRAGMENT   ( 1 )       /* msg_frag.c fragments     */
+
+#define MSG_PORT_ARQ        ( 2 )       /* msg_arq.c reliable data  */
+
+#define MSG_PORT_TDMA       ( 3 )       /* msg_tdma.c beacons       */
+
+#define MSG_PORT_REKEY      ( 4 )       /* msg_rekey.c key rotation */
+
+#define MSG_PORT_COUNT      ( 16 )      /* service ports            */
+
+#ifndef MSG_STATS
+#define MSG_STATS           ( 1 )       /* 0 compiles the message
+                                           path counters, latency
+                                           histograms and trace
+                                           hook out                 */
+#endif
+
+#define MSG_ERROR_COUNT     ( RX_INIT_ERR + 1 )
+                                        /* lora_errors codes counted */
+
+#define MSG_LATENCY_BUCKETS ( 16 )      /* bucket n: 2^(n-1) to
+                                           2^n - 1 ticks, the last
+                                           one everything above     */
+
+#define MSG_BURST_MESSAGES  ( 16 )      /* frames encoded per burst
+                                           chunk                    */
+
+#define MSG_BURST_BUFFER_SIZE ( MSG_BURST_MESSAGES * ( MAX_MSG_LENGTH + MSG_MAX_FRAME_OVERHEAD ) )
+                                        /* bytes held for a burst   */
 
 /*--------------------------------------------------------------------
                                 TYPES
@@ -40,6 +160,202 @@ typedef struct                              /* tx message format    */
     uint8_t message[ MAX_MSG_LENGTH ];      /* data buffer          */
     } tx_message;
 
+typedef struct                              /* in-place rx message  */
+    {
+    location destination;                   /* destination          */
+    location source;                        /* source               */
+    uint8_t key;                            /* key                  */
+    uint8_t port;                           /* service port         */
+    uint8_t sequence;                       /* source sequence, 0 if
+                                               sender has none      */
+    uint8_t size;                           /* size of payload[]    */
+    const uint8_t *payload;                 /* data in rx buffer    */
+    bool valid;                             /* data marked valid?   */
+    } msg_view;
+
+typedef struct                              /* tx frame header      */
+    {
+    location destination;                   /* destination          */
+    uint8_t port;                           /* service port         */
+    } msg_header;
+
+typedef void ( *msg_port_handler )          /* service port handler */
+    (
+    const msg_view *view,                   /* frame for the port   */
+    void *arg                               /* handler argument     */
+    );
+
+typedef uint32_t ( *msg_clock )              /* free running clock   */
+    (
+    void
+    );
+
+typedef struct                              /* next hop table entry */
+    {
+    bool in_use;                            /* entry valid          */
+    location destination;                   /* final destination    */
+    location next_hop;                      /* relay to send via    */
+    } msg_route;
+
+typedef struct                              /* relay counters       */
+    {
+    uint32_t forwarded;                     /* frames sent on       */
+    uint32_t ttl_expired;                   /* ttl ran out          */
+    uint32_t duplicates;                    /* forwarded before     */
+    uint32_t send_errors;                   /* forwards that failed */
+    uint32_t latency_total;                 /* sum of forward times */
+    uint32_t latency_max;                   /* longest forward time */
+    } msg_relay_stats;
+
+typedef struct                              /* secure mode key      */
+    {
+    bool in_use;                            /* entry valid          */
+    location peer;                          /* module, or
+                                               MSG_BROADCAST for
+                                               the network key      */
+    ascon_key key;                          /* loaded key           */
+    } msg_secure_key;
+
+typedef struct                              /* secure mode counters */
+    {
+    uint32_t encrypted;                     /* frames sealed        */
+    uint32_t decrypted;                     /* frames opened        */
+    uint32_t auth_failed;                   /* tag did not match    */
+    uint32_t replayed;                      /* counter not newer    */
+    uint32_t no_key;                        /* no key for peer      */
+    uint32_t plain_rejected;                /* unsealed frames      */
+    } msg_secure_stats;
+
+typedef struct                              /* latency histogram    */
+    {
+    uint32_t count;                         /* samples taken        */
+    uint32_t total;                         /* sum of ticks         */
+    uint32_t max;                           /* longest sample       */
+    uint32_t buckets[ MSG_LATENCY_BUCKETS ];/* log2 of ticks        */
+    } msg_latency;
+
+typedef struct                              /* traffic with a peer  */
+    {
+    uint32_t rx_frames;                     /* good frames from     */
+    uint32_t rx_bytes;                      /* their frame bytes    */
+    uint32_t tx_frames;                     /* frames sent to       */
+    uint32_t tx_bytes;                      /* their frame bytes    */
+    } msg_peer_stats;
+
+typedef struct                              /* message path counters */
+    {
+    uint32_t rx_errors[ MSG_ERROR_COUNT ];  /* receive results by
+                                               lora_errors code,
+                                               RX_DOUBLE counts
+                                               duplicates dropped   */
+    uint32_t tx_errors[ MSG_ERROR_COUNT ];  /* send results by code */
+    msg_peer_stats peers[ MSG_MAX_MODULES ];/* by module address,
+                                               next hop on tx       */
+    msg_latency encode;                     /* encode_message       */
+    msg_latency decode;                     /* one frame decoded    */
+    msg_latency transmit;                   /* transport send       */
+    } msg_stats;
+
+typedef enum                                /* traced events        */
+    {
+    MSG_TRACE_RX,                           /* frame decoded        */
+    MSG_TRACE_TX                            /* frame sent           */
+    } msg_trace_type;
+
+typedef struct                              /* one traced event     */
+    {
+    msg_trace_type type;                    /* rx or tx             */
+    location peer;                          /* source, or
+                                               destination byte     */
+    uint8_t size;                           /* frame bytes          */
+    lora_errors errors;                     /* result of the frame  */
+    uint32_t ticks;                         /* decode or send time,
+                                               0 without a clock    */
+    } msg_trace_event;
+
+typedef void ( *msg_trace_hook )            /* per frame trace      */
+    (
+    const msg_trace_event *event,           /* what happened        */
+    void *arg                               /* hook argument        */
+    );
+
+typedef void ( *msg_rx_callback )           /* frame arrived event  */
+    (
+    void *arg                               /* callback argument    */
+    );
+
+typedef struct                              /* rx filter counters   */
+    {
+    uint32_t frames_seen;                   /* frames looked at     */
+    uint32_t frames_filtered;               /* dropped on address   */
+    uint32_t frames_accepted;               /* good, for this module */
+    uint32_t frames_duplicate;              /* dropped on sequence  */
+    uint32_t frames_grace_key;              /* taken on grace key   */
+    } msg_filter_stats;
+
+typedef struct                              /* recent rx sequences  */
+    {
+    bool valid;                             /* source heard from    */
+    uint8_t newest;                         /* highest seq seen     */
+    uint32_t seen;                          /* bit n: newest - n    */
+    } msg_sequence_window;
+
+typedef struct                              /* service port owner   */
+    {
+    msg_port_handler handler;               /* frame handler        */
+    void *arg;                              /* handler argument     */
+    } msg_port_entry;
+
+typedef struct                              /* one radio and all of
+                                               its protocol state   */
+    {
+    location module;                        /* this module          */
+    uint8_t key;                            /* current key          */
+    bool grace_key_valid;                   /* grace_key accepted   */
+    uint8_t grace_key;                      /* key accepted as well
+                                               during a rotation    */
+    msg_transport transport;                /* radio backend        */
+    bool transport_valid;                   /* transport assigned?  */
+    uint8_t rx_buffer[ MAX_LORA_MSG_SIZE ]; /* last transport read  */
+    uint8_t rx_offset;                      /* next frame in buffer */
+    uint8_t rx_size;                        /* bytes in rx_buffer   */
+    uint8_t burst_buffer[ MSG_BURST_BUFFER_SIZE ];
+                                            /* encoded tx burst     */
+    uint32_t group_mask;                    /* groups to accept     */
+    uint32_t modules[ MSG_MODULE_WORDS ];   /* registered addresses */
+    msg_filter_stats filter_stats;          /* rx filter counters   */
+    uint8_t tx_sequence;                    /* last sequence sent   */
+    msg_sequence_window rx_sequences[ MSG_MAX_MODULES ];
+                                            /* per source windows   */
+    msg_port_entry port_handlers[ MSG_PORT_COUNT ];
+                                            /* service port owners  */
+    msg_route routes[ MSG_ROUTE_COUNT ];    /* next hop table       */
+    bool relay_enabled;                     /* relay mode on        */
+    msg_clock relay_clock;                  /* times forwards       */
+    uint16_t relay_seen[ MSG_RELAY_CACHE_SIZE ];
+                                            /* source << 8 | seq of
+                                               frames forwarded     */
+    uint8_t relay_seen_next;                /* oldest relay_seen    */
+    msg_relay_stats relay_stats;            /* relay counters       */
+    bool rx_events;                         /* read radio on events */
+    volatile uint8_t rx_pending;            /* set by message_rx_isr */
+    msg_rx_callback rx_callback;            /* rx event hook        */
+    void *rx_callback_arg;                  /* passed to hook       */
+    bool secure;                            /* seal every frame     */
+    uint32_t tx_counter;                    /* last counter sent    */
+    msg_secure_key secure_keys[ MSG_SECURE_KEYS ];
+                                            /* peer and network keys */
+    uint32_t rx_counters[ MSG_MAX_MODULES ];/* newest counter taken
+                                               from each source     */
+    msg_secure_stats secure_stats;          /* secure mode counters */
+#if( MSG_STATS )
+    msg_clock stats_clock;                  /* times the histograms */
+    msg_trace_hook trace_hook;              /* per frame trace      */
+    void *trace_arg;                        /* passed to trace_hook */
+    msg_stats stats;                        /* message path counters */
+#endif
+    } message_ctx;
+
 /*--------------------------------------------------------------------
                            MEMORY CONSTANTS
 --------------------------------------------------------------------*/
@@ -51,6 +367,7 @@ typedef struct                              /* tx message format    */
 /*--------------------------------------------------------------------
                                 MACROS
 --------------------------------------------------------------------*/
+#define MSG_GROUP_ADDRESS( group )  ( ( location )( MSG_GROUP_BASE + ( group ) ) )
 
 /*--------------------------------------------------------------------
                               PROCEDURES
@@ -63,12 +380,61 @@ lora_errors send_message
     tx_message message                           /* message to send */
     );
 
+lora_errors send_messages
+    (
+    const tx_message messages[],                /* messages to send */
+    uint8_t count,                              /* size of messages[] */
+    lora_errors errors[]            /* per message errors, or NULL  */
+    );
+
+lora_errors send_data
+    (
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size                    /* size of data[]               */
+    );
+
+uint8_t encode_message
+    (
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    );
+
+uint8_t encode_message_header
+    (
+    const msg_header *header,       /* destination and options      */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    );
+
+lora_errors send_frame
+    (
+    uint8_t frame[],                /* encoded frame                */
+    uint8_t size                    /* size of frame[]              */
+    );
+
 bool get_message
     (
     rx_message *message,       /* pointer to store message received */
     lora_errors *errors        /* pointer to store errors received  */
     );
 
+bool get_message_view
+    (
+    msg_view *view,            /* view of message received          */
+    lora_errors *errors        /* pointer to store errors received  */
+    );
+
+uint8_t get_messages
+    (
+    rx_message messages[],     /* array to store messages received  */
+    uint8_t max_messages,      /* size of messages[]                */
+    lora_errors *errors        /* pointer to store errors received  */
+    );
+
 lora_errors init_message
     (
     lora_config config_data                  /* SPI Interface info  */
@@ -78,4 +444,361 @@ void update_key
     (
     uint8_t new_key                                      /* new key */
     );
+
+uint8_t get_key
+    (
+    void
+    );
+
+void rotate_key
+    (
+    uint8_t new_key                                      /* new key */
+    );
+
+void set_grace_key
+    (
+    bool enable,                        /* accept key as well       */
+    uint8_t key                         /* key to accept            */
+    );
+
+void set_group_mask
+    (
+    uint32_t mask                       /* groups to accept         */
+    );
+
+void get_filter_stats
+    (
+    msg_filter_stats *stats             /* pointer to store counters */
+    );
+
+void set_port_handler
+    (
+    uint8_t port,                       /* service port             */
+    msg_port_handler handler,           /* frame handler or NULL    */
+    void *arg                           /* passed to handler        */
+    );
+
+void set_transport
+    (
+    msg_transport new_transport            /* backend to use        */
+    );
+
+bool register_module
+    (
+    location module                     /* address to accept        */
+    );
+
+void unregister_module
+    (
+    location module                     /* address to forget        */
+    );
+
+bool module_registered
+    (
+    location module                     /* address to check         */
+    );
+
+bool set_route
+    (
+    location destination,               /* final destination        */
+    location next_hop                   /* relay or MODULE_NONE     */
+    );
+
+void set_relay
+    (
+    bool enable,                        /* forward routed frames    */
+    msg_clock clock                     /* forward timer or NULL    */
+    );
+
+void get_relay_stats
+    (
+    msg_relay_stats *stats              /* pointer to store counters */
+    );
+
+void set_rx_callback
+    (
+    msg_rx_callback callback,           /* rx event hook or NULL    */
+    void *arg                           /* passed to callback       */
+    );
+
+void message_rx_isr
+    (
+    void
+    );
+
+bool set_secure_key
+    (
+    location peer,                      /* module or MSG_BROADCAST  */
+    const uint8_t key[]                 /* MSG_KEY_SIZE bytes, or
+                                           NULL to remove           */
+    );
+
+void set_secure
+    (
+    bool enable,                        /* seal and require tags    */
+    uint32_t tx_counter                 /* counter to start after   */
+    );
+
+uint32_t get_secure_counter
+    (
+    void
+    );
+
+void get_secure_stats
+    (
+    msg_secure_stats *stats             /* pointer to store counters */
+    );
+
+void get_message_stats
+    (
+    msg_stats *stats                    /* pointer to store counters */
+    );
+
+void reset_message_stats
+    (
+    void
+    );
+
+void set_stats_clock
+    (
+    msg_clock clock                     /* tick source or NULL      */
+    );
+
+void set_trace_hook
+    (
+    msg_trace_hook hook,                /* trace hook or NULL       */
+    void *arg                           /* passed to hook           */
+    );
+
+message_ctx * get_default_ctx
+    (
+    void
+    );
+
+/*--------------------------------------------------------------------
+messageAPI.c -- context variants, the calls above run on a default
+context set up by init_message
+--------------------------------------------------------------------*/
+lora_errors init_message_ctx
+    (
+    message_ctx *ctx,                        /* context             */
+    location module,                         /* this module         */
+    const msg_transport *transport,          /* backend or NULL     */
+    lora_config config_data                  /* SPI Interface info  */
+    );
+
+lora_errors send_message_ctx
+    (
+    message_ctx *ctx,                            /* context         */
+    tx_message message                           /* message to send */
+    );
+
+lora_errors send_messages_ctx
+    (
+    message_ctx *ctx,                           /* context          */
+    const tx_message messages[],                /* messages to send */
+    uint8_t count,                              /* size of messages[] */
+    lora_errors errors[]            /* per message errors, or NULL  */
+    );
+
+lora_errors send_data_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size                    /* size of data[]               */
+    );
+
+uint8_t encode_message_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    location destination,           /* destination                  */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    );
+
+uint8_t encode_message_header_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    const msg_header *header,       /* destination and options      */
+    const uint8_t data[],           /* data to send                 */
+    uint8_t size,                   /* size of data[]               */
+    uint8_t frame[]                 /* array to hold encoded frame  */
+    );
+
+lora_errors send_frame_ctx
+    (
+    message_ctx *ctx,               /* context                      */
+    uint8_t frame[],                /* encoded frame                */
+    uint8_t size                    /* size of frame[]              */
+    );
+
+bool get_message_ctx
+    (
+    message_ctx *ctx,          /* context                           */
+    rx_message *message,       /* pointer to store message received */
+    lora_errors *errors        /* pointer to store errors received  */
+    );
+
+bool get_message_view_ctx
+    (
+    message_ctx *ctx,          /* context                           */
+    msg_view *view,            /* view of message received          */
+    lora_errors *errors        /* pointer to store errors received  */
+    );
+
+uint8_t get_messages_ctx
+    (
+    message_ctx *ctx,          /* context                           */
+    rx_message messages[],     /* array to store messages received  */
+    uint8_t max_messages,      /* size of messages[]                */
+    lora_errors *errors        /* pointer to store errors received  */
+    );
+
+void update_key_ctx
+    (
+    message_ctx *ctx,                                    /* context */
+    uint8_t new_key                                      /* new key */
+    );
+
+uint8_t get_key_ctx
+    (
+    message_ctx *ctx                                     /* context */
+    );
+
+void rotate_key_ctx
+    (
+    message_ctx *ctx,                                    /* context */
+    uint8_t new_key                                      /* new key */
+    );
+
+void set_grace_key_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    bool enable,                        /* accept key as well       */
+    uint8_t key                         /* key to accept            */
+    );
+
+void set_group_mask_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    uint32_t mask                       /* groups to accept         */
+    );
+
+void get_filter_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_filter_stats *stats             /* pointer to store counters */
+    );
+
+void set_port_handler_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    uint8_t port,                       /* service port             */
+    msg_port_handler handler,           /* frame handler or NULL    */
+    void *arg                           /* passed to handler        */
+    );
+
+bool register_module_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location module                     /* address to accept        */
+    );
+
+void unregister_module_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location module                     /* address to forget        */
+    );
+
+bool module_registered_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location module                     /* address to check         */
+    );
+
+bool set_route_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location destination,               /* final destination        */
+    location next_hop                   /* relay or MODULE_NONE     */
+    );
+
+void set_relay_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    bool enable,                        /* forward routed frames    */
+    msg_clock clock                     /* forward timer or NULL    */
+    );
+
+void get_relay_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_relay_stats *stats              /* pointer to store counters */
+    );
+
+void set_rx_callback_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    msg_rx_callback callback,           /* rx event hook or NULL    */
+    void *arg                           /* passed to callback       */
+    );
+
+void message_rx_isr_ctx
+    (
+    message_ctx *ctx                    /* context                  */
+    );
+
+bool set_secure_key_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    location peer,                      /* module or MSG_BROADCAST  */
+    const uint8_t key[]                 /* MSG_KEY_SIZE bytes, or
+                                           NULL to remove           */
+    );
+
+void set_secure_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    bool enable,                        /* seal and require tags    */
+    uint32_t tx_counter                 /* counter to start after   */
+    );
+
+uint32_t get_secure_counter_ctx
+    (
+    message_ctx *ctx                    /* context                  */
+    );
+
+void get_secure_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_secure_stats *stats             /* pointer to store counters */
+    );
+
+void get_message_stats_ctx
+    (
+    message_ctx *ctx,                   /* context                   */
+    msg_stats *stats                    /* pointer to store counters */
+    );
+
+void reset_message_stats_ctx
+    (
+    message_ctx *ctx                    /* context                  */
+    );
+
+void set_stats_clock_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    msg_clock clock                     /* tick source or NULL      */
+    );
+
+void set_trace_hook_ctx
+    (
+    message_ctx *ctx,                   /* context                  */
+    msg_trace_hook hook,                /* trace hook or NULL       */
+    void *arg                           /* passed to hook           */
+    );
+
+#endif /* MESSAGE_API_H */
 /* messageAPI.h */
@@ -0,0 +1,1223 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_arq.c
+*
+*   DESCRIPTION:
+*       selective-repeat ARQ. each peer has a send window of up to
+*       ARQ_WINDOW_SIZE unacknowledged frames and a receive window
+*       that holds frames arriving ahead of a gap. acks carry the
+*       next expected sequence number and a bitmap of frames held
+*       past it, so only missing frames are sent again. windows
+*       are taken by address on first use and given up when idle.
+*       each send window has its own session number, carried in
+*       data frames and echoed in acks, so a sender that restarts
+*       or takes a new window resets the receiver rather than
+*       looking like a run of duplicates. all state is in an
+*       arq_ctx, so each message_ctx runs its own windows
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_arq.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#if ( ARQ_WINDOW_SIZE < 1 ) || ( ARQ_WINDOW_SIZE > 32 ) \
+ || ( ( ARQ_WINDOW_SIZE & ( ARQ_WINDOW_SIZE - 1 ) ) != 0 )
+#error ARQ_WINDOW_SIZE must be a power of two from 1 to 32
+#endif
+
+#define TYPE_BYTE           ( 0 )       /* frame type index         */
+
+#define SEQ_BYTE            ( 1 )       /* sequence number index    */
+
+#define BASE_BYTE           ( 2 )       /* sender window base index */
+
+#define SESSION_BYTE        ( 3 )       /* sender session index     */
+
+#define CUM_BYTE            ( 1 )       /* ack next expected index  */
+
+#define SACK_BYTE           ( 2 )       /* ack bitmap, 4 bytes      */
+
+#define ACK_SESSION_BYTE    ( 6 )       /* ack session echo index   */
+
+#define ACK_SIZE            ( 7 )       /* ack frame payload size   */
+
+#define TYPE_DATA           ( 0 )       /* reliable data frame      */
+
+#define TYPE_ACK            ( 1 )       /* acknowledgment frame     */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static arq_ctx default_arq;             /* state behind the plain
+                                           calls                    */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define slot_index( seq )   ( ( seq ) & ( ARQ_WINDOW_SIZE - 1 ) )
+
+#define seq_offset( seq, base ) ( ( uint8_t )( ( seq ) - ( base ) ) )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+static void arq_receive
+    (
+    const msg_view *view,               /* arq frame                */
+    void *arg                           /* arq_ctx                  */
+    );
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_arq_frame
+*
+*   DESCRIPTION:
+*       build ARQ payload in place and send it on MSG_PORT_ARQ
+*
+*   RETURN:
+*       RX_ARRAY_SIZE_ERR when the frame can not be encoded (no
+*       key for destination or the frame counter used up)
+*
+*********************************************************************/
+static lora_errors send_arq_frame
+    (
+    arq_ctx *arq,
+    location destination,
+    const uint8_t header[],
+    uint8_t header_size,
+    const uint8_t data[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* frame being sent         */
+uint8_t *payload;                       /* arq payload in frame     */
+msg_header msg;                         /* port header              */
+uint8_t frame_size;                     /* size of frame[]          */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( &msg, 0, sizeof( msg ) );
+msg.destination = destination;
+msg.port        = MSG_PORT_ARQ;
+payload         = &frame[ MSG_PORT_DATA_OFFSET ];
+
+memcpy( payload, header, header_size );
+if( size > 0 )
+    {
+    memcpy( &payload[ header_size ], data, size );
+    }
+
+frame_size = encode_message_header_ctx( arq->ctx, &msg, payload, header_size + size, frame );
+if( frame_size == 0 )
+    {
+    return RX_ARRAY_SIZE_ERR;
+    }
+
+return send_frame_ctx( arq->ctx, frame, frame_size );
+
+} /* send_arq_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_data_slot
+*
+*   DESCRIPTION:
+*       (re)send frame seq to the peer with the current window
+*       base so the receiver can skip frames given up on, and the
+*       session so it can tell a restarted sender
+*
+*********************************************************************/
+static lora_errors send_data_slot
+    (
+    arq_ctx *arq,
+    arq_tx_peer *peer,
+    uint8_t seq
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_slot *slot;                      /* frame to send            */
+uint8_t header[ ARQ_HEADER_SIZE ];      /* data frame header        */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+slot = &peer->slot[ slot_index( seq ) ];
+
+header[ TYPE_BYTE ]     = TYPE_DATA;
+header[ SEQ_BYTE ]      = seq;
+header[ BASE_BYTE ]     = peer->base;
+header[ SESSION_BYTE ]  = peer->session;
+slot->sent_ms           = arq->current_ms;
+peer->last_ms           = arq->current_ms;
+
+return send_arq_frame( arq, peer->address, header, sizeof( header ), slot->data, slot->size );
+
+} /* send_data_slot() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_ack
+*
+*   DESCRIPTION:
+*       send next expected seq, bitmap of held frames and the
+*       sender's session back to the peer
+*
+*********************************************************************/
+static void send_ack
+    (
+    arq_ctx *arq,
+    arq_rx_peer *peer
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t ack[ ACK_SIZE ];                /* ack payload              */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+ack[ TYPE_BYTE ]        = TYPE_ACK;
+ack[ CUM_BYTE ]         = peer->expected;
+ack[ SACK_BYTE ]        = ( uint8_t )( peer->map >> 24 );
+ack[ SACK_BYTE + 1 ]    = ( uint8_t )( peer->map >> 16 );
+ack[ SACK_BYTE + 2 ]    = ( uint8_t )( peer->map >> 8 );
+ack[ SACK_BYTE + 3 ]    = ( uint8_t ) peer->map;
+ack[ ACK_SESSION_BYTE ] = peer->session;
+
+peer->ack_pending   = false;
+peer->unacked       = 0;
+arq->stats.acks_sent++;
+
+( void ) send_arq_frame( arq, peer->address, ack, sizeof( ack ), NULL, 0 );
+
+} /* send_ack() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       update_rto
+*
+*   DESCRIPTION:
+*       fold rtt sample into the peer estimate, RFC 6298 style
+*
+*********************************************************************/
+static void update_rto
+    (
+    arq_tx_peer *peer,
+    uint32_t rtt
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t delta;                         /* sample error             */
+
+if( ! peer->rtt_valid )
+    {
+    peer->srtt      = rtt;
+    peer->rttvar    = rtt / 2;
+    peer->rtt_valid = true;
+    }
+else
+    {
+    delta = ( peer->srtt > rtt ) ? peer->srtt - rtt : rtt - peer->srtt;
+    peer->rttvar    = ( 3 * peer->rttvar + delta ) / 4;
+    peer->srtt      = ( 7 * peer->srtt + rtt ) / 8;
+    }
+
+peer->rto = peer->srtt + ( ( 4 * peer->rttvar > 1 ) ? 4 * peer->rttvar : 1 );
+
+if( peer->rto < ARQ_MIN_RTO_MS )
+    {
+    peer->rto = ARQ_MIN_RTO_MS;
+    }
+else if( peer->rto > ARQ_MAX_RTO_MS )
+    {
+    peer->rto = ARQ_MAX_RTO_MS;
+    }
+
+} /* update_rto() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       ack_slot
+*
+*   DESCRIPTION:
+*       release acknowledged frame, frames sent once give an rtt
+*       sample (Karn)
+*
+*********************************************************************/
+static void ack_slot
+    (
+    arq_ctx *arq,
+    arq_tx_peer *peer,
+    uint8_t seq
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_slot *slot;                      /* acked frame              */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+slot = &peer->slot[ slot_index( seq ) ];
+
+if( ! slot->in_use )
+    {
+    return;
+    }
+
+if( ! slot->retransmitted )
+    {
+    update_rto( peer, arq->current_ms - slot->sent_ms );
+    }
+
+slot->in_use = false;
+arq->stats.acked++;
+
+} /* ack_slot() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       advance_base
+*
+*   DESCRIPTION:
+*       move send window base past released frames
+*
+*********************************************************************/
+static void advance_base
+    (
+    arq_tx_peer *peer
+    )
+{
+
+while( peer->base != peer->next && ! peer->slot[ slot_index( peer->base ) ].in_use )
+    {
+    peer->base++;
+    }
+
+} /* advance_base() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       find_tx_peer
+*
+*   DESCRIPTION:
+*       find send window for destination, or a free or idle one.
+*       with claim the free one is taken for destination under a
+*       new session, without it the caller checks the address
+*
+*   RETURN:
+*       window, NULL if every window is in use
+*
+*********************************************************************/
+static arq_tx_peer * find_tx_peer
+    (
+    arq_ctx *arq,
+    location destination,
+    bool claim
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_peer *peer;                      /* window checked           */
+arq_tx_peer *free_peer;                 /* first reusable window    */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+free_peer = NULL;
+
+for( i = 0; i < ARQ_MAX_PEERS; i++ )
+    {
+    peer = &arq->tx_peers[ i ];
+    if( peer->in_use && peer->address == destination )
+        {
+        return peer;
+        }
+
+    if( free_peer == NULL
+     && ( ! peer->in_use
+       || ( peer->base == peer->next && arq->current_ms - peer->last_ms > ARQ_PEER_TIMEOUT_MS ) ) )
+        {
+        free_peer = peer;
+        }
+    }
+
+/*----------------------------------------------------------
+A new session tells the receiver to drop what it held
+for this address
+----------------------------------------------------------*/
+if( claim && free_peer != NULL )
+    {
+    if( arq->next_session == 0 )
+        {
+        arq->next_session = 1;
+        }
+
+    memset( free_peer, 0, sizeof( *free_peer ) );
+    free_peer->in_use   = true;
+    free_peer->address  = destination;
+    free_peer->session  = arq->next_session++;
+    free_peer->last_ms  = arq->current_ms;
+    free_peer->rto      = ARQ_INITIAL_RTO_MS;
+    }
+
+return free_peer;
+
+} /* find_tx_peer() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       find_rx_peer
+*
+*   DESCRIPTION:
+*       find receive window for source, or claim a free or idle
+*       one. a claimed window has no session, so the first frame
+*       sets it
+*
+*   RETURN:
+*       window, NULL if every window is in use
+*
+*********************************************************************/
+static arq_rx_peer * find_rx_peer
+    (
+    arq_ctx *arq,
+    location source
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_rx_peer *peer;                      /* window checked           */
+arq_rx_peer *free_peer;                 /* first reusable window    */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+free_peer = NULL;
+
+for( i = 0; i < ARQ_MAX_PEERS; i++ )
+    {
+    peer = &arq->rx_peers[ i ];
+    if( peer->in_use && peer->address == source )
+        {
+        return peer;
+        }
+
+    if( free_peer == NULL
+     && ( ! peer->in_use
+       || ( peer->map == 0 && ! peer->ack_pending
+         && arq->current_ms - peer->last_ms > ARQ_PEER_TIMEOUT_MS ) ) )
+        {
+        free_peer = peer;
+        }
+    }
+
+if( free_peer != NULL )
+    {
+    memset( free_peer, 0, sizeof( *free_peer ) );
+    free_peer->in_use   = true;
+    free_peer->address  = source;
+    free_peer->last_ms  = arq->current_ms;
+    }
+
+return free_peer;
+
+} /* find_rx_peer() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       receive_ack
+*
+*   DESCRIPTION:
+*       release frames covered by an ack and resend sack holes once
+*
+*********************************************************************/
+static void receive_ack
+    (
+    arq_ctx *arq,
+    arq_tx_peer *peer,
+    const uint8_t payload[]
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_slot *slot;                      /* frame in window          */
+uint32_t sack;                          /* held frame bitmap        */
+uint8_t cum;                            /* next expected seq        */
+uint8_t in_flight;                      /* frames in window         */
+uint8_t highest;                        /* offset of highest sack   */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+cum         = payload[ CUM_BYTE ];
+sack        = ( ( uint32_t ) payload[ SACK_BYTE ] << 24 )
+            | ( ( uint32_t ) payload[ SACK_BYTE + 1 ] << 16 )
+            | ( ( uint32_t ) payload[ SACK_BYTE + 2 ] << 8 )
+            | ( uint32_t ) payload[ SACK_BYTE + 3 ];
+in_flight   = seq_offset( peer->next, peer->base );
+highest     = 0;
+
+/*----------------------------------------------------------
+Stale acks, from before the window or for an earlier
+session, are ignored
+----------------------------------------------------------*/
+if( payload[ ACK_SESSION_BYTE ] != peer->session
+ || seq_offset( cum, peer->base ) > in_flight )
+    {
+    return;
+    }
+
+/*----------------------------------------------------------
+Cumulative part
+----------------------------------------------------------*/
+while( peer->base != cum )
+    {
+    ack_slot( arq, peer, peer->base );
+    peer->base++;
+    }
+
+/*----------------------------------------------------------
+Selective part, frames held past the gap
+----------------------------------------------------------*/
+for( i = 1; i < ARQ_WINDOW_SIZE && i < seq_offset( peer->next, cum ); i++ )
+    {
+    if( sack & ( ( uint32_t ) 1 << i ) )
+        {
+        ack_slot( arq, peer, ( uint8_t )( cum + i ) );
+        highest = i;
+        }
+    }
+
+/*----------------------------------------------------------
+Frames below the highest held one were lost, send each
+hole again once without waiting for its timeout
+----------------------------------------------------------*/
+for( i = 0; i < highest; i++ )
+    {
+    slot = &peer->slot[ slot_index( ( uint8_t )( cum + i ) ) ];
+    if( slot->in_use && ! slot->fast_sent )
+        {
+        slot->fast_sent     = true;
+        slot->retransmitted = true;
+        arq->stats.retransmits++;
+        ( void ) send_data_slot( arq, peer, ( uint8_t )( cum + i ) );
+        }
+    }
+
+advance_base( peer );
+
+} /* receive_ack() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       deliver_in_order
+*
+*   DESCRIPTION:
+*       hand held frames at the front of the window to the caller
+*
+*********************************************************************/
+static void deliver_in_order
+    (
+    arq_ctx *arq,
+    arq_rx_peer *peer
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_rx_slot *slot;                      /* frame to deliver         */
+
+while( peer->map & 1 )
+    {
+    slot = &peer->slot[ slot_index( peer->expected ) ];
+    peer->map >>= 1;
+    peer->expected++;
+    peer->unacked++;
+    arq->stats.delivered++;
+
+    if( arq->deliver_cb != NULL )
+        {
+        arq->deliver_cb( peer->address, slot->data, slot->size, arq->deliver_arg );
+        }
+    }
+
+} /* deliver_in_order() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       receive_data
+*
+*   DESCRIPTION:
+*       place data frame in the receive window and ack as needed
+*
+*********************************************************************/
+static void receive_data
+    (
+    arq_ctx *arq,
+    arq_rx_peer *peer,
+    const uint8_t payload[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_rx_slot *slot;                      /* slot for this frame      */
+uint8_t seq;                            /* frame sequence number    */
+uint8_t offset;                         /* seq past expected        */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+seq             = payload[ SEQ_BYTE ];
+peer->last_ms   = arq->current_ms;
+
+/*----------------------------------------------------------
+A new session means the sender restarted or took a new
+window. nothing held from the old one can be acked, so
+start over at the sender's base
+----------------------------------------------------------*/
+if( payload[ SESSION_BYTE ] != peer->session )
+    {
+    if( peer->session != 0 )
+        {
+        arq->stats.resets++;
+        }
+
+    peer->session       = payload[ SESSION_BYTE ];
+    peer->expected      = payload[ BASE_BYTE ];
+    peer->unacked       = 0;
+    peer->ack_pending   = false;
+    peer->map           = 0;
+    }
+
+/*----------------------------------------------------------
+Sender base ahead of us means it gave up on frames, step
+over them delivering anything held behind them
+----------------------------------------------------------*/
+while( peer->expected != payload[ BASE_BYTE ]
+    && seq_offset( payload[ BASE_BYTE ], peer->expected ) < 0x80 )
+    {
+    if( ! ( peer->map & 1 ) )
+        {
+        peer->map >>= 1;
+        peer->expected++;
+        }
+    deliver_in_order( arq, peer );
+    }
+
+/*----------------------------------------------------------
+Frames behind the window were delivered already, the ack
+must have been lost so send it again
+----------------------------------------------------------*/
+offset = seq_offset( seq, peer->expected );
+if( offset >= ARQ_WINDOW_SIZE )
+    {
+    if( offset >= 0x80 )
+        {
+        arq->stats.duplicates++;
+        send_ack( arq, peer );
+        }
+    else
+        {
+        arq->stats.invalid++;
+        }
+    return;
+    }
+
+if( peer->map & ( ( uint32_t ) 1 << offset ) )
+    {
+    arq->stats.duplicates++;
+    send_ack( arq, peer );
+    return;
+    }
+
+/*----------------------------------------------------------
+Hold frame and deliver whatever is now in order
+----------------------------------------------------------*/
+slot        = &peer->slot[ slot_index( seq ) ];
+slot->size  = size;
+memcpy( slot->data, &payload[ ARQ_HEADER_SIZE ], size );
+peer->map  |= ( uint32_t ) 1 << offset;
+
+if( offset != 0 )
+    {
+    arq->stats.out_of_order++;
+    send_ack( arq, peer );
+    return;
+    }
+
+deliver_in_order( arq, peer );
+
+if( peer->unacked >= ARQ_ACK_EVERY || peer->map != 0 )
+    {
+    send_ack( arq, peer );
+    }
+else
+    {
+    peer->ack_pending = true;
+    }
+
+} /* receive_data() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_receive
+*
+*   DESCRIPTION:
+*       MSG_PORT_ARQ handler
+*
+*********************************************************************/
+static void arq_receive
+    (
+    const msg_view *view,
+    void *arg
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_ctx *arq;                           /* reliable delivery state  */
+arq_rx_peer *rx_peer;                   /* window data goes to      */
+arq_tx_peer *tx_peer;                   /* window an ack is for     */
+
+arq = ( arq_ctx * ) arg;
+
+if( view->source >= MSG_MAX_MODULES || view->size < 1 )
+    {
+    arq->stats.invalid++;
+    return;
+    }
+
+/*----------------------------------------------------------
+Data larger than a window slot is invalid. data with every
+window in use is dropped unacked, the sender resends it
+once one is given up
+----------------------------------------------------------*/
+if( view->payload[ TYPE_BYTE ] == TYPE_DATA && view->size >= ARQ_HEADER_SIZE
+ && view->size <= ARQ_HEADER_SIZE + ARQ_DATA_SIZE && view->payload[ SESSION_BYTE ] != 0 )
+    {
+    rx_peer = find_rx_peer( arq, view->source );
+    if( rx_peer == NULL )
+        {
+        arq->stats.no_window++;
+        return;
+        }
+    receive_data( arq, rx_peer, view->payload, view->size - ARQ_HEADER_SIZE );
+    }
+else if( view->payload[ TYPE_BYTE ] == TYPE_ACK && view->size == ACK_SIZE )
+    {
+    tx_peer = find_tx_peer( arq, view->source, false );
+    if( tx_peer != NULL && tx_peer->in_use && tx_peer->address == view->source )
+        {
+        receive_ack( arq, tx_peer, view->payload );
+        }
+    }
+else
+    {
+    arq->stats.invalid++;
+    }
+
+} /* arq_receive() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_init_ctx
+*
+*   DESCRIPTION:
+*       reset every window and take MSG_PORT_ARQ on ctx. callback
+*       runs from get_message_ctx/get_messages_ctx as data becomes
+*       in order. sessions start at 1, see arq_seed_ctx
+*
+*********************************************************************/
+void arq_init_ctx
+    (
+    arq_ctx *arq,
+    message_ctx *ctx,
+    arq_deliver_cb callback,
+    void *arg
+    )
+{
+
+memset( arq, 0, sizeof( *arq ) );
+arq->ctx            = ctx;
+arq->deliver_cb     = callback;
+arq->deliver_arg    = arg;
+arq->next_session   = 1;
+
+set_port_handler_ctx( ctx, MSG_PORT_ARQ, arq_receive, arq );
+
+} /* arq_init_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_send_ctx
+*
+*   DESCRIPTION:
+*       queue data in the destination send window and send it.
+*       frames stay queued until acked, resent by arq_poll
+*
+*   RETURN:
+*       T/F data queued y/n. a full window, or every window in
+*       use by other peers, returns false with RX_TIMEOUT, check
+*       arq_window_free. a frame that can not be encoded returns
+*       false with RX_ARRAY_SIZE_ERR
+*
+*********************************************************************/
+bool arq_send_ctx
+    (
+    arq_ctx *arq,
+    location destination,
+    const uint8_t data[],
+    uint8_t size,
+    lora_errors *errors
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_peer *peer;                      /* send window              */
+arq_tx_slot *slot;                      /* slot for this frame      */
+uint8_t seq;                            /* frame sequence number    */
+
+/*----------------------------------------------------------
+Verify destination, size and window
+----------------------------------------------------------*/
+if( destination >= MSG_MAX_MODULES )
+    {
+    *errors = RX_INVALID_HEADER;
+    return false;
+    }
+
+if( size > ARQ_DATA_SIZE )
+    {
+    *errors = RX_ARRAY_SIZE_ERR;
+    return false;
+    }
+
+peer = find_tx_peer( arq, destination, true );
+if( peer == NULL || seq_offset( peer->next, peer->base ) >= ARQ_WINDOW_SIZE )
+    {
+    *errors = RX_TIMEOUT;
+    return false;
+    }
+
+/*----------------------------------------------------------
+Take next seq and send
+----------------------------------------------------------*/
+seq     = peer->next++;
+slot    = &peer->slot[ slot_index( seq ) ];
+
+slot->in_use        = true;
+slot->retransmitted = false;
+slot->fast_sent     = false;
+slot->retries       = 0;
+slot->size          = size;
+memcpy( slot->data, data, size );
+
+*errors = send_data_slot( arq, peer, seq );
+
+/*----------------------------------------------------------
+A frame that can not be encoded never will be, take it
+back out of the window rather than resend it
+----------------------------------------------------------*/
+if( *errors == RX_ARRAY_SIZE_ERR )
+    {
+    slot->in_use = false;
+    peer->next   = seq;
+    return false;
+    }
+
+arq->stats.sent++;
+
+return true;
+
+} /* arq_send_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_window_free_ctx
+*
+*   DESCRIPTION:
+*       number of frames arq_send can queue to destination now,
+*       0 while every window is in use by other peers
+*
+*********************************************************************/
+uint8_t arq_window_free_ctx
+    (
+    arq_ctx *arq,
+    location destination
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_peer *peer;                      /* send window              */
+
+if( destination >= MSG_MAX_MODULES )
+    {
+    return 0;
+    }
+
+peer = find_tx_peer( arq, destination, false );
+if( peer == NULL )
+    {
+    return 0;
+    }
+
+if( ! peer->in_use || peer->address != destination )
+    {
+    return ARQ_WINDOW_SIZE;
+    }
+
+return ARQ_WINDOW_SIZE - seq_offset( peer->next, peer->base );
+
+} /* arq_window_free_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_poll_ctx
+*
+*   DESCRIPTION:
+*       advance clock, resend frames past their timeout and send
+*       delayed acks. call periodically and after get_message
+*
+*********************************************************************/
+void arq_poll_ctx
+    (
+    arq_ctx *arq,
+    uint32_t now_ms
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_peer *peer;                      /* send window              */
+arq_tx_slot *slot;                      /* frame in window          */
+bool timed_out;                         /* any resend for peer      */
+uint8_t i;                              /* window iterator          */
+uint8_t seq;                            /* seq iterator             */
+
+arq->current_ms = now_ms;
+
+for( i = 0; i < ARQ_MAX_PEERS; i++ )
+    {
+    /*------------------------------------------------------
+    Delayed ack
+    ------------------------------------------------------*/
+    if( arq->rx_peers[ i ].in_use && arq->rx_peers[ i ].ack_pending )
+        {
+        send_ack( arq, &arq->rx_peers[ i ] );
+        }
+
+    /*------------------------------------------------------
+    Resend expired frames, give up after ARQ_MAX_RETRIES
+    ------------------------------------------------------*/
+    peer        = &arq->tx_peers[ i ];
+    timed_out   = false;
+
+    for( seq = peer->base; seq != peer->next; seq++ )
+        {
+        slot = &peer->slot[ slot_index( seq ) ];
+        if( ! slot->in_use || now_ms - slot->sent_ms < peer->rto )
+            {
+            continue;
+            }
+
+        if( slot->retries >= ARQ_MAX_RETRIES )
+            {
+            slot->in_use = false;
+            arq->stats.failed++;
+            continue;
+            }
+
+        slot->retries++;
+        slot->retransmitted = true;
+        timed_out           = true;
+        arq->stats.retransmits++;
+        ( void ) send_data_slot( arq, peer, seq );
+        }
+
+    /*------------------------------------------------------
+    Back off once per timeout round
+    ------------------------------------------------------*/
+    if( timed_out )
+        {
+        peer->rto = ( peer->rto * 2 > ARQ_MAX_RTO_MS ) ? ARQ_MAX_RTO_MS : peer->rto * 2;
+        }
+
+    advance_base( peer );
+    }
+
+} /* arq_poll_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_get_rto_ctx
+*
+*   DESCRIPTION:
+*       current retransmit timeout to destination in ms, the
+*       initial one if it has no window yet
+*
+*********************************************************************/
+uint32_t arq_get_rto_ctx
+    (
+    arq_ctx *arq,
+    location destination
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+arq_tx_peer *peer;                      /* send window              */
+
+if( destination >= MSG_MAX_MODULES )
+    {
+    return 0;
+    }
+
+peer = find_tx_peer( arq, destination, false );
+if( peer == NULL || ! peer->in_use || peer->address != destination )
+    {
+    return ARQ_INITIAL_RTO_MS;
+    }
+
+return peer->rto;
+
+} /* arq_get_rto_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_seed_ctx
+*
+*   DESCRIPTION:
+*       set the session of the next send window taken. sessions
+*       otherwise start at 1 on every arq_init, so a module that
+*       reboots must seed with something that differs from its last
+*       boot, a random value or a count kept in flash, for its peers
+*       to see the restart. call after arq_init_ctx
+*
+*********************************************************************/
+void arq_seed_ctx
+    (
+    arq_ctx *arq,
+    uint8_t seed
+    )
+{
+
+arq->next_session = seed;
+
+} /* arq_seed_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_get_stats_ctx
+*
+*   DESCRIPTION:
+*       copy reliable delivery counters
+*
+*********************************************************************/
+void arq_get_stats_ctx
+    (
+    arq_ctx *arq,
+    arq_stats *stats
+    )
+{
+
+*stats = arq->stats;
+
+} /* arq_get_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_init
+*
+*   DESCRIPTION:
+*       arq_init_ctx on the default context
+*
+*********************************************************************/
+void arq_init
+    (
+    arq_deliver_cb callback,
+    void *arg
+    )
+{
+
+arq_init_ctx( &default_arq, get_default_ctx(), callback, arg );
+
+} /* arq_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_send
+*
+*   DESCRIPTION:
+*       arq_send_ctx on the default context
+*
+*********************************************************************/
+bool arq_send
+    (
+    location destination,
+    const uint8_t data[],
+    uint8_t size,
+    lora_errors *errors
+    )
+{
+
+return arq_send_ctx( &default_arq, destination, data, size, errors );
+
+} /* arq_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_window_free
+*
+*   DESCRIPTION:
+*       arq_window_free_ctx on the default context
+*
+*********************************************************************/
+uint8_t arq_window_free
+    (
+    location destination
+    )
+{
+
+return arq_window_free_ctx( &default_arq, destination );
+
+} /* arq_window_free() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_poll
+*
+*   DESCRIPTION:
+*       arq_poll_ctx on the default context
+*
+*********************************************************************/
+void arq_poll
+    (
+    uint32_t now_ms
+    )
+{
+
+arq_poll_ctx( &default_arq, now_ms );
+
+} /* arq_poll() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_get_rto
+*
+*   DESCRIPTION:
+*       arq_get_rto_ctx on the default context
+*
+*********************************************************************/
+uint32_t arq_get_rto
+    (
+    location destination
+    )
+{
+
+return arq_get_rto_ctx( &default_arq, destination );
+
+} /* arq_get_rto() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_seed
+*
+*   DESCRIPTION:
+*       arq_seed_ctx on the default context
+*
+*********************************************************************/
+void arq_seed
+    (
+    uint8_t seed
+    )
+{
+
+arq_seed_ctx( &default_arq, seed );
+
+} /* arq_seed() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       arq_get_stats
+*
+*   DESCRIPTION:
+*       arq_get_stats_ctx on the default context
+*
+*********************************************************************/
+void arq_get_stats
+    (
+    arq_stats *stats
+    )
+{
+
+arq_get_stats_ctx( &default_arq, stats );
+
+} /* arq_get_stats() */
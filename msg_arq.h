@@ -0,0 +1,275 @@
+/*********************************************************************
+*
+*   HEADER:
+*       reliable delivery for messageAPI. selective-repeat ARQ on
+*       MSG_PORT_ARQ with per-peer sequence numbers, cumulative and
+*       selective acks, a sliding send window and retransmit
+*       timeouts taken from measured round trip times. every
+*       frame carries the sender's session, so a peer that restarts
+*       is seen and its receive window reset. an arq_ctx holds the
+*       windows for one message_ctx, the plain calls use one on the
+*       default context
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_ARQ_H
+#define MSG_ARQ_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define ARQ_HEADER_SIZE     ( 4 )       /* type, seq, base and
+                                           session                  */
+
+#define ARQ_DATA_SIZE       ( MAX_SECURE_LENGTH_V2 - 1 - ARQ_HEADER_SIZE )
+                                        /* data per reliable frame  */
+
+#ifndef ARQ_WINDOW_SIZE
+#define ARQ_WINDOW_SIZE     ( 8 )       /* frames in flight a peer,
+                                           power of two up to 32 and
+                                           the same on every module */
+#endif
+
+#ifndef ARQ_ACK_EVERY
+#define ARQ_ACK_EVERY       ( ARQ_WINDOW_SIZE / 2 )
+                                        /* in order frames before an
+                                           ack is sent without
+                                           waiting for arq_poll     */
+#endif
+
+#ifndef ARQ_MAX_PEERS
+#define ARQ_MAX_PEERS       ( NUM_OF_MODULES )
+                                        /* peers with windows at once,
+                                           any address below
+                                           MSG_MAX_MODULES takes one
+                                           on first use             */
+#endif
+
+#ifndef ARQ_INITIAL_RTO_MS
+#define ARQ_INITIAL_RTO_MS  ( 1000 )    /* timeout before first rtt */
+#endif
+
+#ifndef ARQ_MIN_RTO_MS
+#define ARQ_MIN_RTO_MS      ( 50 )      /* retransmit timeout floor */
+#endif
+
+#ifndef ARQ_MAX_RTO_MS
+#define ARQ_MAX_RTO_MS      ( 16000 )   /* retransmit timeout cap   */
+#endif
+
+#ifndef ARQ_MAX_RETRIES
+#define ARQ_MAX_RETRIES     ( 8 )       /* retransmits before frame
+                                           is given up              */
+#endif
+
+#ifndef ARQ_PEER_TIMEOUT_MS
+#define ARQ_PEER_TIMEOUT_MS ( ARQ_MAX_RTO_MS * ( ARQ_MAX_RETRIES + 1 ) )
+                                        /* idle time before a peer's
+                                           window can go to another */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef void ( *arq_deliver_cb )        /* in order reliable data   */
+    (
+    location source,                    /* sending module           */
+    const uint8_t data[],               /* received data            */
+    uint8_t size,                       /* size of data[]           */
+    void *arg                           /* arq_init argument        */
+    );
+
+typedef struct                          /* reliable delivery counts */
+    {
+    uint32_t sent;                      /* new frames sent          */
+    uint32_t retransmits;               /* frames sent again        */
+    uint32_t acked;                     /* frames acknowledged      */
+    uint32_t failed;                    /* frames given up          */
+    uint32_t delivered;                 /* frames handed to caller  */
+    uint32_t duplicates;                /* frames received twice    */
+    uint32_t out_of_order;              /* frames held for a gap    */
+    uint32_t acks_sent;                 /* ack frames sent          */
+    uint32_t invalid;                   /* bad arq header           */
+    uint32_t resets;                    /* peer sessions restarted  */
+    uint32_t no_window;                 /* frames dropped, every
+                                           window in use            */
+    } arq_stats;
+
+typedef struct                          /* frame awaiting ack       */
+    {
+    bool in_use;                        /* sent and not acked       */
+    bool retransmitted;                 /* no rtt sample if resent  */
+    bool fast_sent;                     /* resent for a sack hole   */
+    uint8_t retries;                    /* timeouts so far          */
+    uint8_t size;                       /* size of data[]           */
+    uint32_t sent_ms;                   /* time of last send        */
+    uint8_t data[ ARQ_DATA_SIZE ];      /* frame data               */
+    } arq_tx_slot;
+
+typedef struct                          /* send side of a peer      */
+    {
+    bool in_use;                        /* window taken by address  */
+    location address;                   /* destination module       */
+    uint8_t session;                    /* sent in every frame      */
+    uint32_t last_ms;                   /* time of last send        */
+    uint8_t base;                       /* oldest unacked seq       */
+    uint8_t next;                       /* seq of next new frame    */
+    bool rtt_valid;                     /* srtt has a sample        */
+    uint32_t srtt;                      /* smoothed rtt in ms       */
+    uint32_t rttvar;                    /* rtt variation in ms      */
+    uint32_t rto;                       /* retransmit timeout in ms */
+    arq_tx_slot slot[ ARQ_WINDOW_SIZE ];/* indexed by seq           */
+    } arq_tx_peer;
+
+typedef struct                          /* frame held for a gap     */
+    {
+    uint8_t size;                       /* size of data[]           */
+    uint8_t data[ ARQ_DATA_SIZE ];      /* frame data               */
+    } arq_rx_slot;
+
+typedef struct                          /* receive side of a peer   */
+    {
+    bool in_use;                        /* window taken by address  */
+    location address;                   /* sending module           */
+    uint8_t session;                    /* sender session, 0 none   */
+    uint32_t last_ms;                   /* time of last frame       */
+    uint8_t expected;                   /* next in order seq        */
+    uint8_t unacked;                    /* delivered since last ack */
+    bool ack_pending;                   /* ack owed at next poll    */
+    uint32_t map;                       /* bit n: expected + n held */
+    arq_rx_slot slot[ ARQ_WINDOW_SIZE ];/* indexed by seq           */
+    } arq_rx_peer;
+
+typedef struct                          /* reliable delivery on one
+                                           message_ctx              */
+    {
+    message_ctx *ctx;                   /* context sent and taken on */
+    arq_tx_peer tx_peers[ ARQ_MAX_PEERS ];  /* send windows         */
+    arq_rx_peer rx_peers[ ARQ_MAX_PEERS ];  /* receive windows      */
+    arq_deliver_cb deliver_cb;          /* received data hook       */
+    void *deliver_arg;                  /* passed to deliver_cb     */
+    uint32_t current_ms;                /* time of last arq_poll    */
+    uint8_t next_session;               /* session of next send
+                                           window taken             */
+    arq_stats stats;                    /* reliable delivery counts */
+    } arq_ctx;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_arq.c
+--------------------------------------------------------------------*/
+void arq_init
+    (
+    arq_deliver_cb callback,            /* received data hook       */
+    void *arg                           /* passed to callback       */
+    );
+
+bool arq_send
+    (
+    location destination,               /* destination module       */
+    const uint8_t data[],               /* data to send             */
+    uint8_t size,                       /* size of data[]           */
+    lora_errors *errors                 /* pointer to store errors  */
+    );
+
+uint8_t arq_window_free
+    (
+    location destination                /* destination module       */
+    );
+
+void arq_poll
+    (
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+uint32_t arq_get_rto
+    (
+    location destination                /* destination module       */
+    );
+
+void arq_seed
+    (
+    uint8_t seed                        /* first session number     */
+    );
+
+void arq_get_stats
+    (
+    arq_stats *stats                    /* pointer to store stats   */
+    );
+
+/*--------------------------------------------------------------------
+msg_arq.c -- context variants, the calls above run on the default
+message_ctx
+--------------------------------------------------------------------*/
+void arq_init_ctx
+    (
+    arq_ctx *arq,                       /* reliable delivery state  */
+    message_ctx *ctx,                   /* initialized context      */
+    arq_deliver_cb callback,            /* received data hook       */
+    void *arg                           /* passed to callback       */
+    );
+
+bool arq_send_ctx
+    (
+    arq_ctx *arq,                       /* reliable delivery state  */
+    location destination,               /* destination module       */
+    const uint8_t data[],               /* data to send             */
+    uint8_t size,                       /* size of data[]           */
+    lora_errors *errors                 /* pointer to store errors  */
+    );
+
+uint8_t arq_window_free_ctx
+    (
+    arq_ctx *arq,                       /* reliable delivery state  */
+    location destination                /* destination module       */
+    );
+
+void arq_poll_ctx
+    (
+    arq_ctx *arq,                       /* reliable delivery state  */
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+uint32_t arq_get_rto_ctx
+    (
+    arq_ctx *arq,                       /* reliable delivery state  */
+    location destination                /* destination module       */
+    );
+
+void arq_seed_ctx
+    (
+    arq_ctx *arq,                       /* reliable delivery state  */
+    uint8_t seed                        /* first session number     */
+    );
+
+void arq_get_stats_ctx
+    (
+    arq_ctx *arq,                       /* reliable delivery state  */
+    arq_stats *stats                    /* pointer to store stats   */
+    );
+
+#endif /* MSG_ARQ_H */
+/* msg_arq.h */
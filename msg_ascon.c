@@ -0,0 +1,430 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_ascon.c
+*
+*   DESCRIPTION:
+*       ASCON-128 as in the NIST lightweight cryptography final
+*       round (v1.2). bytes are read into the 64 bit state words
+*       big endian, so results match the published test vectors
+*       on any host
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_ascon.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define ASCON_128_IV        ( 0x80400C0600000000ULL )
+                                        /* key bits, rate, a and b  */
+
+#define RATE                ( 8 )       /* bytes absorbed a round   */
+
+#define ROUNDS_A            ( 12 )      /* init and final rounds    */
+
+#define ROUNDS_B            ( 6 )       /* rounds between blocks    */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* permutation state        */
+    {
+    uint64_t x[ 5 ];
+    } ascon_state;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define ror( x, n )         ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 64 - ( n ) ) ) )
+
+#define pad( n )            ( 0x80ULL << ( 56 - 8 * ( n ) ) )
+
+#define top_bytes( n )      ( ( n ) == 0 ? 0 : ~0ULL << ( 64 - 8 * ( n ) ) )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       load_bytes
+*
+*   DESCRIPTION:
+*       read up to 8 bytes big endian into the top of a word
+*
+*********************************************************************/
+static uint64_t load_bytes
+    (
+    const uint8_t bytes[],
+    size_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t word;                          /* word being built         */
+size_t i;                               /* iterator                 */
+
+word = 0;
+for( i = 0; i < size; i++ )
+    {
+    word |= ( uint64_t ) bytes[ i ] << ( 56 - 8 * i );
+    }
+
+return word;
+
+} /* load_bytes() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       store_bytes
+*
+*   DESCRIPTION:
+*       write the top size bytes of a word big endian
+*
+*********************************************************************/
+static void store_bytes
+    (
+    uint8_t bytes[],
+    uint64_t word,
+    size_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+size_t i;                               /* iterator                 */
+
+for( i = 0; i < size; i++ )
+    {
+    bytes[ i ] = ( uint8_t )( word >> ( 56 - 8 * i ) );
+    }
+
+} /* store_bytes() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       permute
+*
+*   DESCRIPTION:
+*       last rounds of the ASCON permutation, 12 for p^a and 6 for
+*       p^b. the s-box is the bitsliced form from the spec
+*
+*********************************************************************/
+static void permute
+    (
+    ascon_state *s,
+    uint8_t rounds
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t x0, x1, x2, x3, x4;            /* state words              */
+uint64_t t0, t1, t2, t3, t4;            /* s-box temporaries        */
+uint8_t round;                          /* round constant index     */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+x0 = s->x[ 0 ];
+x1 = s->x[ 1 ];
+x2 = s->x[ 2 ];
+x3 = s->x[ 3 ];
+x4 = s->x[ 4 ];
+
+for( round = ROUNDS_A - rounds; round < ROUNDS_A; round++ )
+    {
+    /*------------------------------------------------------
+    Round constant 0xf0, 0xe1 .. 0x4b
+    ------------------------------------------------------*/
+    x2 ^= ( uint64_t )( ( ( 0x0F - round ) << 4 ) | round );
+
+    /*------------------------------------------------------
+    Substitution layer
+    ------------------------------------------------------*/
+    x0 ^= x4;
+    x4 ^= x3;
+    x2 ^= x1;
+    t0 = ~x0 & x1;
+    t1 = ~x1 & x2;
+    t2 = ~x2 & x3;
+    t3 = ~x3 & x4;
+    t4 = ~x4 & x0;
+    x0 ^= t1;
+    x1 ^= t2;
+    x2 ^= t3;
+    x3 ^= t4;
+    x4 ^= t0;
+    x1 ^= x0;
+    x0 ^= x4;
+    x3 ^= x2;
+    x2 = ~x2;
+
+    /*------------------------------------------------------
+    Linear diffusion layer
+    ------------------------------------------------------*/
+    x0 ^= ror( x0, 19 ) ^ ror( x0, 28 );
+    x1 ^= ror( x1, 61 ) ^ ror( x1, 39 );
+    x2 ^= ror( x2, 1 ) ^ ror( x2, 6 );
+    x3 ^= ror( x3, 10 ) ^ ror( x3, 17 );
+    x4 ^= ror( x4, 7 ) ^ ror( x4, 41 );
+    }
+
+s->x[ 0 ] = x0;
+s->x[ 1 ] = x1;
+s->x[ 2 ] = x2;
+s->x[ 3 ] = x3;
+s->x[ 4 ] = x4;
+
+} /* permute() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       start
+*
+*   DESCRIPTION:
+*       initialize state from key and nonce and absorb the
+*       associated data
+*
+*********************************************************************/
+static void start
+    (
+    ascon_state *s,
+    const ascon_key *key,
+    const uint8_t nonce[],
+    const uint8_t ad[],
+    size_t ad_size
+    )
+{
+
+s->x[ 0 ] = ASCON_128_IV;
+s->x[ 1 ] = key->k0;
+s->x[ 2 ] = key->k1;
+s->x[ 3 ] = load_bytes( nonce, 8 );
+s->x[ 4 ] = load_bytes( &nonce[ 8 ], 8 );
+permute( s, ROUNDS_A );
+s->x[ 3 ] ^= key->k0;
+s->x[ 4 ] ^= key->k1;
+
+/*----------------------------------------------------------
+Associated data, padded, then domain separation
+----------------------------------------------------------*/
+if( ad_size > 0 )
+    {
+    while( ad_size >= RATE )
+        {
+        s->x[ 0 ] ^= load_bytes( ad, RATE );
+        permute( s, ROUNDS_B );
+        ad      += RATE;
+        ad_size -= RATE;
+        }
+
+    s->x[ 0 ] ^= load_bytes( ad, ad_size ) ^ pad( ad_size );
+    permute( s, ROUNDS_B );
+    }
+
+s->x[ 4 ] ^= 1;
+
+} /* start() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       finish
+*
+*   DESCRIPTION:
+*       finalize state and write the first tag_size tag bytes
+*
+*********************************************************************/
+static void finish
+    (
+    ascon_state *s,
+    const ascon_key *key,
+    uint8_t tag[],
+    size_t tag_size
+    )
+{
+
+s->x[ 1 ] ^= key->k0;
+s->x[ 2 ] ^= key->k1;
+permute( s, ROUNDS_A );
+s->x[ 3 ] ^= key->k0;
+s->x[ 4 ] ^= key->k1;
+
+store_bytes( tag, s->x[ 3 ], ( tag_size < 8 ) ? tag_size : 8 );
+if( tag_size > 8 )
+    {
+    store_bytes( &tag[ 8 ], s->x[ 4 ], tag_size - 8 );
+    }
+
+} /* finish() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       ascon_load_key
+*
+*   DESCRIPTION:
+*       read key into state words once so each frame starts from
+*       them directly
+*
+*********************************************************************/
+void ascon_load_key
+    (
+    ascon_key *key,
+    const uint8_t bytes[]
+    )
+{
+
+key->k0 = load_bytes( bytes, 8 );
+key->k1 = load_bytes( &bytes[ 8 ], 8 );
+
+} /* ascon_load_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       ascon_encrypt
+*
+*   DESCRIPTION:
+*       encrypt data in place and write a tag over ad and data
+*
+*********************************************************************/
+void ascon_encrypt
+    (
+    const ascon_key *key,
+    const uint8_t nonce[],
+    const uint8_t ad[],
+    size_t ad_size,
+    uint8_t data[],
+    size_t size,
+    uint8_t tag[],
+    size_t tag_size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+ascon_state s;                          /* permutation state        */
+
+start( &s, key, nonce, ad, ad_size );
+
+while( size >= RATE )
+    {
+    s.x[ 0 ] ^= load_bytes( data, RATE );
+    store_bytes( data, s.x[ 0 ], RATE );
+    permute( &s, ROUNDS_B );
+    data += RATE;
+    size -= RATE;
+    }
+
+s.x[ 0 ] ^= load_bytes( data, size ) ^ pad( size );
+store_bytes( data, s.x[ 0 ], size );
+
+finish( &s, key, tag, tag_size );
+
+} /* ascon_encrypt() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       ascon_decrypt
+*
+*   DESCRIPTION:
+*       decrypt data in place and check the tag. data is zeroed
+*       when the tag does not match
+*
+*   RETURN:
+*       T/F tag matched y/n
+*
+*********************************************************************/
+bool ascon_decrypt
+    (
+    const ascon_key *key,
+    const uint8_t nonce[],
+    const uint8_t ad[],
+    size_t ad_size,
+    uint8_t data[],
+    size_t size,
+    const uint8_t tag[],
+    size_t tag_size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+ascon_state s;                          /* permutation state        */
+uint8_t expected[ ASCON_TAG_SIZE ];     /* tag worked out           */
+uint8_t *start_data;                    /* data for clearing        */
+size_t start_size;                      /* size for clearing        */
+uint64_t c;                             /* ciphertext word          */
+uint8_t diff;                           /* tag bytes differing      */
+size_t i;                               /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+start_data = data;
+start_size = size;
+
+start( &s, key, nonce, ad, ad_size );
+
+while( size >= RATE )
+    {
+    c = load_bytes( data, RATE );
+    store_bytes( data, s.x[ 0 ] ^ c, RATE );
+    s.x[ 0 ] = c;
+    permute( &s, ROUNDS_B );
+    data += RATE;
+    size -= RATE;
+    }
+
+c = load_bytes( data, size );
+store_bytes( data, s.x[ 0 ] ^ c, size );
+s.x[ 0 ] = ( s.x[ 0 ] & ~top_bytes( size ) ) ^ c ^ pad( size );
+
+finish( &s, key, expected, tag_size );
+
+/*----------------------------------------------------------
+Compare without an early exit
+----------------------------------------------------------*/
+diff = 0;
+for( i = 0; i < tag_size; i++ )
+    {
+    diff |= expected[ i ] ^ tag[ i ];
+    }
+
+if( diff != 0 )
+    {
+    memset( start_data, 0, start_size );
+    return false;
+    }
+
+return true;
+
+} /* ascon_decrypt() */
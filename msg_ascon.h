@@ -0,0 +1,88 @@
+/*********************************************************************
+*
+*   HEADER:
+*       ASCON-128 authenticated encryption for messageAPI. 128 bit
+*       key and nonce, 64 bit rate, tag of up to 16 bytes. works in
+*       place so frames are encrypted where they were encoded
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_ASCON_H
+#define MSG_ASCON_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define ASCON_KEY_SIZE      ( 16 )      /* key bytes                */
+
+#define ASCON_NONCE_SIZE    ( 16 )      /* nonce bytes              */
+
+#define ASCON_TAG_SIZE      ( 16 )      /* full tag bytes           */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* key loaded for use       */
+    {
+    uint64_t k0;                        /* key bytes 0-7            */
+    uint64_t k1;                        /* key bytes 8-15           */
+    } ascon_key;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_ascon.c
+--------------------------------------------------------------------*/
+void ascon_load_key
+    (
+    ascon_key *key,                     /* loaded key               */
+    const uint8_t bytes[]               /* ASCON_KEY_SIZE bytes     */
+    );
+
+void ascon_encrypt
+    (
+    const ascon_key *key,               /* loaded key               */
+    const uint8_t nonce[],              /* ASCON_NONCE_SIZE bytes   */
+    const uint8_t ad[],                 /* authenticated only       */
+    size_t ad_size,                     /* size of ad[]             */
+    uint8_t data[],                     /* encrypted in place       */
+    size_t size,                        /* size of data[]           */
+    uint8_t tag[],                      /* tag out                  */
+    size_t tag_size                     /* 1 to ASCON_TAG_SIZE      */
+    );
+
+bool ascon_decrypt
+    (
+    const ascon_key *key,               /* loaded key               */
+    const uint8_t nonce[],              /* ASCON_NONCE_SIZE bytes   */
+    const uint8_t ad[],                 /* authenticated only       */
+    size_t ad_size,                     /* size of ad[]             */
+    uint8_t data[],                     /* decrypted in place       */
+    size_t size,                        /* size of data[]           */
+    const uint8_t tag[],                /* tag received             */
+    size_t tag_size                     /* 1 to ASCON_TAG_SIZE      */
+    );
+
+#endif /* MSG_ASCON_H */
+/* msg_ascon.h */
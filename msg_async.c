@@ -0,0 +1,756 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_async.c
+*
+*   DESCRIPTION:
+*       async mode. the I/O thread is the only caller of the
+*       message_ctx: it drains the tx ring into send bursts, reads
+*       the radio with get_messages and fills the rx ring.
+*
+*       the tx ring is a bounded MPSC queue where every slot carries
+*       a sequence number. a producer claims a slot by moving tail
+*       with compare-exchange once the slot's sequence says it is
+*       free, fills it and publishes it by bumping the sequence. the
+*       consumer and the SPSC rx ring never retry.
+*
+*       when idle the I/O thread blocks in poll() on the transport
+*       descriptor and tx_event_fd. it raises io_sleeping before
+*       its last look at the tx ring, and producers only write the
+*       eventfd when they see it raised, so a busy ring costs no
+*       system calls and a message queued during the check still
+*       wakes the thread. rx_event_fd works the same way in the
+*       other direction: rx_signaled is raised with the write and
+*       lowered by the reader that clears it, so there is one write
+*       and one read per wake up rather than per message
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_async.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#if ( MSG_ASYNC_RX_CAPACITY & ( MSG_ASYNC_RX_CAPACITY - 1 ) ) != 0 \
+ || ( MSG_ASYNC_TX_CAPACITY & ( MSG_ASYNC_TX_CAPACITY - 1 ) ) != 0
+#error MSG_ASYNC_RX_CAPACITY and MSG_ASYNC_TX_CAPACITY must be powers of two
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rx_ring_push
+*
+*   DESCRIPTION:
+*       add message to rx ring, I/O thread only
+*
+*   RETURN:
+*       T/F message queued y/n
+*
+*********************************************************************/
+static bool rx_ring_push
+    (
+    msg_rx_ring *ring,
+    const rx_message *message
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+size_t tail;                            /* slot to fill             */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+tail = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+
+if( tail - atomic_load_explicit( &ring->head, memory_order_acquire ) >= MSG_ASYNC_RX_CAPACITY )
+    {
+    return false;
+    }
+
+ring->slots[ tail & ( MSG_ASYNC_RX_CAPACITY - 1 ) ] = *message;
+atomic_store_explicit( &ring->tail, tail + 1, memory_order_release );
+
+return true;
+
+} /* rx_ring_push() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rx_ring_pop
+*
+*   DESCRIPTION:
+*       take oldest message from rx ring, one reader thread only
+*
+*   RETURN:
+*       T/F message taken y/n
+*
+*********************************************************************/
+static bool rx_ring_pop
+    (
+    msg_rx_ring *ring,
+    rx_message *message
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+size_t head;                            /* slot to take             */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+
+if( head == atomic_load_explicit( &ring->tail, memory_order_acquire ) )
+    {
+    return false;
+    }
+
+*message = ring->slots[ head & ( MSG_ASYNC_RX_CAPACITY - 1 ) ];
+atomic_store_explicit( &ring->head, head + 1, memory_order_release );
+
+return true;
+
+} /* rx_ring_pop() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tx_ring_push
+*
+*   DESCRIPTION:
+*       add message to tx ring from any thread. slot sequence ==
+*       position means free for that position, position + 1 means
+*       filled
+*
+*   RETURN:
+*       T/F message queued y/n
+*
+*********************************************************************/
+static bool tx_ring_push
+    (
+    msg_tx_ring *ring,
+    const tx_message *message
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_tx_slot *slot;                      /* slot being claimed       */
+size_t position;                        /* tail seen                */
+size_t sequence;                        /* slot turn                */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+position = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+
+/*----------------------------------------------------------
+Claim a slot, retrying only when another producer took
+the same one first
+----------------------------------------------------------*/
+for( ;; )
+    {
+    slot     = &ring->slots[ position & ( MSG_ASYNC_TX_CAPACITY - 1 ) ];
+    sequence = atomic_load_explicit( &slot->sequence, memory_order_acquire );
+
+    if( sequence == position )
+        {
+        if( atomic_compare_exchange_weak_explicit( &ring->tail, &position, position + 1,
+                                                   memory_order_relaxed, memory_order_relaxed ) )
+            {
+            break;
+            }
+        }
+    else if( ( ptrdiff_t )( sequence - position ) < 0 )
+        {
+        return false;
+        }
+    else
+        {
+        position = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+        }
+    }
+
+/*----------------------------------------------------------
+Fill and publish
+----------------------------------------------------------*/
+slot->message = *message;
+atomic_store_explicit( &slot->sequence, position + 1, memory_order_release );
+
+return true;
+
+} /* tx_ring_push() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tx_ring_pop
+*
+*   DESCRIPTION:
+*       take oldest message from tx ring, I/O thread only
+*
+*   RETURN:
+*       T/F message taken y/n
+*
+*********************************************************************/
+static bool tx_ring_pop
+    (
+    msg_tx_ring *ring,
+    tx_message *message
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_tx_slot *slot;                      /* slot to take             */
+size_t head;                            /* position to take         */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+slot = &ring->slots[ head & ( MSG_ASYNC_TX_CAPACITY - 1 ) ];
+
+if( atomic_load_explicit( &slot->sequence, memory_order_acquire ) != head + 1 )
+    {
+    return false;
+    }
+
+*message = slot->message;
+atomic_store_explicit( &slot->sequence, head + MSG_ASYNC_TX_CAPACITY, memory_order_release );
+atomic_store_explicit( &ring->head, head + 1, memory_order_relaxed );
+
+return true;
+
+} /* tx_ring_pop() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       signal_event
+*
+*   DESCRIPTION:
+*       make eventfd readable
+*
+*********************************************************************/
+static void signal_event
+    (
+    int fd
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t one;                           /* eventfd increment        */
+
+one = 1;
+while( write( fd, &one, sizeof( one ) ) < 0 && errno == EINTR )
+    {
+    }
+
+} /* signal_event() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       clear_event
+*
+*   DESCRIPTION:
+*       reset eventfd, it is non-blocking so an unset fd is fine
+*
+*********************************************************************/
+static void clear_event
+    (
+    int fd
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t count;                         /* eventfd counter          */
+
+( void ) read( fd, &count, sizeof( count ) );
+
+} /* clear_event() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tx_ring_empty
+*
+*   DESCRIPTION:
+*       check for a published message without taking it, I/O
+*       thread only
+*
+*   RETURN:
+*       T/F nothing to send y/n
+*
+*********************************************************************/
+static bool tx_ring_empty
+    (
+    msg_tx_ring *ring
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+size_t head;                            /* next position to take    */
+
+head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+
+return atomic_load_explicit( &ring->slots[ head & ( MSG_ASYNC_TX_CAPACITY - 1 ) ].sequence,
+                             memory_order_acquire ) != head + 1;
+
+} /* tx_ring_empty() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       io_wait
+*
+*   DESCRIPTION:
+*       block until a frame may be waiting on the transport, a
+*       message is queued, msg_async_stop is called or the idle
+*       timeout runs out
+*
+*********************************************************************/
+static void io_wait
+    (
+    msg_async *async
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+struct pollfd fds[ 2 ];                 /* tx event, transport      */
+nfds_t count;                           /* descriptors in fds[]     */
+int timeout;                            /* poll timeout in ms       */
+int transport_fd;                       /* transport descriptor     */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+transport_fd    = ( async->ctx->transport.wait_fd != NULL )
+                ? async->ctx->transport.wait_fd( async->ctx->transport.port ) : -1;
+fds[ 0 ].fd     = async->tx_event_fd;
+fds[ 0 ].events = POLLIN;
+count           = 1;
+timeout         = ( MSG_ASYNC_IDLE_US + 999 ) / 1000;
+
+if( transport_fd >= 0 )
+    {
+    fds[ 1 ].fd     = transport_fd;
+    fds[ 1 ].events = POLLIN;
+    count           = 2;
+    timeout         = MSG_ASYNC_WAIT_MS;
+    }
+
+/*----------------------------------------------------------
+Announce the sleep, then look at the ring one last time.
+pairs with the fence in msg_async_send
+----------------------------------------------------------*/
+atomic_store( &async->io_sleeping, true );
+atomic_thread_fence( memory_order_seq_cst );
+
+if( tx_ring_empty( &async->tx )
+ && atomic_load_explicit( &async->running, memory_order_acquire ) )
+    {
+    ( void ) poll( fds, count, timeout );
+    }
+
+atomic_store( &async->io_sleeping, false );
+clear_event( async->tx_event_fd );
+
+} /* io_wait() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       io_thread
+*
+*   DESCRIPTION:
+*       own the radio: send queued messages as bursts, move
+*       received messages to the rx ring, wait in io_wait when
+*       idle
+*
+*********************************************************************/
+static void * io_thread
+    (
+    void *arg
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_async *async;                       /* instance                 */
+tx_message burst[ MSG_BURST_MESSAGES ]; /* messages to send         */
+lora_errors burst_errors[ MSG_BURST_MESSAGES ]; /* per message      */
+rx_message received[ MSG_BURST_MESSAGES ]; /* messages read         */
+lora_errors errors;                     /* receive errors           */
+uint8_t count;                          /* messages in burst        */
+uint8_t reads;                          /* radio reads this pass    */
+uint32_t seen;                          /* frames seen before read  */
+uint8_t i;                              /* iterator                 */
+bool busy;                              /* work done this pass      */
+bool queued;                            /* rx ring got a message    */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+async           = ( msg_async * ) arg;
+
+while( atomic_load_explicit( &async->running, memory_order_acquire ) )
+    {
+    busy    = false;
+    queued  = false;
+
+    /*------------------------------------------------------
+    Send everything queued, one rx re-init per burst
+    ------------------------------------------------------*/
+    for( count = 0; count < MSG_BURST_MESSAGES && tx_ring_pop( &async->tx, &burst[ count ] ); count++ )
+        {
+        }
+
+    if( count > 0 )
+        {
+        busy = true;
+        ( void ) send_messages_ctx( async->ctx, burst, count, burst_errors );
+        for( i = 0; i < count; i++ )
+            {
+            if( burst_errors[ i ] == RX_NO_ERROR )
+                {
+                atomic_fetch_add_explicit( &async->tx_sent, 1, memory_order_relaxed );
+                }
+            else
+                {
+                atomic_fetch_add_explicit( &async->tx_errors, 1, memory_order_relaxed );
+                }
+            }
+        }
+
+    /*------------------------------------------------------
+    Receive until the radio is empty, a full ring drops
+    the message. the reader is woken once per pass
+    ------------------------------------------------------*/
+    for( reads = 0; reads < MSG_BURST_MESSAGES; reads++ )
+        {
+        seen    = async->ctx->filter_stats.frames_seen;
+        count   = get_messages_ctx( async->ctx, received, MSG_BURST_MESSAGES, &errors );
+        if( async->ctx->filter_stats.frames_seen == seen )
+            {
+            break;
+            }
+
+        busy = true;
+        for( i = 0; i < count; i++ )
+            {
+            if( rx_ring_push( &async->rx, &received[ i ] ) )
+                {
+                atomic_fetch_add_explicit( &async->rx_queued, 1, memory_order_relaxed );
+                queued = true;
+                }
+            else
+                {
+                atomic_fetch_add_explicit( &async->rx_dropped, 1, memory_order_relaxed );
+                }
+            }
+        }
+
+    if( queued && ! atomic_exchange_explicit( &async->rx_signaled, true, memory_order_acq_rel ) )
+        {
+        signal_event( async->rx_event_fd );
+        }
+
+    if( ! busy )
+        {
+        io_wait( async );
+        }
+    }
+
+return NULL;
+
+} /* io_thread() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       close_events
+*
+*   DESCRIPTION:
+*       close wake up descriptors
+*
+*********************************************************************/
+static void close_events
+    (
+    msg_async *async
+    )
+{
+
+if( async->tx_event_fd >= 0 )
+    {
+    close( async->tx_event_fd );
+    }
+
+if( async->rx_event_fd >= 0 )
+    {
+    close( async->rx_event_fd );
+    }
+
+async->tx_event_fd = -1;
+async->rx_event_fd = -1;
+
+} /* close_events() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       msg_async_start
+*
+*   DESCRIPTION:
+*       start I/O thread on an initialized context. from here on
+*       only the I/O thread may use ctx
+*
+*   RETURN:
+*       T/F thread started y/n
+*
+*********************************************************************/
+bool msg_async_start
+    (
+    msg_async *async,
+    message_ctx *ctx
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+size_t i;                               /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize rings and counters
+----------------------------------------------------------*/
+async->ctx = ctx;
+atomic_init( &async->rx.head, 0 );
+atomic_init( &async->rx.tail, 0 );
+atomic_init( &async->tx.head, 0 );
+atomic_init( &async->tx.tail, 0 );
+for( i = 0; i < MSG_ASYNC_TX_CAPACITY; i++ )
+    {
+    atomic_init( &async->tx.slots[ i ].sequence, i );
+    }
+
+atomic_init( &async->rx_queued, 0 );
+atomic_init( &async->rx_dropped, 0 );
+atomic_init( &async->tx_sent, 0 );
+atomic_init( &async->tx_errors, 0 );
+atomic_init( &async->io_sleeping, false );
+atomic_init( &async->rx_signaled, false );
+atomic_init( &async->running, true );
+
+/*----------------------------------------------------------
+Create wake up descriptors
+----------------------------------------------------------*/
+async->tx_event_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+async->rx_event_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+if( async->tx_event_fd < 0 || async->rx_event_fd < 0 )
+    {
+    atomic_store( &async->running, false );
+    close_events( async );
+    return false;
+    }
+
+/*----------------------------------------------------------
+Start I/O thread
+----------------------------------------------------------*/
+if( pthread_create( &async->thread, NULL, io_thread, async ) != 0 )
+    {
+    atomic_store( &async->running, false );
+    close_events( async );
+    return false;
+    }
+
+return true;
+
+} /* msg_async_start() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       msg_async_stop
+*
+*   DESCRIPTION:
+*       stop and join I/O thread. messages still on the tx ring
+*       are not sent
+*
+*********************************************************************/
+void msg_async_stop
+    (
+    msg_async *async
+    )
+{
+
+if( atomic_exchange( &async->running, false ) )
+    {
+    signal_event( async->tx_event_fd );
+    pthread_join( async->thread, NULL );
+    close_events( async );
+    }
+
+} /* msg_async_stop() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       msg_async_send
+*
+*   DESCRIPTION:
+*       queue message for the I/O thread, safe from any thread.
+*       the thread is only woken when it is in io_wait
+*
+*   RETURN:
+*       T/F message queued y/n, false when the tx ring is full
+*
+*********************************************************************/
+bool msg_async_send
+    (
+    msg_async *async,
+    const tx_message *message
+    )
+{
+
+if( ! tx_ring_push( &async->tx, message ) )
+    {
+    return false;
+    }
+
+atomic_thread_fence( memory_order_seq_cst );
+if( atomic_load_explicit( &async->io_sleeping, memory_order_relaxed ) )
+    {
+    signal_event( async->tx_event_fd );
+    }
+
+return true;
+
+} /* msg_async_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       msg_async_receive
+*
+*   DESCRIPTION:
+*       take next received message. only one thread may receive.
+*       an empty ring resets a signaled msg_async_rx_fd, then looks
+*       again so a message queued in between is not missed
+*
+*   RETURN:
+*       T/F message received y/n
+*
+*********************************************************************/
+bool msg_async_receive
+    (
+    msg_async *async,
+    rx_message *message
+    )
+{
+
+if( rx_ring_pop( &async->rx, message ) )
+    {
+    return true;
+    }
+
+if( ! atomic_load_explicit( &async->rx_signaled, memory_order_relaxed )
+ || ! atomic_exchange_explicit( &async->rx_signaled, false, memory_order_acq_rel ) )
+    {
+    return false;
+    }
+
+clear_event( async->rx_event_fd );
+
+return rx_ring_pop( &async->rx, message );
+
+} /* msg_async_receive() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       msg_async_rx_fd
+*
+*   DESCRIPTION:
+*       descriptor for poll/epoll in the receiving thread. it is
+*       readable once messages are queued and stays so until
+*       msg_async_receive finds the ring empty
+*
+*********************************************************************/
+int msg_async_rx_fd
+    (
+    msg_async *async
+    )
+{
+
+return async->rx_event_fd;
+
+} /* msg_async_rx_fd() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       msg_async_get_stats
+*
+*   DESCRIPTION:
+*       copy async counters
+*
+*********************************************************************/
+void msg_async_get_stats
+    (
+    msg_async *async,
+    msg_async_stats *stats
+    )
+{
+
+stats->rx_queued    = ( uint32_t ) atomic_load_explicit( &async->rx_queued, memory_order_relaxed );
+stats->rx_dropped   = ( uint32_t ) atomic_load_explicit( &async->rx_dropped, memory_order_relaxed );
+stats->tx_sent      = ( uint32_t ) atomic_load_explicit( &async->tx_sent, memory_order_relaxed );
+stats->tx_errors    = ( uint32_t ) atomic_load_explicit( &async->tx_errors, memory_order_relaxed );
+
+} /* msg_async_get_stats() */
@@ -0,0 +1,158 @@
+/*********************************************************************
+*
+*   HEADER:
+*       async mode for messageAPI on hosts with threads. an I/O
+*       thread owns a message_ctx and its radio; application
+*       threads hand it tx_messages through a lock-free MPSC ring
+*       and take rx_messages from an SPSC ring. full rings are
+*       reported to the caller instead of blocking. the thread
+*       sleeps in poll() on the transport and an eventfd, and the
+*       rx side has an eventfd of its own for the application
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_ASYNC_H
+#define MSG_ASYNC_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define MSG_CACHE_LINE      ( 64 )      /* ring index padding       */
+
+#ifndef MSG_ASYNC_RX_CAPACITY
+#define MSG_ASYNC_RX_CAPACITY ( 64 )    /* rx ring size, power of 2 */
+#endif
+
+#ifndef MSG_ASYNC_TX_CAPACITY
+#define MSG_ASYNC_TX_CAPACITY ( 64 )    /* tx ring size, power of 2 */
+#endif
+
+#ifndef MSG_ASYNC_IDLE_US
+#define MSG_ASYNC_IDLE_US   ( 1000 )    /* I/O thread sleep when
+                                           there was nothing to do
+                                           and the transport has no
+                                           descriptor to wait on    */
+#endif
+
+#ifndef MSG_ASYNC_WAIT_MS
+#define MSG_ASYNC_WAIT_MS   ( 100 )     /* I/O thread sleep when the
+                                           transport wakes it       */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* single producer, single
+                                           consumer rx ring         */
+    {
+    _Alignas( MSG_CACHE_LINE ) atomic_size_t head; /* next to take  */
+    _Alignas( MSG_CACHE_LINE ) atomic_size_t tail; /* next to fill  */
+    _Alignas( MSG_CACHE_LINE ) rx_message slots[ MSG_ASYNC_RX_CAPACITY ];
+    } msg_rx_ring;
+
+typedef struct                          /* tx ring slot             */
+    {
+    atomic_size_t sequence;             /* slot turn, see msg_async.c */
+    tx_message message;                 /* queued message           */
+    } msg_tx_slot;
+
+typedef struct                          /* multi producer, single
+                                           consumer tx ring         */
+    {
+    _Alignas( MSG_CACHE_LINE ) atomic_size_t head; /* next to take  */
+    _Alignas( MSG_CACHE_LINE ) atomic_size_t tail; /* next to claim */
+    _Alignas( MSG_CACHE_LINE ) msg_tx_slot slots[ MSG_ASYNC_TX_CAPACITY ];
+    } msg_tx_ring;
+
+typedef struct                          /* async counters           */
+    {
+    uint32_t rx_queued;                 /* messages put on rx ring  */
+    uint32_t rx_dropped;                /* lost to a full rx ring   */
+    uint32_t tx_sent;                   /* messages sent            */
+    uint32_t tx_errors;                 /* sends that failed        */
+    } msg_async_stats;
+
+typedef struct                          /* async mode instance      */
+    {
+    message_ctx *ctx;                   /* context owned by thread  */
+    pthread_t thread;                   /* I/O thread               */
+    atomic_bool running;                /* thread should keep going */
+    atomic_bool io_sleeping;            /* thread is in poll()      */
+    atomic_bool rx_signaled;            /* rx_event_fd was written  */
+    int tx_event_fd;                    /* wakes the I/O thread     */
+    int rx_event_fd;                    /* readable when rx ring
+                                           has messages             */
+    atomic_uint_fast32_t rx_queued;     /* see msg_async_stats      */
+    atomic_uint_fast32_t rx_dropped;
+    atomic_uint_fast32_t tx_sent;
+    atomic_uint_fast32_t tx_errors;
+    msg_rx_ring rx;                     /* I/O thread to app        */
+    msg_tx_ring tx;                     /* app threads to I/O       */
+    } msg_async;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_async.c
+--------------------------------------------------------------------*/
+bool msg_async_start
+    (
+    msg_async *async,                   /* instance to start        */
+    message_ctx *ctx                    /* initialized context      */
+    );
+
+void msg_async_stop
+    (
+    msg_async *async                    /* instance to stop         */
+    );
+
+bool msg_async_send
+    (
+    msg_async *async,                   /* running instance         */
+    const tx_message *message           /* message to queue         */
+    );
+
+bool msg_async_receive
+    (
+    msg_async *async,                   /* running instance         */
+    rx_message *message                 /* pointer to store message */
+    );
+
+int msg_async_rx_fd
+    (
+    msg_async *async                    /* running instance         */
+    );
+
+void msg_async_get_stats
+    (
+    msg_async *async,                   /* running instance         */
+    msg_async_stats *stats              /* pointer to store stats   */
+    );
+
+#endif /* MSG_ASYNC_H */
+/* msg_async.h */
@@ -0,0 +1,846 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_capture.c
+*
+*   DESCRIPTION:
+*       raw frame capture and memory mapped replay. the capture
+*       transport passes every call to the radio transport and
+*       copies each buffer received into buffer[] as a record,
+*       writing buffer[] out with one append when the next record
+*       would not fit. a crash loses at most the records held, and
+*       a record cut short by one is skipped on replay. the reader
+*       walks the map in place, only the replay transport copies a
+*       buffer, into the context's rx_buffer
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE                     /* clock_gettime, O_CLOEXEC,
+                                           pread and madvise under
+                                           -std=c11                 */
+
+#include "msg_capture.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#if( CAPTURE_BUFFER_SIZE < CAPTURE_RECORD_SIZE + MAX_LORA_MSG_SIZE || CAPTURE_BUFFER_SIZE > 0xFFFF )
+#error CAPTURE_BUFFER_SIZE must hold one full record and fit in 16 bits
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+static const uint8_t capture_magic[ 4 ] = { 'L', 'C', 'A', 'P' };
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       put_le
+*
+*   DESCRIPTION:
+*       store size bytes of value little endian
+*
+*********************************************************************/
+static void put_le
+    (
+    uint8_t *dest,
+    uint64_t value,
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t i;
+
+for( i = 0; i < size; i++ )
+    {
+    dest[ i ] = ( uint8_t )( value >> ( 8 * i ) );
+    }
+
+} /* put_le() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_le
+*
+*   DESCRIPTION:
+*       load size bytes little endian
+*
+*********************************************************************/
+static uint64_t get_le
+    (
+    const uint8_t *src,
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t value;
+uint8_t i;
+
+value = 0;
+for( i = 0; i < size; i++ )
+    {
+    value |= ( uint64_t ) src[ i ] << ( 8 * i );
+    }
+
+return value;
+
+} /* get_le() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       now_us
+*
+*   DESCRIPTION:
+*       wall clock time in us since the unix epoch
+*
+*********************************************************************/
+static uint64_t now_us
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+struct timespec now;
+
+clock_gettime( CLOCK_REALTIME, &now );
+
+return ( uint64_t ) now.tv_sec * 1000000u + ( uint64_t ) now.tv_nsec / 1000u;
+
+} /* now_us() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       write_all
+*
+*   DESCRIPTION:
+*       write size bytes, carrying on after short writes
+*
+*   RETURN:
+*       T/F all written y/n
+*
+*********************************************************************/
+static bool write_all
+    (
+    int fd,
+    const uint8_t *data,
+    size_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+ssize_t written;
+
+while( size > 0 )
+    {
+    written = write( fd, data, size );
+    if( written < 0 )
+        {
+        if( errno == EINTR )
+            {
+            continue;
+            }
+        return false;
+        }
+    data += written;
+    size -= ( size_t ) written;
+    }
+
+return true;
+
+} /* write_all() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       parse_header
+*
+*   DESCRIPTION:
+*       check and unpack a file header
+*
+*   RETURN:
+*       T/F capture file this code reads y/n
+*
+*********************************************************************/
+static bool parse_header
+    (
+    const uint8_t raw[ CAPTURE_HEADER_SIZE ],
+    capture_header *header
+    )
+{
+
+if( memcmp( raw, capture_magic, sizeof( capture_magic ) ) != 0
+ || raw[ 4 ] != CAPTURE_VERSION
+ || raw[ 7 ] < CAPTURE_RECORD_SIZE )
+    {
+    return false;
+    }
+
+header->version     = raw[ 4 ];
+header->location    = ( location ) raw[ 5 ];
+header->key         = raw[ 6 ];
+header->record_size = raw[ 7 ];
+header->start_us    = get_le( &raw[ 8 ], 8 );
+
+return true;
+
+} /* parse_header() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_get
+*
+*   DESCRIPTION:
+*       read the radio and record what it returned
+*
+*   RETURN:
+*       T/F buffer received y/n
+*
+*********************************************************************/
+static bool capture_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+capture_port *capture;
+uint8_t *record;
+int16_t rssi;
+int8_t snr;
+
+capture = ( capture_port * ) port;
+
+if( ! capture->inner.get( capture->inner.port, message_array, max_size, size, errors ) )
+    {
+    return false;
+    }
+
+if( capture->fd < 0 )
+    {
+    return true;
+    }
+
+/*----------------------------------------------------------
+Signal is read straight after the buffer, while the radio
+still holds the packet values
+----------------------------------------------------------*/
+rssi = 0;
+snr  = 0;
+if( capture->link != NULL && ! capture->link( &rssi, &snr, capture->link_arg ) )
+    {
+    rssi = 0;
+    snr  = 0;
+    }
+
+if( capture->used + CAPTURE_RECORD_SIZE + *size > CAPTURE_BUFFER_SIZE )
+    {
+    ( void ) capture_flush( capture );
+    }
+
+record = &capture->buffer[ capture->used ];
+put_le( &record[ 0 ], now_us(), 8 );
+put_le( &record[ 8 ], ( uint16_t ) rssi, 2 );
+record[ 10 ] = ( uint8_t ) snr;
+record[ 11 ] = ( uint8_t ) *errors;
+record[ 12 ] = *size;
+memcpy( &record[ CAPTURE_RECORD_SIZE ], message_array, *size );
+
+capture->used = ( uint16_t )( capture->used + CAPTURE_RECORD_SIZE + *size );
+capture->held++;
+
+return true;
+
+} /* capture_get() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_open
+*
+*   DESCRIPTION:
+*       open path for appending records. a new file gets a header
+*       naming module and key, an existing one must be a capture
+*       file of this version and keeps its header
+*
+*   RETURN:
+*       T/F file open y/n
+*
+*********************************************************************/
+bool capture_open
+    (
+    capture_port *port,
+    const char *path,
+    location module,
+    uint8_t key
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t raw[ CAPTURE_HEADER_SIZE ];
+capture_header header;
+struct stat info;
+
+/*----------------------------------------------------------
+Reset state
+----------------------------------------------------------*/
+memset( port, 0, sizeof( *port ) );
+port->fd = open( path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644 );
+if( port->fd < 0 )
+    {
+    return false;
+    }
+
+if( fstat( port->fd, &info ) != 0 )
+    {
+    capture_close( port );
+    return false;
+    }
+
+/*----------------------------------------------------------
+Append to an existing capture only if it is one
+----------------------------------------------------------*/
+if( info.st_size > 0 )
+    {
+    if( pread( port->fd, raw, sizeof( raw ), 0 ) != ( ssize_t ) sizeof( raw )
+     || ! parse_header( raw, &header ) )
+        {
+        capture_close( port );
+        return false;
+        }
+    return true;
+    }
+
+memcpy( raw, capture_magic, sizeof( capture_magic ) );
+raw[ 4 ] = CAPTURE_VERSION;
+raw[ 5 ] = ( uint8_t ) module;
+raw[ 6 ] = key;
+raw[ 7 ] = CAPTURE_RECORD_SIZE;
+put_le( &raw[ 8 ], now_us(), 8 );
+
+if( ! write_all( port->fd, raw, sizeof( raw ) ) )
+    {
+    capture_close( port );
+    return false;
+    }
+port->stats.bytes = sizeof( raw );
+
+return true;
+
+} /* capture_open() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_transport
+*
+*   DESCRIPTION:
+*       bind an opened capture to the radio transport. the result
+*       is passed to set_transport or init_message_ctx in place of
+*       inner
+*
+*   RETURN:
+*       transport that captures inner
+*
+*********************************************************************/
+msg_transport capture_transport
+    (
+    capture_port *port,
+    const msg_transport *inner,
+    capture_link_fn link,
+    void *link_arg
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+
+port->inner     = *inner;
+port->link      = link;
+port->link_arg  = link_arg;
+
+transport = forward_transport( port );
+transport.get       = capture_get;
+
+return transport;
+
+} /* capture_transport() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_flush
+*
+*   DESCRIPTION:
+*       append held records to the file. records that fail to
+*       write are counted and dropped so capture carries on
+*
+*   RETURN:
+*       T/F records written y/n
+*
+*********************************************************************/
+bool capture_flush
+    (
+    capture_port *port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+bool written;
+
+if( port->used == 0 )
+    {
+    return true;
+    }
+
+written = ( port->fd >= 0 ) && write_all( port->fd, port->buffer, port->used );
+if( written )
+    {
+    port->stats.records += port->held;
+    port->stats.bytes   += port->used;
+    }
+else
+    {
+    port->stats.write_errors += port->held;
+    }
+
+port->used = 0;
+port->held = 0;
+
+return written;
+
+} /* capture_flush() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_close
+*
+*   DESCRIPTION:
+*       write held records and close the file. the transport
+*       keeps passing frames through afterwards
+*
+*********************************************************************/
+void capture_close
+    (
+    capture_port *port
+    )
+{
+
+if( port->fd < 0 )
+    {
+    return;
+    }
+
+( void ) capture_flush( port );
+close( port->fd );
+port->fd = -1;
+
+} /* capture_close() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_get_stats
+*
+*   DESCRIPTION:
+*       copy capture counters, records held are not counted until
+*       they are written
+*
+*********************************************************************/
+void capture_get_stats
+    (
+    capture_port *port,
+    capture_stats *stats
+    )
+{
+
+*stats = port->stats;
+
+} /* capture_get_stats() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_map
+*
+*   DESCRIPTION:
+*       map a capture file read only and check its header
+*
+*   RETURN:
+*       T/F file mapped y/n
+*
+*********************************************************************/
+bool capture_map
+    (
+    capture_reader *reader,
+    const char *path
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+struct stat info;
+void *map;
+int fd;
+
+memset( reader, 0, sizeof( *reader ) );
+
+fd = open( path, O_RDONLY | O_CLOEXEC );
+if( fd < 0 )
+    {
+    return false;
+    }
+
+if( fstat( fd, &info ) != 0 || info.st_size < CAPTURE_HEADER_SIZE )
+    {
+    close( fd );
+    return false;
+    }
+
+map = mmap( NULL, ( size_t ) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+close( fd );
+if( map == MAP_FAILED )
+    {
+    return false;
+    }
+
+reader->base    = ( const uint8_t * ) map;
+reader->length  = ( size_t ) info.st_size;
+if( ! parse_header( reader->base, &reader->header ) )
+    {
+    capture_unmap( reader );
+    return false;
+    }
+
+/*----------------------------------------------------------
+Records are read front to back once per pass
+----------------------------------------------------------*/
+( void ) madvise( map, reader->length, MADV_SEQUENTIAL );
+reader->offset = CAPTURE_HEADER_SIZE;
+
+return true;
+
+} /* capture_map() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_next
+*
+*   DESCRIPTION:
+*       unpack the next record. record->data points into the map
+*       and stays valid until capture_unmap
+*
+*   RETURN:
+*       T/F record read y/n
+*
+*********************************************************************/
+bool capture_next
+    (
+    capture_reader *reader,
+    capture_record *record
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+const uint8_t *raw;
+size_t left;
+
+left = reader->length - reader->offset;
+if( left < reader->header.record_size
+ || left - reader->header.record_size < reader->base[ reader->offset + 12 ] )
+    {
+    reader->truncated = ( left > 0 );
+    return false;
+    }
+
+raw = &reader->base[ reader->offset ];
+record->time_us = get_le( &raw[ 0 ], 8 );
+record->rssi    = ( int16_t ) get_le( &raw[ 8 ], 2 );
+record->snr     = ( int8_t ) raw[ 10 ];
+record->errors  = ( lora_errors ) raw[ 11 ];
+record->size    = raw[ 12 ];
+record->data    = &raw[ reader->header.record_size ];
+
+reader->offset += reader->header.record_size + record->size;
+
+return true;
+
+} /* capture_next() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_at_end
+*
+*   DESCRIPTION:
+*       check for a whole record left to read
+*
+*   RETURN:
+*       T/F no record left y/n
+*
+*********************************************************************/
+bool capture_at_end
+    (
+    const capture_reader *reader
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+size_t left;
+
+left = reader->length - reader->offset;
+
+return ( left < reader->header.record_size
+      || left - reader->header.record_size < reader->base[ reader->offset + 12 ] );
+
+} /* capture_at_end() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_rewind
+*
+*   DESCRIPTION:
+*       go back to the first record
+*
+*********************************************************************/
+void capture_rewind
+    (
+    capture_reader *reader
+    )
+{
+
+reader->offset      = CAPTURE_HEADER_SIZE;
+reader->truncated   = false;
+
+} /* capture_rewind() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_unmap
+*
+*   DESCRIPTION:
+*       release the map
+*
+*********************************************************************/
+void capture_unmap
+    (
+    capture_reader *reader
+    )
+{
+
+if( reader->base != NULL )
+    {
+    munmap( ( void * ) reader->base, reader->length );
+    }
+
+memset( reader, 0, sizeof( *reader ) );
+
+} /* capture_unmap() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       replay_init
+*
+*   DESCRIPTION:
+*       nothing to bring up
+*
+*********************************************************************/
+static lora_errors replay_init
+    (
+    void *port,
+    lora_config config_data
+    )
+{
+
+( void ) port;
+( void ) config_data;
+
+return RX_NO_ERROR;
+
+} /* replay_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       replay_send
+*
+*   DESCRIPTION:
+*       a replay only receives, frames sent go nowhere
+*
+*********************************************************************/
+static lora_errors replay_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+
+( void ) port;
+( void ) message_array;
+( void ) size;
+
+return RX_NO_ERROR;
+
+} /* replay_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       replay_get
+*
+*   DESCRIPTION:
+*       hand out the next record as the radio returned it
+*
+*   RETURN:
+*       T/F buffer received y/n
+*
+*********************************************************************/
+static bool replay_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+capture_record record;
+
+if( ! capture_next( ( capture_reader * ) port, &record ) )
+    {
+    return false;
+    }
+
+if( record.size > max_size )
+    {
+    *size   = 0;
+    *errors = RX_ARRAY_SIZE_ERR;
+    return true;
+    }
+
+memcpy( message_array, record.data, record.size );
+*size   = record.size;
+*errors = record.errors;
+
+return true;
+
+} /* replay_get() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       replay_rx_mode
+*
+*   DESCRIPTION:
+*       always receiving
+*
+*********************************************************************/
+static bool replay_rx_mode
+    (
+    void *port
+    )
+{
+
+( void ) port;
+
+return true;
+
+} /* replay_rx_mode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       capture_replay_transport
+*
+*   DESCRIPTION:
+*       bind a mapped capture as a receive only transport. each
+*       get hands out one record until the capture runs out
+*
+*   RETURN:
+*       transport that plays reader
+*
+*********************************************************************/
+msg_transport capture_replay_transport
+    (
+    capture_reader *reader
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+
+transport.init      = replay_init;
+transport.send      = replay_send;
+transport.get       = replay_get;
+transport.rx_mode   = replay_rx_mode;
+transport.port      = reader;
+transport.wait_fd   = NULL;
+
+return transport;
+
+} /* capture_replay_transport() */
@@ -0,0 +1,192 @@
+/*********************************************************************
+*
+*   HEADER:
+*       raw frame capture and replay for messageAPI on hosts.
+*       capture_transport wraps the radio transport and appends
+*       every buffer it receives, with its time, RSSI, SNR and
+*       lora_errors result, to a capture file. a capture file is
+*       read back through mmap and capture_replay_transport hands
+*       its buffers to a context, so recorded traffic runs through
+*       the same decode path as live traffic
+*
+*       file layout, all fields little endian:
+*
+*           header  "LCAP", version, location, key, record header
+*                   size, start time in us (8 bytes)
+*           record  time in us (8 bytes), rssi in dBm (2 bytes),
+*                   snr in 0.25 dB (1 byte), lora_errors (1 byte),
+*                   size (1 byte), size bytes of raw buffer
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_CAPTURE_H
+#define MSG_CAPTURE_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define CAPTURE_VERSION         ( 1 )   /* file format version      */
+
+#define CAPTURE_HEADER_SIZE     ( 16 )  /* bytes of file header     */
+
+#define CAPTURE_RECORD_SIZE     ( 13 )  /* bytes before record data */
+
+#ifndef CAPTURE_BUFFER_SIZE
+#define CAPTURE_BUFFER_SIZE     ( 4096 )/* records held before a
+                                           write, at least one
+                                           full record              */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef bool ( *capture_link_fn )       /* signal of last buffer    */
+    (
+    int16_t *rssi,                      /* packet RSSI in dBm       */
+    int8_t *snr,                        /* packet SNR in 0.25 dB    */
+    void *arg                           /* capture_transport arg    */
+    );                                  /* returns T/F read y/n     */
+
+typedef struct                          /* file header fields       */
+    {
+    uint8_t version;                    /* CAPTURE_VERSION          */
+    location location;                  /* module that captured     */
+    uint8_t key;                        /* its key at the start     */
+    uint8_t record_size;                /* bytes before record data */
+    uint64_t start_us;                  /* file created, unix us    */
+    } capture_header;
+
+typedef struct                          /* one captured buffer      */
+    {
+    uint64_t time_us;                   /* received, unix us        */
+    int16_t rssi;                       /* packet RSSI in dBm       */
+    int8_t snr;                         /* packet SNR in 0.25 dB    */
+    lora_errors errors;                 /* transport result         */
+    uint8_t size;                       /* size of data[]           */
+    const uint8_t *data;                /* raw buffer, in the map
+                                           when read back           */
+    } capture_record;
+
+typedef struct                          /* capture counters         */
+    {
+    uint32_t records;                   /* buffers captured         */
+    uint32_t bytes;                     /* file bytes written       */
+    uint32_t write_errors;              /* records lost on write    */
+    } capture_stats;
+
+typedef struct                          /* capture state            */
+    {
+    msg_transport inner;                /* radio frames come from   */
+    int fd;                             /* capture file, -1 closed  */
+    capture_link_fn link;               /* RSSI/SNR read or NULL    */
+    void *link_arg;                     /* passed to link           */
+    uint16_t used;                      /* bytes held in buffer[]   */
+    uint16_t held;                      /* records held in buffer[] */
+    uint8_t buffer[ CAPTURE_BUFFER_SIZE ];
+                                        /* records not yet written  */
+    capture_stats stats;                /* counters                 */
+    } capture_port;
+
+typedef struct                          /* mapped capture file      */
+    {
+    const uint8_t *base;                /* start of the map         */
+    size_t length;                      /* bytes mapped             */
+    size_t offset;                      /* next record              */
+    capture_header header;              /* file header              */
+    bool truncated;                     /* file ends inside a record */
+    } capture_reader;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_capture.c
+--------------------------------------------------------------------*/
+bool capture_open
+    (
+    capture_port *port,                 /* capture state            */
+    const char *path,                   /* file to append to        */
+    location module,                    /* module capturing         */
+    uint8_t key                         /* its current key          */
+    );
+
+msg_transport capture_transport
+    (
+    capture_port *port,                 /* opened capture state     */
+    const msg_transport *inner,         /* radio to capture         */
+    capture_link_fn link,               /* RSSI/SNR read or NULL    */
+    void *link_arg                      /* passed to link           */
+    );
+
+bool capture_flush
+    (
+    capture_port *port                  /* capture state            */
+    );
+
+void capture_close
+    (
+    capture_port *port                  /* capture state            */
+    );
+
+void capture_get_stats
+    (
+    capture_port *port,                 /* capture state            */
+    capture_stats *stats                /* pointer to store stats   */
+    );
+
+bool capture_map
+    (
+    capture_reader *reader,             /* reader to fill           */
+    const char *path                    /* capture file             */
+    );
+
+bool capture_next
+    (
+    capture_reader *reader,             /* mapped capture           */
+    capture_record *record              /* next record              */
+    );
+
+bool capture_at_end
+    (
+    const capture_reader *reader        /* mapped capture           */
+    );
+
+void capture_rewind
+    (
+    capture_reader *reader              /* mapped capture           */
+    );
+
+void capture_unmap
+    (
+    capture_reader *reader              /* mapped capture           */
+    );
+
+msg_transport capture_replay_transport
+    (
+    capture_reader *reader              /* mapped capture to play   */
+    );
+
+#endif /* MSG_CAPTURE_H */
+/* msg_capture.h */
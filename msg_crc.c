@@ -0,0 +1,683 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_crc.c
+*
+*   DESCRIPTION:
+*       crc8 engines for messageAPI. every engine returns the same
+*       result as the original one byte crc8_table loop
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_crc.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*----------------------------------------------------------
+Carry-less multiply is only built for little endian
+x86-64 and AArch64 hosts
+----------------------------------------------------------*/
+#if !defined( MSG_CRC_NO_CLMUL ) && defined( __GNUC__ ) \
+ && defined( __BYTE_ORDER__ ) && ( __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ )
+    #if defined( __x86_64__ )
+        #define CRC8_HAVE_CLMUL
+        #include <immintrin.h>
+    #elif defined( __aarch64__ ) && defined( __linux__ )
+        #define CRC8_HAVE_CLMUL
+        #include <arm_neon.h>
+        #include <sys/auxv.h>
+        #include <asm/hwcap.h>
+    #endif
+#endif
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define CRC8_UNRESOLVED     ( CRC8_ENGINE_COUNT ) /* engine not picked yet */
+
+/*----------------------------------------------------------
+Carry-less multiply constants, all bit reflected:
+
+BARRETT_CONSTANT -- floor( x^72 / P ) without its x^64 term,
+                    reduces 8 bytes to a crc in one multiply
+FOLD_128_CONSTANT -- x^191 mod P << 56, folds the first 8
+                    bytes of a 16 byte state over 128 bits
+FOLD_64_CONSTANT -- x^127 mod P << 56, folds the second 8
+                    bytes of a 16 byte state over 128 bits
+----------------------------------------------------------*/
+#define BARRETT_CONSTANT    ( 0xC8BB94C66856A8E0ULL )
+
+#define FOLD_128_CONSTANT   ( 0xC800000000000000ULL )
+
+#define FOLD_64_CONSTANT    ( 0x8000000000000000ULL )
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+/*----------------------------------------------------------
+This CRC lookup table is for polynomal 0x7
+----------------------------------------------------------*/
+static uint8_t const crc8_table[] = {
+0x00, 0x91, 0xE3, 0x72, 0x07, 0x96, 0xE4, 0x75, 0x0E, 0x9F, 0xED, 0x7C, 0x09, 0x98, 0xEA, 0x7B,
+0x1C, 0x8D, 0xFF, 0x6E, 0x1B, 0x8A, 0xF8, 0x69, 0x12, 0x83, 0xF1, 0x60, 0x15, 0x84, 0xF6, 0x67,
+0x38, 0xA9, 0xDB, 0x4A, 0x3F, 0xAE, 0xDC, 0x4D, 0x36, 0xA7, 0xD5, 0x44, 0x31, 0xA0, 0xD2, 0x43,
+0x24, 0xB5, 0xC7, 0x56, 0x23, 0xB2, 0xC0, 0x51, 0x2A, 0xBB, 0xC9, 0x58, 0x2D, 0xBC, 0xCE, 0x5F,
+0x70, 0xE1, 0x93, 0x02, 0x77, 0xE6, 0x94, 0x05, 0x7E, 0xEF, 0x9D, 0x0C, 0x79, 0xE8, 0x9A, 0x0B,
+0x6C, 0xFD, 0x8F, 0x1E, 0x6B, 0xFA, 0x88, 0x19, 0x62, 0xF3, 0x81, 0x10, 0x65, 0xF4, 0x86, 0x17,
+0x48, 0xD9, 0xAB, 0x3A, 0x4F, 0xDE, 0xAC, 0x3D, 0x46, 0xD7, 0xA5, 0x34, 0x41, 0xD0, 0xA2, 0x33,
+0x54, 0xC5, 0xB7, 0x26, 0x53, 0xC2, 0xB0, 0x21, 0x5A, 0xCB, 0xB9, 0x28, 0x5D, 0xCC, 0xBE, 0x2F,
+0xE0, 0x71, 0x03, 0x92, 0xE7, 0x76, 0x04, 0x95, 0xEE, 0x7F, 0x0D, 0x9C, 0xE9, 0x78, 0x0A, 0x9B,
+0xFC, 0x6D, 0x1F, 0x8E, 0xFB, 0x6A, 0x18, 0x89, 0xF2, 0x63, 0x11, 0x80, 0xF5, 0x64, 0x16, 0x87,
+0xD8, 0x49, 0x3B, 0xAA, 0xDF, 0x4E, 0x3C, 0xAD, 0xD6, 0x47, 0x35, 0xA4, 0xD1, 0x40, 0x32, 0xA3,
+0xC4, 0x55, 0x27, 0xB6, 0xC3, 0x52, 0x20, 0xB1, 0xCA, 0x5B, 0x29, 0xB8, 0xCD, 0x5C, 0x2E, 0xBF,
+0x90, 0x01, 0x73, 0xE2, 0x97, 0x06, 0x74, 0xE5, 0x9E, 0x0F, 0x7D, 0xEC, 0x99, 0x08, 0x7A, 0xEB,
+0x8C, 0x1D, 0x6F, 0xFE, 0x8B, 0x1A, 0x68, 0xF9, 0x82, 0x13, 0x61, 0xF0, 0x85, 0x14, 0x66, 0xF7,
+0xA8, 0x39, 0x4B, 0xDA, 0xAF, 0x3E, 0x4C, 0xDD, 0xA6, 0x37, 0x45, 0xD4, 0xA1, 0x30, 0x42, 0xD3,
+0xB4, 0x25, 0x57, 0xC6, 0xB3, 0x22, 0x50, 0xC1, 0xBA, 0x2B, 0x59, 0xC8, 0xBD, 0x2C, 0x5E, 0xCF};
+
+/*----------------------------------------------------------
+Slice tables, crc8_slice_table[ k - 1 ][ x ] is the crc of
+byte x followed by k zero bytes
+----------------------------------------------------------*/
+static uint8_t const crc8_slice_table[ 7 ][ 256 ] = {
+{
+0x00, 0x6D, 0xDA, 0xB7, 0x75, 0x18, 0xAF, 0xC2, 0xEA, 0x87, 0x30, 0x5D, 0x9F, 0xF2, 0x45, 0x28,
+0x15, 0x78, 0xCF, 0xA2, 0x60, 0x0D, 0xBA, 0xD7, 0xFF, 0x92, 0x25, 0x48, 0x8A, 0xE7, 0x50, 0x3D,
+0x2A, 0x47, 0xF0, 0x9D, 0x5F, 0x32, 0x85, 0xE8, 0xC0, 0xAD, 0x1A, 0x77, 0xB5, 0xD8, 0x6F, 0x02,
+0x3F, 0x52, 0xE5, 0x88, 0x4A, 0x27, 0x90, 0xFD, 0xD5, 0xB8, 0x0F, 0x62, 0xA0, 0xCD, 0x7A, 0x17,
+0x54, 0x39, 0x8E, 0xE3, 0x21, 0x4C, 0xFB, 0x96, 0xBE, 0xD3, 0x64, 0x09, 0xCB, 0xA6, 0x11, 0x7C,
+0x41, 0x2C, 0x9B, 0xF6, 0x34, 0x59, 0xEE, 0x83, 0xAB, 0xC6, 0x71, 0x1C, 0xDE, 0xB3, 0x04, 0x69,
+0x7E, 0x13, 0xA4, 0xC9, 0x0B, 0x66, 0xD1, 0xBC, 0x94, 0xF9, 0x4E, 0x23, 0xE1, 0x8C, 0x3B, 0x56,
+0x6B, 0x06, 0xB1, 0xDC, 0x1E, 0x73, 0xC4, 0xA9, 0x81, 0xEC, 0x5B, 0x36, 0xF4, 0x99, 0x2E, 0x43,
+0xA8, 0xC5, 0x72, 0x1F, 0xDD, 0xB0, 0x07, 0x6A, 0x42, 0x2F, 0x98, 0xF5, 0x37, 0x5A, 0xED, 0x80,
+0xBD, 0xD0, 0x67, 0x0A, 0xC8, 0xA5, 0x12, 0x7F, 0x57, 0x3A, 0x8D, 0xE0, 0x22, 0x4F, 0xF8, 0x95,
+0x82, 0xEF, 0x58, 0x35, 0xF7, 0x9A, 0x2D, 0x40, 0x68, 0x05, 0xB2, 0xDF, 0x1D, 0x70, 0xC7, 0xAA,
+0x97, 0xFA, 0x4D, 0x20, 0xE2, 0x8F, 0x38, 0x55, 0x7D, 0x10, 0xA7, 0xCA, 0x08, 0x65, 0xD2, 0xBF,
+0xFC, 0x91, 0x26, 0x4B, 0x89, 0xE4, 0x53, 0x3E, 0x16, 0x7B, 0xCC, 0xA1, 0x63, 0x0E, 0xB9, 0xD4,
+0xE9, 0x84, 0x33, 0x5E, 0x9C, 0xF1, 0x46, 0x2B, 0x03, 0x6E, 0xD9, 0xB4, 0x76, 0x1B, 0xAC, 0xC1,
+0xD6, 0xBB, 0x0C, 0x61, 0xA3, 0xCE, 0x79, 0x14, 0x3C, 0x51, 0xE6, 0x8B, 0x49, 0x24, 0x93, 0xFE,
+0xC3, 0xAE, 0x19, 0x74, 0xB6, 0xDB, 0x6C, 0x01, 0x29, 0x44, 0xF3, 0x9E, 0x5C, 0x31, 0x86, 0xEB},
+{
+0x00, 0xD0, 0x61, 0xB1, 0xC2, 0x12, 0xA3, 0x73, 0x45, 0x95, 0x24, 0xF4, 0x87, 0x57, 0xE6, 0x36,
+0x8A, 0x5A, 0xEB, 0x3B, 0x48, 0x98, 0x29, 0xF9, 0xCF, 0x1F, 0xAE, 0x7E, 0x0D, 0xDD, 0x6C, 0xBC,
+0xD5, 0x05, 0xB4, 0x64, 0x17, 0xC7, 0x76, 0xA6, 0x90, 0x40, 0xF1, 0x21, 0x52, 0x82, 0x33, 0xE3,
+0x5F, 0x8F, 0x3E, 0xEE, 0x9D, 0x4D, 0xFC, 0x2C, 0x1A, 0xCA, 0x7B, 0xAB, 0xD8, 0x08, 0xB9, 0x69,
+0x6B, 0xBB, 0x0A, 0xDA, 0xA9, 0x79, 0xC8, 0x18, 0x2E, 0xFE, 0x4F, 0x9F, 0xEC, 0x3C, 0x8D, 0x5D,
+0xE1, 0x31, 0x80, 0x50, 0x23, 0xF3, 0x42, 0x92, 0xA4, 0x74, 0xC5, 0x15, 0x66, 0xB6, 0x07, 0xD7,
+0xBE, 0x6E, 0xDF, 0x0F, 0x7C, 0xAC, 0x1D, 0xCD, 0xFB, 0x2B, 0x9A, 0x4A, 0x39, 0xE9, 0x58, 0x88,
+0x34, 0xE4, 0x55, 0x85, 0xF6, 0x26, 0x97, 0x47, 0x71, 0xA1, 0x10, 0xC0, 0xB3, 0x63, 0xD2, 0x02,
+0xD6, 0x06, 0xB7, 0x67, 0x14, 0xC4, 0x75, 0xA5, 0x93, 0x43, 0xF2, 0x22, 0x51, 0x81, 0x30, 0xE0,
+0x5C, 0x8C, 0x3D, 0xED, 0x9E, 0x4E, 0xFF, 0x2F, 0x19, 0xC9, 0x78, 0xA8, 0xDB, 0x0B, 0xBA, 0x6A,
+0x03, 0xD3, 0x62, 0xB2, 0xC1, 0x11, 0xA0, 0x70, 0x46, 0x96, 0x27, 0xF7, 0x84, 0x54, 0xE5, 0x35,
+0x89, 0x59, 0xE8, 0x38, 0x4B, 0x9B, 0x2A, 0xFA, 0xCC, 0x1C, 0xAD, 0x7D, 0x0E, 0xDE, 0x6F, 0xBF,
+0xBD, 0x6D, 0xDC, 0x0C, 0x7F, 0xAF, 0x1E, 0xCE, 0xF8, 0x28, 0x99, 0x49, 0x3A, 0xEA, 0x5B, 0x8B,
+0x37, 0xE7, 0x56, 0x86, 0xF5, 0x25, 0x94, 0x44, 0x72, 0xA2, 0x13, 0xC3, 0xB0, 0x60, 0xD1, 0x01,
+0x68, 0xB8, 0x09, 0xD9, 0xAA, 0x7A, 0xCB, 0x1B, 0x2D, 0xFD, 0x4C, 0x9C, 0xEF, 0x3F, 0x8E, 0x5E,
+0xE2, 0x32, 0x83, 0x53, 0x20, 0xF0, 0x41, 0x91, 0xA7, 0x77, 0xC6, 0x16, 0x65, 0xB5, 0x04, 0xD4},
+{
+0x00, 0x8C, 0xD9, 0x55, 0x73, 0xFF, 0xAA, 0x26, 0xE6, 0x6A, 0x3F, 0xB3, 0x95, 0x19, 0x4C, 0xC0,
+0x0D, 0x81, 0xD4, 0x58, 0x7E, 0xF2, 0xA7, 0x2B, 0xEB, 0x67, 0x32, 0xBE, 0x98, 0x14, 0x41, 0xCD,
+0x1A, 0x96, 0xC3, 0x4F, 0x69, 0xE5, 0xB0, 0x3C, 0xFC, 0x70, 0x25, 0xA9, 0x8F, 0x03, 0x56, 0xDA,
+0x17, 0x9B, 0xCE, 0x42, 0x64, 0xE8, 0xBD, 0x31, 0xF1, 0x7D, 0x28, 0xA4, 0x82, 0x0E, 0x5B, 0xD7,
+0x34, 0xB8, 0xED, 0x61, 0x47, 0xCB, 0x9E, 0x12, 0xD2, 0x5E, 0x0B, 0x87, 0xA1, 0x2D, 0x78, 0xF4,
+0x39, 0xB5, 0xE0, 0x6C, 0x4A, 0xC6, 0x93, 0x1F, 0xDF, 0x53, 0x06, 0x8A, 0xAC, 0x20, 0x75, 0xF9,
+0x2E, 0xA2, 0xF7, 0x7B, 0x5D, 0xD1, 0x84, 0x08, 0xC8, 0x44, 0x11, 0x9D, 0xBB, 0x37, 0x62, 0xEE,
+0x23, 0xAF, 0xFA, 0x76, 0x50, 0xDC, 0x89, 0x05, 0xC5, 0x49, 0x1C, 0x90, 0xB6, 0x3A, 0x6F, 0xE3,
+0x68, 0xE4, 0xB1, 0x3D, 0x1B, 0x97, 0xC2, 0x4E, 0x8E, 0x02, 0x57, 0xDB, 0xFD, 0x71, 0x24, 0xA8,
+0x65, 0xE9, 0xBC, 0x30, 0x16, 0x9A, 0xCF, 0x43, 0x83, 0x0F, 0x5A, 0xD6, 0xF0, 0x7C, 0x29, 0xA5,
+0x72, 0xFE, 0xAB, 0x27, 0x01, 0x8D, 0xD8, 0x54, 0x94, 0x18, 0x4D, 0xC1, 0xE7, 0x6B, 0x3E, 0xB2,
+0x7F, 0xF3, 0xA6, 0x2A, 0x0C, 0x80, 0xD5, 0x59, 0x99, 0x15, 0x40, 0xCC, 0xEA, 0x66, 0x33, 0xBF,
+0x5C, 0xD0, 0x85, 0x09, 0x2F, 0xA3, 0xF6, 0x7A, 0xBA, 0x36, 0x63, 0xEF, 0xC9, 0x45, 0x10, 0x9C,
+0x51, 0xDD, 0x88, 0x04, 0x22, 0xAE, 0xFB, 0x77, 0xB7, 0x3B, 0x6E, 0xE2, 0xC4, 0x48, 0x1D, 0x91,
+0x46, 0xCA, 0x9F, 0x13, 0x35, 0xB9, 0xEC, 0x60, 0xA0, 0x2C, 0x79, 0xF5, 0xD3, 0x5F, 0x0A, 0x86,
+0x4B, 0xC7, 0x92, 0x1E, 0x38, 0xB4, 0xE1, 0x6D, 0xAD, 0x21, 0x74, 0xF8, 0xDE, 0x52, 0x07, 0x8B},
+{
+0x00, 0xE9, 0x13, 0xFA, 0x26, 0xCF, 0x35, 0xDC, 0x4C, 0xA5, 0x5F, 0xB6, 0x6A, 0x83, 0x79, 0x90,
+0x98, 0x71, 0x8B, 0x62, 0xBE, 0x57, 0xAD, 0x44, 0xD4, 0x3D, 0xC7, 0x2E, 0xF2, 0x1B, 0xE1, 0x08,
+0xF1, 0x18, 0xE2, 0x0B, 0xD7, 0x3E, 0xC4, 0x2D, 0xBD, 0x54, 0xAE, 0x47, 0x9B, 0x72, 0x88, 0x61,
+0x69, 0x80, 0x7A, 0x93, 0x4F, 0xA6, 0x5C, 0xB5, 0x25, 0xCC, 0x36, 0xDF, 0x03, 0xEA, 0x10, 0xF9,
+0x23, 0xCA, 0x30, 0xD9, 0x05, 0xEC, 0x16, 0xFF, 0x6F, 0x86, 0x7C, 0x95, 0x49, 0xA0, 0x5A, 0xB3,
+0xBB, 0x52, 0xA8, 0x41, 0x9D, 0x74, 0x8E, 0x67, 0xF7, 0x1E, 0xE4, 0x0D, 0xD1, 0x38, 0xC2, 0x2B,
+0xD2, 0x3B, 0xC1, 0x28, 0xF4, 0x1D, 0xE7, 0x0E, 0x9E, 0x77, 0x8D, 0x64, 0xB8, 0x51, 0xAB, 0x42,
+0x4A, 0xA3, 0x59, 0xB0, 0x6C, 0x85, 0x7F, 0x96, 0x06, 0xEF, 0x15, 0xFC, 0x20, 0xC9, 0x33, 0xDA,
+0x46, 0xAF, 0x55, 0xBC, 0x60, 0x89, 0x73, 0x9A, 0x0A, 0xE3, 0x19, 0xF0, 0x2C, 0xC5, 0x3F, 0xD6,
+0xDE, 0x37, 0xCD, 0x24, 0xF8, 0x11, 0xEB, 0x02, 0x92, 0x7B, 0x81, 0x68, 0xB4, 0x5D, 0xA7, 0x4E,
+0xB7, 0x5E, 0xA4, 0x4D, 0x91, 0x78, 0x82, 0x6B, 0xFB, 0x12, 0xE8, 0x01, 0xDD, 0x34, 0xCE, 0x27,
+0x2F, 0xC6, 0x3C, 0xD5, 0x09, 0xE0, 0x1A, 0xF3, 0x63, 0x8A, 0x70, 0x99, 0x45, 0xAC, 0x56, 0xBF,
+0x65, 0x8C, 0x76, 0x9F, 0x43, 0xAA, 0x50, 0xB9, 0x29, 0xC0, 0x3A, 0xD3, 0x0F, 0xE6, 0x1C, 0xF5,
+0xFD, 0x14, 0xEE, 0x07, 0xDB, 0x32, 0xC8, 0x21, 0xB1, 0x58, 0xA2, 0x4B, 0x97, 0x7E, 0x84, 0x6D,
+0x94, 0x7D, 0x87, 0x6E, 0xB2, 0x5B, 0xA1, 0x48, 0xD8, 0x31, 0xCB, 0x22, 0xFE, 0x17, 0xED, 0x04,
+0x0C, 0xE5, 0x1F, 0xF6, 0x2A, 0xC3, 0x39, 0xD0, 0x40, 0xA9, 0x53, 0xBA, 0x66, 0x8F, 0x75, 0x9C},
+{
+0x00, 0x37, 0x6E, 0x59, 0xDC, 0xEB, 0xB2, 0x85, 0x79, 0x4E, 0x17, 0x20, 0xA5, 0x92, 0xCB, 0xFC,
+0xF2, 0xC5, 0x9C, 0xAB, 0x2E, 0x19, 0x40, 0x77, 0x8B, 0xBC, 0xE5, 0xD2, 0x57, 0x60, 0x39, 0x0E,
+0x25, 0x12, 0x4B, 0x7C, 0xF9, 0xCE, 0x97, 0xA0, 0x5C, 0x6B, 0x32, 0x05, 0x80, 0xB7, 0xEE, 0xD9,
+0xD7, 0xE0, 0xB9, 0x8E, 0x0B, 0x3C, 0x65, 0x52, 0xAE, 0x99, 0xC0, 0xF7, 0x72, 0x45, 0x1C, 0x2B,
+0x4A, 0x7D, 0x24, 0x13, 0x96, 0xA1, 0xF8, 0xCF, 0x33, 0x04, 0x5D, 0x6A, 0xEF, 0xD8, 0x81, 0xB6,
+0xB8, 0x8F, 0xD6, 0xE1, 0x64, 0x53, 0x0A, 0x3D, 0xC1, 0xF6, 0xAF, 0x98, 0x1D, 0x2A, 0x73, 0x44,
+0x6F, 0x58, 0x01, 0x36, 0xB3, 0x84, 0xDD, 0xEA, 0x16, 0x21, 0x78, 0x4F, 0xCA, 0xFD, 0xA4, 0x93,
+0x9D, 0xAA, 0xF3, 0xC4, 0x41, 0x76, 0x2F, 0x18, 0xE4, 0xD3, 0x8A, 0xBD, 0x38, 0x0F, 0x56, 0x61,
+0x94, 0xA3, 0xFA, 0xCD, 0x48, 0x7F, 0x26, 0x11, 0xED, 0xDA, 0x83, 0xB4, 0x31, 0x06, 0x5F, 0x68,
+0x66, 0x51, 0x08, 0x3F, 0xBA, 0x8D, 0xD4, 0xE3, 0x1F, 0x28, 0x71, 0x46, 0xC3, 0xF4, 0xAD, 0x9A,
+0xB1, 0x86, 0xDF, 0xE8, 0x6D, 0x5A, 0x03, 0x34, 0xC8, 0xFF, 0xA6, 0x91, 0x14, 0x23, 0x7A, 0x4D,
+0x43, 0x74, 0x2D, 0x1A, 0x9F, 0xA8, 0xF1, 0xC6, 0x3A, 0x0D, 0x54, 0x63, 0xE6, 0xD1, 0x88, 0xBF,
+0xDE, 0xE9, 0xB0, 0x87, 0x02, 0x35, 0x6C, 0x5B, 0xA7, 0x90, 0xC9, 0xFE, 0x7B, 0x4C, 0x15, 0x22,
+0x2C, 0x1B, 0x42, 0x75, 0xF0, 0xC7, 0x9E, 0xA9, 0x55, 0x62, 0x3B, 0x0C, 0x89, 0xBE, 0xE7, 0xD0,
+0xFB, 0xCC, 0x95, 0xA2, 0x27, 0x10, 0x49, 0x7E, 0x82, 0xB5, 0xEC, 0xDB, 0x5E, 0x69, 0x30, 0x07,
+0x09, 0x3E, 0x67, 0x50, 0xD5, 0xE2, 0xBB, 0x8C, 0x70, 0x47, 0x1E, 0x29, 0xAC, 0x9B, 0xC2, 0xF5},
+{
+0x00, 0x51, 0xA2, 0xF3, 0x85, 0xD4, 0x27, 0x76, 0xCB, 0x9A, 0x69, 0x38, 0x4E, 0x1F, 0xEC, 0xBD,
+0x57, 0x06, 0xF5, 0xA4, 0xD2, 0x83, 0x70, 0x21, 0x9C, 0xCD, 0x3E, 0x6F, 0x19, 0x48, 0xBB, 0xEA,
+0xAE, 0xFF, 0x0C, 0x5D, 0x2B, 0x7A, 0x89, 0xD8, 0x65, 0x34, 0xC7, 0x96, 0xE0, 0xB1, 0x42, 0x13,
+0xF9, 0xA8, 0x5B, 0x0A, 0x7C, 0x2D, 0xDE, 0x8F, 0x32, 0x63, 0x90, 0xC1, 0xB7, 0xE6, 0x15, 0x44,
+0x9D, 0xCC, 0x3F, 0x6E, 0x18, 0x49, 0xBA, 0xEB, 0x56, 0x07, 0xF4, 0xA5, 0xD3, 0x82, 0x71, 0x20,
+0xCA, 0x9B, 0x68, 0x39, 0x4F, 0x1E, 0xED, 0xBC, 0x01, 0x50, 0xA3, 0xF2, 0x84, 0xD5, 0x26, 0x77,
+0x33, 0x62, 0x91, 0xC0, 0xB6, 0xE7, 0x14, 0x45, 0xF8, 0xA9, 0x5A, 0x0B, 0x7D, 0x2C, 0xDF, 0x8E,
+0x64, 0x35, 0xC6, 0x97, 0xE1, 0xB0, 0x43, 0x12, 0xAF, 0xFE, 0x0D, 0x5C, 0x2A, 0x7B, 0x88, 0xD9,
+0xFB, 0xAA, 0x59, 0x08, 0x7E, 0x2F, 0xDC, 0x8D, 0x30, 0x61, 0x92, 0xC3, 0xB5, 0xE4, 0x17, 0x46,
+0xAC, 0xFD, 0x0E, 0x5F, 0x29, 0x78, 0x8B, 0xDA, 0x67, 0x36, 0xC5, 0x94, 0xE2, 0xB3, 0x40, 0x11,
+0x55, 0x04, 0xF7, 0xA6, 0xD0, 0x81, 0x72, 0x23, 0x9E, 0xCF, 0x3C, 0x6D, 0x1B, 0x4A, 0xB9, 0xE8,
+0x02, 0x53, 0xA0, 0xF1, 0x87, 0xD6, 0x25, 0x74, 0xC9, 0x98, 0x6B, 0x3A, 0x4C, 0x1D, 0xEE, 0xBF,
+0x66, 0x37, 0xC4, 0x95, 0xE3, 0xB2, 0x41, 0x10, 0xAD, 0xFC, 0x0F, 0x5E, 0x28, 0x79, 0x8A, 0xDB,
+0x31, 0x60, 0x93, 0xC2, 0xB4, 0xE5, 0x16, 0x47, 0xFA, 0xAB, 0x58, 0x09, 0x7F, 0x2E, 0xDD, 0x8C,
+0xC8, 0x99, 0x6A, 0x3B, 0x4D, 0x1C, 0xEF, 0xBE, 0x03, 0x52, 0xA1, 0xF0, 0x86, 0xD7, 0x24, 0x75,
+0x9F, 0xCE, 0x3D, 0x6C, 0x1A, 0x4B, 0xB8, 0xE9, 0x54, 0x05, 0xF6, 0xA7, 0xD1, 0x80, 0x73, 0x22},
+{
+0x00, 0xFD, 0x3B, 0xC6, 0x76, 0x8B, 0x4D, 0xB0, 0xEC, 0x11, 0xD7, 0x2A, 0x9A, 0x67, 0xA1, 0x5C,
+0x19, 0xE4, 0x22, 0xDF, 0x6F, 0x92, 0x54, 0xA9, 0xF5, 0x08, 0xCE, 0x33, 0x83, 0x7E, 0xB8, 0x45,
+0x32, 0xCF, 0x09, 0xF4, 0x44, 0xB9, 0x7F, 0x82, 0xDE, 0x23, 0xE5, 0x18, 0xA8, 0x55, 0x93, 0x6E,
+0x2B, 0xD6, 0x10, 0xED, 0x5D, 0xA0, 0x66, 0x9B, 0xC7, 0x3A, 0xFC, 0x01, 0xB1, 0x4C, 0x8A, 0x77,
+0x64, 0x99, 0x5F, 0xA2, 0x12, 0xEF, 0x29, 0xD4, 0x88, 0x75, 0xB3, 0x4E, 0xFE, 0x03, 0xC5, 0x38,
+0x7D, 0x80, 0x46, 0xBB, 0x0B, 0xF6, 0x30, 0xCD, 0x91, 0x6C, 0xAA, 0x57, 0xE7, 0x1A, 0xDC, 0x21,
+0x56, 0xAB, 0x6D, 0x90, 0x20, 0xDD, 0x1B, 0xE6, 0xBA, 0x47, 0x81, 0x7C, 0xCC, 0x31, 0xF7, 0x0A,
+0x4F, 0xB2, 0x74, 0x89, 0x39, 0xC4, 0x02, 0xFF, 0xA3, 0x5E, 0x98, 0x65, 0xD5, 0x28, 0xEE, 0x13,
+0xC8, 0x35, 0xF3, 0x0E, 0xBE, 0x43, 0x85, 0x78, 0x24, 0xD9, 0x1F, 0xE2, 0x52, 0xAF, 0x69, 0x94,
+0xD1, 0x2C, 0xEA, 0x17, 0xA7, 0x5A, 0x9C, 0x61, 0x3D, 0xC0, 0x06, 0xFB, 0x4B, 0xB6, 0x70, 0x8D,
+0xFA, 0x07, 0xC1, 0x3C, 0x8C, 0x71, 0xB7, 0x4A, 0x16, 0xEB, 0x2D, 0xD0, 0x60, 0x9D, 0x5B, 0xA6,
+0xE3, 0x1E, 0xD8, 0x25, 0x95, 0x68, 0xAE, 0x53, 0x0F, 0xF2, 0x34, 0xC9, 0x79, 0x84, 0x42, 0xBF,
+0xAC, 0x51, 0x97, 0x6A, 0xDA, 0x27, 0xE1, 0x1C, 0x40, 0xBD, 0x7B, 0x86, 0x36, 0xCB, 0x0D, 0xF0,
+0xB5, 0x48, 0x8E, 0x73, 0xC3, 0x3E, 0xF8, 0x05, 0x59, 0xA4, 0x62, 0x9F, 0x2F, 0xD2, 0x14, 0xE9,
+0x9E, 0x63, 0xA5, 0x58, 0xE8, 0x15, 0xD3, 0x2E, 0x72, 0x8F, 0x49, 0xB4, 0x04, 0xF9, 0x3F, 0xC2,
+0x87, 0x7A, 0xBC, 0x41, 0xF1, 0x0C, 0xCA, 0x37, 0x6B, 0x96, 0x50, 0xAD, 0x1D, 0xE0, 0x26, 0xDB}};
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static crc8_engine active_engine = CRC8_UNRESOLVED; /* engine in use */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define T1  crc8_slice_table[ 0 ]
+#define T2  crc8_slice_table[ 1 ]
+#define T3  crc8_slice_table[ 2 ]
+#define T4  crc8_slice_table[ 3 ]
+#define T5  crc8_slice_table[ 4 ]
+#define T6  crc8_slice_table[ 5 ]
+#define T7  crc8_slice_table[ 6 ]
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_bytewise
+*
+*   DESCRIPTION:
+*       original crc8, one table lookup per byte
+*
+*********************************************************************/
+static uint8_t crc8_bytewise
+    (
+    uint8_t crc,
+    const uint8_t data[],
+    size_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+size_t i;                                    /* iterator  */
+
+/*----------------------------------------------------------
+Calculate crc
+----------------------------------------------------------*/
+for( i = 0; i < size; i++ )
+    {
+    crc = crc8_table[ crc ^ data[ i ] ];
+    }
+
+return crc;
+
+} /* crc8_bytewise() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_slice4
+*
+*   DESCRIPTION:
+*       crc8 four bytes per step. the four lookups are independent
+*       so they do not wait on each other like the bytewise chain
+*
+*********************************************************************/
+static uint8_t crc8_slice4
+    (
+    uint8_t crc,
+    const uint8_t data[],
+    size_t size
+    )
+{
+
+while( size >= 4 )
+    {
+    crc = T3[ crc ^ data[ 0 ] ] ^ T2[ data[ 1 ] ]
+        ^ T1[ data[ 2 ] ] ^ crc8_table[ data[ 3 ] ];
+
+    data += 4;
+    size -= 4;
+    }
+
+return crc8_bytewise( crc, data, size );
+
+} /* crc8_slice4() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_slice8
+*
+*   DESCRIPTION:
+*       crc8 eight bytes per step
+*
+*********************************************************************/
+static uint8_t crc8_slice8
+    (
+    uint8_t crc,
+    const uint8_t data[],
+    size_t size
+    )
+{
+
+while( size >= 8 )
+    {
+    crc = T7[ crc ^ data[ 0 ] ] ^ T6[ data[ 1 ] ]
+        ^ T5[ data[ 2 ] ] ^ T4[ data[ 3 ] ]
+        ^ T3[ data[ 4 ] ] ^ T2[ data[ 5 ] ]
+        ^ T1[ data[ 6 ] ] ^ crc8_table[ data[ 7 ] ];
+
+    data += 8;
+    size -= 8;
+    }
+
+return crc8_slice4( crc, data, size );
+
+} /* crc8_slice8() */
+
+#if defined( CRC8_HAVE_CLMUL )
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       clmul64
+*
+*   DESCRIPTION:
+*       carry-less multiply of two 64 bit values, low and high
+*       halves of the product returned through lo and hi
+*
+*********************************************************************/
+#if defined( __x86_64__ )
+__attribute__(( target( "pclmul" ) ))
+#else
+__attribute__(( target( "+crypto" ) ))
+#endif
+static inline void clmul64
+    (
+    uint64_t a,
+    uint64_t b,
+    uint64_t *lo,
+    uint64_t *hi
+    )
+{
+#if defined( __x86_64__ )
+__m128i product;
+
+product = _mm_clmulepi64_si128( _mm_cvtsi64_si128( ( long long ) a ),
+                                _mm_cvtsi64_si128( ( long long ) b ), 0x00 );
+*lo = ( uint64_t ) _mm_cvtsi128_si64( product );
+*hi = ( uint64_t ) _mm_cvtsi128_si64( _mm_unpackhi_epi64( product, product ) );
+#else
+uint64x2_t product;
+
+product = vreinterpretq_u64_p128( vmull_p64( ( poly64_t ) a, ( poly64_t ) b ) );
+*lo = vgetq_lane_u64( product, 0 );
+*hi = vgetq_lane_u64( product, 1 );
+#endif
+
+} /* clmul64() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_barrett
+*
+*   DESCRIPTION:
+*       crc of 8 little endian bytes already xor'd with the crc so
+*       far, one Barrett reduction
+*
+*********************************************************************/
+#if defined( __x86_64__ )
+__attribute__(( target( "pclmul" ) ))
+#else
+__attribute__(( target( "+crypto" ) ))
+#endif
+static inline uint8_t crc8_barrett
+    (
+    uint64_t value
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t lo;                    /* low half of product      */
+uint64_t hi;                    /* high half of product     */
+uint64_t quotient;              /* reflected quotient       */
+
+/*----------------------------------------------------------
+quotient = value * floor( x^72 / P ) / x^64, then the crc
+is the low 8 bits of quotient * P. P = x^8 + x^2 + x + 1
+so the second multiply is three shifts
+----------------------------------------------------------*/
+clmul64( value, BARRETT_CONSTANT, &lo, &hi );
+quotient = value ^ ( lo << 1 );
+
+return ( uint8_t )( ( quotient >> 58 ) ^ ( quotient >> 57 ) ^ ( quotient >> 56 ) );
+
+} /* crc8_barrett() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_clmul
+*
+*   DESCRIPTION:
+*       crc8 using carry-less multiply. buffers of 32 bytes or more
+*       are folded 16 bytes per step into a 128 bit state, the state
+*       and any remaining 8 byte blocks are reduced by Barrett
+*
+*********************************************************************/
+#if defined( __x86_64__ )
+__attribute__(( target( "pclmul" ) ))
+#else
+__attribute__(( target( "+crypto" ) ))
+#endif
+static uint8_t crc8_clmul
+    (
+    uint8_t crc,
+    const uint8_t data[],
+    size_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t state_lo;              /* first 8 bytes of state   */
+uint64_t state_hi;              /* last 8 bytes of state    */
+uint64_t lo_lo;                 /* state_lo fold, low half  */
+uint64_t lo_hi;                 /* state_lo fold, high half */
+uint64_t hi_lo;                 /* state_hi fold, low half  */
+uint64_t hi_hi;                 /* state_hi fold, high half */
+uint64_t block;                 /* next 8 bytes             */
+
+/*----------------------------------------------------------
+Fold 16 bytes per step
+----------------------------------------------------------*/
+if( size >= 32 )
+    {
+    memcpy( &state_lo, &data[ 0 ], sizeof( state_lo ) );
+    memcpy( &state_hi, &data[ 8 ], sizeof( state_hi ) );
+    state_lo ^= crc;
+    data += 16;
+    size -= 16;
+
+    while( size >= 16 )
+        {
+        clmul64( state_lo, FOLD_128_CONSTANT, &lo_lo, &lo_hi );
+        clmul64( state_hi, FOLD_64_CONSTANT, &hi_lo, &hi_hi );
+
+        memcpy( &state_lo, &data[ 0 ], sizeof( state_lo ) );
+        memcpy( &state_hi, &data[ 8 ], sizeof( state_hi ) );
+        state_lo ^= lo_lo ^ hi_lo;
+        state_hi ^= lo_hi ^ hi_hi;
+
+        data += 16;
+        size -= 16;
+        }
+
+    crc = crc8_barrett( state_lo );
+    crc = crc8_barrett( state_hi ^ crc );
+    }
+
+/*----------------------------------------------------------
+Reduce remaining 8 byte blocks
+----------------------------------------------------------*/
+while( size >= 8 )
+    {
+    memcpy( &block, data, sizeof( block ) );
+    crc = crc8_barrett( block ^ crc );
+
+    data += 8;
+    size -= 8;
+    }
+
+return crc8_bytewise( crc, data, size );
+
+} /* crc8_clmul() */
+#endif /* CRC8_HAVE_CLMUL */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_supported
+*
+*   DESCRIPTION:
+*       check if engine can run on this cpu
+*
+*   RETURN:
+*       T/F engine available y/n
+*
+*********************************************************************/
+bool crc8_supported
+    (
+    crc8_engine engine
+    )
+{
+
+switch( engine )
+    {
+    case CRC8_BYTEWISE:
+    case CRC8_SLICE4:
+    case CRC8_SLICE8:
+        return true;
+
+    case CRC8_CLMUL:
+#if defined( CRC8_HAVE_CLMUL ) && defined( __x86_64__ )
+        return __builtin_cpu_supports( "pclmul" );
+#elif defined( CRC8_HAVE_CLMUL )
+        return ( getauxval( AT_HWCAP ) & HWCAP_PMULL ) != 0;
+#else
+        return false;
+#endif
+
+    default:
+        return false;
+    }
+
+} /* crc8_supported() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_select
+*
+*   DESCRIPTION:
+*       force engine used by crc8_update
+*
+*   RETURN:
+*       T/F engine selected y/n
+*
+*********************************************************************/
+bool crc8_select
+    (
+    crc8_engine engine
+    )
+{
+
+if( ! crc8_supported( engine ) )
+    {
+    return false;
+    }
+
+active_engine = engine;
+
+return true;
+
+} /* crc8_select() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_selected
+*
+*   DESCRIPTION:
+*       engine used by crc8_update, picked on first use as the
+*       fastest one this cpu supports
+*
+*********************************************************************/
+crc8_engine crc8_selected
+    (
+    void
+    )
+{
+
+if( active_engine == CRC8_UNRESOLVED )
+    {
+    active_engine = crc8_supported( CRC8_CLMUL ) ? CRC8_CLMUL : CRC8_SLICE8;
+    }
+
+return active_engine;
+
+} /* crc8_selected() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       run_engine
+*
+*   DESCRIPTION:
+*       add data[] to crc using an engine known to run here
+*
+*********************************************************************/
+static uint8_t run_engine
+    (
+    crc8_engine engine,
+    uint8_t crc,
+    const uint8_t data[],
+    size_t size
+    )
+{
+
+switch( engine )
+    {
+    case CRC8_SLICE4:
+        return crc8_slice4( crc, data, size );
+
+    case CRC8_SLICE8:
+        return crc8_slice8( crc, data, size );
+
+#if defined( CRC8_HAVE_CLMUL )
+    case CRC8_CLMUL:
+        return crc8_clmul( crc, data, size );
+#endif
+
+    default:
+        return crc8_bytewise( crc, data, size );
+    }
+
+} /* run_engine() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_update_with
+*
+*   DESCRIPTION:
+*       add data[] to crc using a given engine. an engine this cpu
+*       can not run is replaced by CRC8_SLICE8, which gives the
+*       same crc
+*
+*********************************************************************/
+uint8_t crc8_update_with
+    (
+    crc8_engine engine,
+    uint8_t crc,
+    const uint8_t data[],
+    size_t size
+    )
+{
+
+if( ! crc8_supported( engine ) )
+    {
+    engine = CRC8_SLICE8;
+    }
+
+return run_engine( engine, crc, data, size );
+
+} /* crc8_update_with() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       crc8_update
+*
+*   DESCRIPTION:
+*       add data[] to crc. start from crc8_init() and finish with
+*       crc8_final(), data can be added in any number of pieces
+*
+*********************************************************************/
+uint8_t crc8_update
+    (
+    uint8_t crc,
+    const uint8_t data[],
+    size_t size
+    )
+{
+
+/*----------------------------------------------------------
+Short runs gain nothing from the wide engines
+----------------------------------------------------------*/
+if( size < 8 )
+    {
+    return crc8_bytewise( crc, data, size );
+    }
+
+/*----------------------------------------------------------
+crc8_selected only gives engines that were checked
+----------------------------------------------------------*/
+return run_engine( crc8_selected(), crc, data, size );
+
+} /* crc8_update() */
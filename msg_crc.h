@@ -0,0 +1,91 @@
+/*********************************************************************
+*
+*   HEADER:
+*       crc8 engine for messageAPI. same crc as the original
+*       crc8_table loop (reflected polynomal 0x7, no init or final
+*       xor) with slice-by-4/8 tables, an incremental interface and
+*       carry-less multiply folding on hosts that support it
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_CRC_H
+#define MSG_CRC_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define CRC8_INIT           ( 0x00 )    /* crc before any data      */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef enum                            /* crc implementations      */
+    {
+    CRC8_BYTEWISE,                      /* one table lookup a byte  */
+    CRC8_SLICE4,                        /* four bytes per step      */
+    CRC8_SLICE8,                        /* eight bytes per step     */
+    CRC8_CLMUL,                         /* PCLMUL/PMULL folding     */
+    CRC8_ENGINE_COUNT
+    } crc8_engine;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define crc8_init()         ( ( uint8_t ) CRC8_INIT )
+
+#define crc8_final( crc )   ( ( uint8_t )( crc ) )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_crc.c
+--------------------------------------------------------------------*/
+uint8_t crc8_update
+    (
+    uint8_t crc,                        /* crc so far               */
+    const uint8_t data[],               /* data to add              */
+    size_t size                         /* size of data[]           */
+    );
+
+uint8_t crc8_update_with
+    (
+    crc8_engine engine,                 /* implementation to use    */
+    uint8_t crc,                        /* crc so far               */
+    const uint8_t data[],               /* data to add              */
+    size_t size                         /* size of data[]           */
+    );
+
+bool crc8_supported
+    (
+    crc8_engine engine                  /* implementation to check  */
+    );
+
+bool crc8_select
+    (
+    crc8_engine engine                  /* implementation to use    */
+    );
+
+crc8_engine crc8_selected
+    (
+    void
+    );
+
+#endif /* MSG_CRC_H */
+/* msg_crc.h */
@@ -0,0 +1,354 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_csma.c
+*
+*   DESCRIPTION:
+*       listen before talk. a frame is sent straight away when
+*       nothing is held and the sense hook finds the channel clear.
+*       otherwise it joins a queue whose head is retried from
+*       csma_poll after a backoff of 1 to 2^BE slots, BE growing
+*       from CSMA_MIN_BE to CSMA_MAX_BE each time the channel is
+*       found busy (non-persistent CSMA with binary exponential
+*       backoff)
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_csma.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define DEFAULT_SEED        ( 0x9E3779B9 ) /* used for a seed of 0  */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       channel_busy
+*
+*   DESCRIPTION:
+*       run the sense hook, no hook means always clear
+*
+*   RETURN:
+*       T/F channel busy y/n
+*
+*********************************************************************/
+static bool channel_busy
+    (
+    csma_port *csma
+    )
+{
+
+if( csma->sense == NULL || ! csma->sense( csma->sense_arg ) )
+    {
+    return false;
+    }
+
+csma->stats.busy++;
+
+return true;
+
+} /* channel_busy() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       draw_backoff
+*
+*   DESCRIPTION:
+*       hold the head frame for 1 to 2^BE slots, then raise BE
+*
+*********************************************************************/
+static void draw_backoff
+    (
+    csma_port *csma
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t wait;                          /* backoff in ms            */
+
+/*----------------------------------------------------------
+xorshift32
+----------------------------------------------------------*/
+csma->random ^= csma->random << 13;
+csma->random ^= csma->random >> 17;
+csma->random ^= csma->random << 5;
+
+wait = ( ( csma->random % ( ( uint32_t ) 1 << csma->exponent ) ) + 1 ) * CSMA_SLOT_MS;
+
+csma->backoff_until = csma->now_ms + wait;
+csma->stats.backoffs++;
+csma->stats.backoff_ms += wait;
+
+if( csma->exponent < CSMA_MAX_BE )
+    {
+    csma->exponent++;
+    }
+
+} /* draw_backoff() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_now
+*
+*   DESCRIPTION:
+*       hand frame to the inner transport
+*
+*********************************************************************/
+static lora_errors send_now
+    (
+    csma_port *csma,
+    uint8_t data[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_errors errors;
+
+errors = csma->inner.send( csma->inner.port, data, size );
+if( errors == RX_NO_ERROR )
+    {
+    csma->stats.sent++;
+    }
+else
+    {
+    csma->stats.send_errors++;
+    }
+
+csma->attempts = 0;
+csma->exponent = CSMA_MIN_BE;
+
+return errors;
+
+} /* send_now() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       csma_send
+*
+*   DESCRIPTION:
+*       send frame if the channel is clear and nothing is held,
+*       else queue it behind the held frames
+*
+*   RETURN:
+*       RX_TIMEOUT when the queue is full
+*
+*********************************************************************/
+static lora_errors csma_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+csma_port *csma;                        /* listen before talk state */
+csma_frame *frame;                      /* slot to fill             */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+csma = ( csma_port * ) port;
+
+if( csma->count == 0 && ! channel_busy( csma ) )
+    {
+    return send_now( csma, message_array, size );
+    }
+
+/*----------------------------------------------------------
+Hold frame, a busy channel starts the backoff
+----------------------------------------------------------*/
+if( csma->count >= CSMA_QUEUE_SIZE )
+    {
+    csma->stats.rejected++;
+    return RX_TIMEOUT;
+    }
+
+frame = &csma->queue[ ( csma->head + csma->count ) % CSMA_QUEUE_SIZE ];
+frame->size = size;
+memcpy( frame->data, message_array, size );
+csma->stats.deferred++;
+
+if( csma->count++ == 0 )
+    {
+    csma->attempts = 1;
+    draw_backoff( csma );
+    }
+
+return RX_NO_ERROR;
+
+} /* csma_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       csma_transport
+*
+*   DESCRIPTION:
+*       return transport that listens before sending on inner.
+*       sense returns true while the channel is in use; wire it to
+*       the radio's CAD or compare RSSI against a threshold. seed
+*       should differ between modules, e.g. from RSSI noise
+*
+*********************************************************************/
+msg_transport csma_transport
+    (
+    csma_port *port,
+    const msg_transport *inner,
+    csma_sense_fn sense,
+    void *sense_arg,
+    uint32_t seed
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+
+/*----------------------------------------------------------
+Reset state
+----------------------------------------------------------*/
+memset( port, 0, sizeof( *port ) );
+port->inner     = *inner;
+port->sense     = sense;
+port->sense_arg = sense_arg;
+port->random    = ( seed != 0 ) ? seed : DEFAULT_SEED;
+port->exponent  = CSMA_MIN_BE;
+
+transport = forward_transport( port );
+transport.send      = csma_send;
+
+return transport;
+
+} /* csma_transport() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       csma_poll
+*
+*   DESCRIPTION:
+*       retry held frames whose backoff is over. a clear channel
+*       sends the head and moves on to the next, a busy one draws
+*       a longer backoff, and after CSMA_MAX_ATTEMPTS busy checks
+*       the head is dropped. call periodically
+*
+*********************************************************************/
+void csma_poll
+    (
+    csma_port *port,
+    uint32_t now_ms
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+csma_frame *frame;                      /* head frame               */
+
+port->now_ms = now_ms;
+
+while( port->count > 0 && ! time_before( now_ms, port->backoff_until ) )
+    {
+    frame = &port->queue[ port->head ];
+
+    if( channel_busy( port ) )
+        {
+        if( ++port->attempts < CSMA_MAX_ATTEMPTS )
+            {
+            draw_backoff( port );
+            return;
+            }
+
+        port->stats.dropped++;
+        port->attempts = 0;
+        port->exponent = CSMA_MIN_BE;
+        }
+    else
+        {
+        ( void ) send_now( port, frame->data, frame->size );
+        ( void ) port->inner.rx_mode( port->inner.port );
+        }
+
+    port->head = ( uint8_t )( ( port->head + 1 ) % CSMA_QUEUE_SIZE );
+    port->count--;
+    }
+
+} /* csma_poll() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       csma_pending
+*
+*   DESCRIPTION:
+*       frames waiting for the channel
+*
+*********************************************************************/
+uint8_t csma_pending
+    (
+    csma_port *port
+    )
+{
+
+return port->count;
+
+} /* csma_pending() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       csma_get_stats
+*
+*   DESCRIPTION:
+*       copy listen before talk counters
+*
+*********************************************************************/
+void csma_get_stats
+    (
+    csma_port *port,
+    csma_stats *stats
+    )
+{
+
+*stats = port->stats;
+
+} /* csma_get_stats() */
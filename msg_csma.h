@@ -0,0 +1,136 @@
+/*********************************************************************
+*
+*   HEADER:
+*       listen before talk for messageAPI. a msg_transport that sits
+*       in front of the radio, checks the channel with a CAD or RSSI
+*       hook before each frame and, while the channel is busy, holds
+*       frames back for a random, exponentially growing backoff
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_CSMA_H
+#define MSG_CSMA_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#ifndef CSMA_QUEUE_SIZE
+#define CSMA_QUEUE_SIZE     ( 8 )       /* frames held for backoff  */
+#endif
+
+#ifndef CSMA_SLOT_MS
+#define CSMA_SLOT_MS        ( 50 )      /* backoff unit, about one
+                                           short frame of airtime   */
+#endif
+
+#ifndef CSMA_MIN_BE
+#define CSMA_MIN_BE         ( 1 )       /* first backoff exponent   */
+#endif
+
+#ifndef CSMA_MAX_BE
+#define CSMA_MAX_BE         ( 6 )       /* backoff exponent cap     */
+#endif
+
+#ifndef CSMA_MAX_ATTEMPTS
+#define CSMA_MAX_ATTEMPTS   ( 8 )       /* busy checks before frame
+                                           is dropped               */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef bool ( *csma_sense_fn )         /* channel check            */
+    (
+    void *arg                           /* csma_transport argument  */
+    );                                  /* returns T/F busy y/n     */
+
+typedef struct                          /* listen before talk counts */
+    {
+    uint32_t sent;                      /* frames sent              */
+    uint32_t deferred;                  /* frames that had to wait  */
+    uint32_t busy;                      /* checks that found the
+                                           channel in use           */
+    uint32_t backoffs;                  /* backoffs drawn           */
+    uint32_t backoff_ms;                /* total backoff time       */
+    uint32_t dropped;                   /* gave up, CSMA_MAX_ATTEMPTS */
+    uint32_t rejected;                  /* turned away, queue full  */
+    uint32_t send_errors;               /* inner transport failures */
+    } csma_stats;
+
+typedef struct                          /* held frame               */
+    {
+    uint8_t size;                       /* size of data[]           */
+    uint8_t data[ MAX_LORA_MSG_SIZE ];  /* raw frame                */
+    } csma_frame;
+
+typedef struct                          /* listen before talk state */
+    {
+    msg_transport inner;                /* radio frames go out on   */
+    csma_sense_fn sense;                /* channel busy check       */
+    void *sense_arg;                    /* passed to sense          */
+    uint32_t random;                    /* xorshift state           */
+    uint32_t now_ms;                    /* time of last csma_poll   */
+    uint32_t backoff_until;             /* head waits until         */
+    uint8_t exponent;                   /* current backoff exponent */
+    uint8_t attempts;                   /* busy checks for head     */
+    uint8_t head;                       /* oldest held frame        */
+    uint8_t count;                      /* frames held              */
+    csma_frame queue[ CSMA_QUEUE_SIZE ];/* frames held              */
+    csma_stats stats;                   /* counters                 */
+    } csma_port;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_csma.c
+--------------------------------------------------------------------*/
+msg_transport csma_transport
+    (
+    csma_port *port,                    /* listen before talk state */
+    const msg_transport *inner,         /* radio to send on         */
+    csma_sense_fn sense,                /* CAD or RSSI check        */
+    void *sense_arg,                    /* passed to sense          */
+    uint32_t seed                       /* backoff random seed      */
+    );
+
+void csma_poll
+    (
+    csma_port *port,                    /* listen before talk state */
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+uint8_t csma_pending
+    (
+    csma_port *port                     /* listen before talk state */
+    );
+
+void csma_get_stats
+    (
+    csma_port *port,                    /* listen before talk state */
+    csma_stats *stats                   /* pointer to store stats   */
+    );
+
+#endif /* MSG_CSMA_H */
+/* msg_csma.h */
@@ -0,0 +1,509 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_frag.c
+*
+*   DESCRIPTION:
+*       fragmentation and reassembly of buffers larger than one
+*       frame. fragments may arrive in any order; a fixed table of
+*       reassembly entries, one per sending module, collects them
+*       until the message is complete or times out. all state is
+*       in a frag_ctx, so each message_ctx can fragment on its own
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_frag.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#if FRAG_MAX_FRAGMENTS > 0xFFFF
+#error FRAG_MAX_MESSAGE_SIZE needs more fragments than the 16 bit count holds
+#endif
+
+#define ID_BYTE             ( 0 )       /* message id index         */
+
+#define INDEX_BYTE          ( 1 )       /* fragment index, 2 bytes  */
+
+#define COUNT_BYTE          ( 3 )       /* fragment count, 2 bytes  */
+
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static frag_ctx default_frag;           /* state behind the plain
+                                           calls                    */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define read_u16( array, index )  \
+    ( ( uint16_t )( ( ( array )[ ( index ) ] << 8 ) | ( array )[ ( index ) + 1 ] ) )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+static void frag_receive
+    (
+    const msg_view *view,               /* fragment frame           */
+    void *arg                           /* frag_ctx                 */
+    );
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       find_entry
+*
+*   DESCRIPTION:
+*       find reassembly entry for source, or claim a free or timed
+*       out one
+*
+*   RETURN:
+*       entry, NULL if table is full
+*
+*********************************************************************/
+static frag_entry * find_entry
+    (
+    frag_ctx *frag,                     /* fragmentation state      */
+    location source                     /* sending module           */
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+frag_entry *free_entry;                 /* first reusable entry     */
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+free_entry = NULL;
+
+for( i = 0; i < FRAG_TABLE_SIZE; i++ )
+    {
+    if( frag->table[ i ].in_use && frag->table[ i ].source == source )
+        {
+        return &frag->table[ i ];
+        }
+
+    if( free_entry == NULL
+     && ( ! frag->table[ i ].in_use || frag->current_ms - frag->table[ i ].last_ms > FRAG_TIMEOUT_MS ) )
+        {
+        free_entry = &frag->table[ i ];
+        }
+    }
+
+/*----------------------------------------------------------
+Claiming a timed out entry counts as its timeout
+----------------------------------------------------------*/
+if( free_entry != NULL && free_entry->in_use )
+    {
+    frag->stats.timeouts++;
+    free_entry->in_use = false;
+    }
+
+return free_entry;
+
+} /* find_entry() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_receive
+*
+*   DESCRIPTION:
+*       MSG_PORT_FRAGMENT handler, place fragment in its entry and
+*       deliver the message once every fragment is in
+*
+*********************************************************************/
+static void frag_receive
+    (
+    const msg_view *view,
+    void *arg
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+frag_ctx *frag;                         /* fragmentation state      */
+frag_entry *entry;                      /* reassembly entry         */
+uint16_t index;                         /* fragment index           */
+uint16_t count;                         /* fragments in message     */
+uint8_t size;                           /* fragment data size       */
+const uint8_t *data;                    /* fragment data            */
+
+frag = ( frag_ctx * ) arg;
+
+/*----------------------------------------------------------
+Verify fragment header. every fragment but the last is
+full, so index alone gives the offset
+----------------------------------------------------------*/
+if( view->size < FRAG_HEADER_SIZE )
+    {
+    frag->stats.invalid++;
+    return;
+    }
+
+index   = read_u16( view->payload, INDEX_BYTE );
+count   = read_u16( view->payload, COUNT_BYTE );
+size    = view->size - FRAG_HEADER_SIZE;
+data    = &view->payload[ FRAG_HEADER_SIZE ];
+
+if( count == 0 || index >= count || count > FRAG_MAX_FRAGMENTS
+ || size > FRAG_DATA_SIZE || ( index + 1 < count && size != FRAG_DATA_SIZE )
+ || ( uint32_t ) index * FRAG_DATA_SIZE + size > FRAG_MAX_MESSAGE_SIZE )
+    {
+    frag->stats.invalid++;
+    return;
+    }
+
+/*----------------------------------------------------------
+Single fragment messages skip the table
+----------------------------------------------------------*/
+if( count == 1 )
+    {
+    frag->stats.completed++;
+    if( frag->complete_cb != NULL )
+        {
+        frag->complete_cb( view->source, data, size, frag->complete_arg );
+        }
+    return;
+    }
+
+/*----------------------------------------------------------
+Find entry, a new id from the same source replaces the
+message still being collected
+----------------------------------------------------------*/
+entry = find_entry( frag, view->source );
+if( entry == NULL )
+    {
+    frag->stats.no_entry++;
+    return;
+    }
+
+if( entry->in_use && ( entry->id != view->payload[ ID_BYTE ] || entry->count != count ) )
+    {
+    frag->stats.replaced++;
+    entry->in_use = false;
+    }
+
+if( ! entry->in_use )
+    {
+    memset( entry->map, 0, sizeof( entry->map ) );
+    entry->in_use   = true;
+    entry->source   = view->source;
+    entry->id       = view->payload[ ID_BYTE ];
+    entry->count    = count;
+    entry->received = 0;
+    entry->size     = 0;
+    }
+
+entry->last_ms = frag->current_ms;
+
+/*----------------------------------------------------------
+Store fragment
+----------------------------------------------------------*/
+if( entry->map[ index / 8 ] & ( 1 << ( index % 8 ) ) )
+    {
+    frag->stats.duplicates++;
+    return;
+    }
+
+entry->map[ index / 8 ] |= ( uint8_t )( 1 << ( index % 8 ) );
+entry->received++;
+memcpy( &entry->data[ ( uint32_t ) index * FRAG_DATA_SIZE ], data, size );
+
+if( index + 1 == count )
+    {
+    entry->size = ( uint32_t ) index * FRAG_DATA_SIZE + size;
+    }
+
+/*----------------------------------------------------------
+Deliver completed message
+----------------------------------------------------------*/
+if( entry->received == entry->count )
+    {
+    entry->in_use = false;
+    frag->stats.completed++;
+    if( frag->complete_cb != NULL )
+        {
+        frag->complete_cb( entry->source, entry->data, entry->size, frag->complete_arg );
+        }
+    }
+
+} /* frag_receive() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_init_ctx
+*
+*   DESCRIPTION:
+*       clear reassembly table and take MSG_PORT_FRAGMENT on ctx.
+*       callback runs from get_message_ctx/get_messages_ctx as the
+*       last fragment of a message is received
+*
+*********************************************************************/
+void frag_init_ctx
+    (
+    frag_ctx *frag,
+    message_ctx *ctx,
+    frag_complete_cb callback,
+    void *arg
+    )
+{
+
+memset( frag, 0, sizeof( *frag ) );
+frag->ctx           = ctx;
+frag->complete_cb   = callback;
+frag->complete_arg  = arg;
+
+set_port_handler_ctx( ctx, MSG_PORT_FRAGMENT, frag_receive, frag );
+
+} /* frag_init_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_send_ctx
+*
+*   DESCRIPTION:
+*       split data into fragments and send them to destination.
+*       each fragment is built in place in the frame buffer
+*
+*   RETURN:
+*       RX_ARRAY_SIZE_ERR with nothing sent when size is over
+*       FRAG_MAX_MESSAGE_SIZE, which no receiver can rebuild, or
+*       when a fragment can not be encoded. otherwise the result
+*       of the last fragment sent
+*
+*********************************************************************/
+lora_errors frag_send_ctx
+    (
+    frag_ctx *frag,
+    location destination,
+    const uint8_t data[],
+    uint32_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* frame being sent         */
+uint8_t *fragment;                      /* fragment data in frame   */
+msg_header header;                      /* fragment port header     */
+lora_errors errors;                     /* send result              */
+uint32_t count;                         /* fragments in message     */
+uint8_t frame_size;                     /* size of frame[]          */
+uint32_t index;                         /* fragment being sent      */
+uint8_t chunk;                          /* data in this fragment    */
+
+/*----------------------------------------------------------
+Verify size, receivers drop anything larger
+----------------------------------------------------------*/
+if( size > FRAG_MAX_MESSAGE_SIZE )
+    {
+    return RX_ARRAY_SIZE_ERR;
+    }
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+count = ( size + FRAG_DATA_SIZE - 1 ) / FRAG_DATA_SIZE;
+if( count == 0 )
+    {
+    count = 1;
+    }
+
+memset( &header, 0, sizeof( header ) );
+header.destination  = destination;
+header.port         = MSG_PORT_FRAGMENT;
+fragment            = &frame[ MSG_PORT_DATA_OFFSET ];
+errors              = RX_NO_ERROR;
+
+/*----------------------------------------------------------
+Send fragments in order
+----------------------------------------------------------*/
+for( index = 0; index < count && errors == RX_NO_ERROR; index++ )
+    {
+    chunk = ( uint8_t )( ( size - index * FRAG_DATA_SIZE > FRAG_DATA_SIZE )
+                         ? FRAG_DATA_SIZE : size - index * FRAG_DATA_SIZE );
+
+    fragment[ ID_BYTE ]         = frag->next_id;
+    fragment[ INDEX_BYTE ]      = ( uint8_t )( index >> 8 );
+    fragment[ INDEX_BYTE + 1 ]  = ( uint8_t ) index;
+    fragment[ COUNT_BYTE ]      = ( uint8_t )( count >> 8 );
+    fragment[ COUNT_BYTE + 1 ]  = ( uint8_t ) count;
+    memcpy( &fragment[ FRAG_HEADER_SIZE ], &data[ index * FRAG_DATA_SIZE ], chunk );
+
+    /*------------------------------------------------------
+    An encode of 0 (no key for destination or the frame
+    counter used up) fails the whole message
+    ------------------------------------------------------*/
+    frame_size = encode_message_header_ctx( frag->ctx, &header, fragment, chunk + FRAG_HEADER_SIZE, frame );
+    if( frame_size == 0 )
+        {
+        errors = RX_ARRAY_SIZE_ERR;
+        break;
+        }
+
+    errors = send_frame_ctx( frag->ctx, frame, frame_size );
+    }
+
+frag->next_id++;
+
+return errors;
+
+} /* frag_send_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_poll_ctx
+*
+*   DESCRIPTION:
+*       advance reassembly clock and drop partial messages that have
+*       not seen a fragment for FRAG_TIMEOUT_MS. call periodically
+*
+*********************************************************************/
+void frag_poll_ctx
+    (
+    frag_ctx *frag,
+    uint32_t now_ms
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t i;                              /* iterator                 */
+
+frag->current_ms = now_ms;
+
+for( i = 0; i < FRAG_TABLE_SIZE; i++ )
+    {
+    if( frag->table[ i ].in_use && now_ms - frag->table[ i ].last_ms > FRAG_TIMEOUT_MS )
+        {
+        frag->table[ i ].in_use = false;
+        frag->stats.timeouts++;
+        }
+    }
+
+} /* frag_poll_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_get_stats_ctx
+*
+*   DESCRIPTION:
+*       copy reassembly counters
+*
+*********************************************************************/
+void frag_get_stats_ctx
+    (
+    frag_ctx *frag,
+    frag_stats *stats
+    )
+{
+
+*stats = frag->stats;
+
+} /* frag_get_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_init
+*
+*   DESCRIPTION:
+*       frag_init_ctx on the default context
+*
+*********************************************************************/
+void frag_init
+    (
+    frag_complete_cb callback,
+    void *arg
+    )
+{
+
+frag_init_ctx( &default_frag, get_default_ctx(), callback, arg );
+
+} /* frag_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_send
+*
+*   DESCRIPTION:
+*       frag_send_ctx on the default context
+*
+*********************************************************************/
+lora_errors frag_send
+    (
+    location destination,
+    const uint8_t data[],
+    uint32_t size
+    )
+{
+
+return frag_send_ctx( &default_frag, destination, data, size );
+
+} /* frag_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_poll
+*
+*   DESCRIPTION:
+*       frag_poll_ctx on the default context
+*
+*********************************************************************/
+void frag_poll
+    (
+    uint32_t now_ms
+    )
+{
+
+frag_poll_ctx( &default_frag, now_ms );
+
+} /* frag_poll() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       frag_get_stats
+*
+*   DESCRIPTION:
+*       frag_get_stats_ctx on the default context
+*
+*********************************************************************/
+void frag_get_stats
+    (
+    frag_stats *stats
+    )
+{
+
+frag_get_stats_ctx( &default_frag, stats );
+
+} /* frag_get_stats() */
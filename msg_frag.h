@@ -0,0 +1,173 @@
+/*********************************************************************
+*
+*   HEADER:
+*       fragmentation layer for messageAPI. splits buffers larger
+*       than one frame into numbered fragments on MSG_PORT_FRAGMENT
+*       and reassembles them on the receive side. a frag_ctx holds
+*       the state for one message_ctx, the plain calls use one on
+*       the default context
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_FRAG_H
+#define MSG_FRAG_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define FRAG_HEADER_SIZE    ( 5 )       /* id, index and count      */
+
+#define FRAG_DATA_SIZE      ( MAX_SECURE_LENGTH_V2 - 1 - FRAG_HEADER_SIZE )
+                                        /* data per fragment, must
+                                           match on every module    */
+
+#ifndef FRAG_MAX_MESSAGE_SIZE
+#define FRAG_MAX_MESSAGE_SIZE ( 2048 )  /* largest reassembled msg  */
+#endif
+
+#ifndef FRAG_TABLE_SIZE
+#define FRAG_TABLE_SIZE     ( 2 )       /* sources reassembled at
+                                           the same time            */
+#endif
+
+#ifndef FRAG_TIMEOUT_MS
+#define FRAG_TIMEOUT_MS     ( 5000 )    /* drop partial message
+                                           after this much silence  */
+#endif
+
+#define FRAG_MAX_FRAGMENTS  ( ( FRAG_MAX_MESSAGE_SIZE + FRAG_DATA_SIZE - 1 ) / FRAG_DATA_SIZE )
+
+#define FRAG_MAP_BYTES      ( ( FRAG_MAX_FRAGMENTS + 7 ) / 8 )
+                                        /* received bitmap size     */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef void ( *frag_complete_cb )      /* reassembled message      */
+    (
+    location source,                    /* sending module           */
+    const uint8_t data[],               /* reassembled data         */
+    uint32_t size,                      /* size of data[]           */
+    void *arg                           /* frag_init argument       */
+    );
+
+typedef struct                          /* reassembly counters      */
+    {
+    uint32_t completed;                 /* messages delivered       */
+    uint32_t timeouts;                  /* partials timed out       */
+    uint32_t replaced;                  /* partials cut off by a
+                                           newer message            */
+    uint32_t duplicates;                /* fragments seen twice     */
+    uint32_t no_entry;                  /* table full, dropped      */
+    uint32_t invalid;                   /* bad fragment header      */
+    } frag_stats;
+
+typedef struct                          /* reassembly entry         */
+    {
+    bool in_use;                        /* entry holds a partial    */
+    location source;                    /* sending module           */
+    uint8_t id;                         /* message id               */
+    uint16_t count;                     /* fragments in message     */
+    uint16_t received;                  /* fragments received       */
+    uint32_t size;                      /* size once last arrives   */
+    uint32_t last_ms;                   /* time of last fragment    */
+    uint8_t map[ FRAG_MAP_BYTES ];      /* fragments received       */
+    uint8_t data[ FRAG_MAX_MESSAGE_SIZE ]; /* reassembly buffer     */
+    } frag_entry;
+
+typedef struct                          /* fragmentation on one
+                                           message_ctx              */
+    {
+    message_ctx *ctx;                   /* context sent and taken on */
+    frag_entry table[ FRAG_TABLE_SIZE ];/* reassembly pool          */
+    frag_complete_cb complete_cb;       /* completed message hook   */
+    void *complete_arg;                 /* passed to complete_cb    */
+    uint32_t current_ms;                /* time of last frag_poll   */
+    uint8_t next_id;                    /* id of next sent message  */
+    frag_stats stats;                   /* reassembly counters      */
+    } frag_ctx;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_frag.c
+--------------------------------------------------------------------*/
+void frag_init
+    (
+    frag_complete_cb callback,          /* completed message hook   */
+    void *arg                           /* passed to callback       */
+    );
+
+lora_errors frag_send
+    (
+    location destination,               /* destination              */
+    const uint8_t data[],               /* data to send             */
+    uint32_t size                       /* size of data[]           */
+    );
+
+void frag_poll
+    (
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+void frag_get_stats
+    (
+    frag_stats *stats                   /* pointer to store stats   */
+    );
+
+/*--------------------------------------------------------------------
+msg_frag.c -- context variants, the calls above run on the default
+message_ctx
+--------------------------------------------------------------------*/
+void frag_init_ctx
+    (
+    frag_ctx *frag,                     /* fragmentation state      */
+    message_ctx *ctx,                   /* initialized context      */
+    frag_complete_cb callback,          /* completed message hook   */
+    void *arg                           /* passed to callback       */
+    );
+
+lora_errors frag_send_ctx
+    (
+    frag_ctx *frag,                     /* fragmentation state      */
+    location destination,               /* destination              */
+    const uint8_t data[],               /* data to send             */
+    uint32_t size                       /* size of data[]           */
+    );
+
+void frag_poll_ctx
+    (
+    frag_ctx *frag,                     /* fragmentation state      */
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+void frag_get_stats_ctx
+    (
+    frag_ctx *frag,                     /* fragmentation state      */
+    frag_stats *stats                   /* pointer to store stats   */
+    );
+
+#endif /* MSG_FRAG_H */
+/* msg_frag.h */
@@ -0,0 +1,663 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_rekey.c
+*
+*   DESCRIPTION:
+*       in-band key rotation. the key byte works as a key epoch: a
+*       rotation goes idle -> pending, where the next key is taken
+*       as the grace key, -> grace, where frames are sent under the
+*       next key and the old one is the grace key, -> idle. the
+*       module starting it resends the announce until every
+*       registered module has acked or the switch time comes.
+*       switch and grace times travel as time left, so no shared
+*       clock is needed. all state is in a rekey_ctx, so each
+*       message_ctx rotates its own key
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_rekey.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define TYPE_BYTE           ( 0 )       /* frame type index         */
+
+#define KEY_BYTE            ( 1 )       /* next key index           */
+
+#define SWITCH_BYTE         ( 2 )       /* ms to switch, 4 bytes    */
+
+#define GRACE_BYTE          ( 6 )       /* grace ms, 4 bytes        */
+
+#define ANNOUNCE_SIZE       ( 10 )      /* announce payload size    */
+
+#define ACK_SIZE            ( 2 )       /* ack payload size         */
+
+#define TYPE_ANNOUNCE       ( 0 )       /* next key and its times   */
+
+#define TYPE_ACK            ( 1 )       /* announce heard           */
+
+#define PHASE_IDLE          ( 0 )       /* one key in use           */
+
+#define PHASE_PENDING       ( 1 )       /* next key taken, not sent */
+
+#define PHASE_GRACE         ( 2 )       /* next key sent, old taken */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+static rekey_ctx default_rekey;         /* state behind the plain
+                                           calls                    */
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define read_u32( array, index )  \
+    ( ( ( uint32_t )( array )[ ( index ) ] << 24 ) | ( ( uint32_t )( array )[ ( index ) + 1 ] << 16 ) \
+    | ( ( uint32_t )( array )[ ( index ) + 2 ] << 8 ) | ( array )[ ( index ) + 3 ] )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       write_u32
+*
+*   DESCRIPTION:
+*       store value big endian at array[ index ]
+*
+*********************************************************************/
+static void write_u32
+    (
+    uint8_t array[],
+    uint8_t index,
+    uint32_t value
+    )
+{
+
+array[ index ]      = ( uint8_t )( value >> 24 );
+array[ index + 1 ]  = ( uint8_t )( value >> 16 );
+array[ index + 2 ]  = ( uint8_t )( value >> 8 );
+array[ index + 3 ]  = ( uint8_t )( value );
+
+} /* write_u32() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_rekey_frame
+*
+*   DESCRIPTION:
+*       send payload on MSG_PORT_REKEY
+*
+*********************************************************************/
+static lora_errors send_rekey_frame
+    (
+    rekey_ctx *rekey,
+    location destination,
+    const uint8_t payload[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* frame being sent         */
+msg_header msg;                         /* port header              */
+uint8_t frame_size;                     /* size of frame[]          */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( &msg, 0, sizeof( msg ) );
+msg.destination = destination;
+msg.port        = MSG_PORT_REKEY;
+
+frame_size = encode_message_header_ctx( rekey->ctx, &msg, payload, size, frame );
+if( frame_size == 0 )
+    {
+    return RX_ARRAY_SIZE_ERR;
+    }
+
+return send_frame_ctx( rekey->ctx, frame, frame_size );
+
+} /* send_rekey_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_announce
+*
+*   DESCRIPTION:
+*       broadcast the next key with the time left to the switch
+*
+*********************************************************************/
+static void send_announce
+    (
+    rekey_ctx *rekey
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t payload[ ANNOUNCE_SIZE ];       /* announce frame           */
+
+payload[ TYPE_BYTE ]    = TYPE_ANNOUNCE;
+payload[ KEY_BYTE ]     = rekey->next_key;
+write_u32( payload, SWITCH_BYTE, time_before( rekey->current_ms, rekey->switch_at ) ? rekey->switch_at - rekey->current_ms : 0 );
+write_u32( payload, GRACE_BYTE, rekey->grace_ms );
+
+if( send_rekey_frame( rekey, MSG_BROADCAST, payload, ANNOUNCE_SIZE ) == RX_NO_ERROR )
+    {
+    rekey->stats.announces_sent++;
+    }
+
+rekey->retry_at = rekey->current_ms + REKEY_RETRY_MS;
+
+} /* send_announce() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       unacked_modules
+*
+*   DESCRIPTION:
+*       registered modules, other than this one, that have not
+*       acked the announce
+*
+*********************************************************************/
+static uint32_t unacked_modules
+    (
+    rekey_ctx *rekey
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t count;                         /* modules not acked        */
+location module;                        /* iterator                 */
+
+count = 0;
+for( module = 0; module < MSG_MAX_MODULES; module++ )
+    {
+    if( module != rekey->ctx->module && module_registered_ctx( rekey->ctx, module )
+     && ! ( ( rekey->acked[ module / 32 ] >> ( module % 32 ) ) & 1 ) )
+        {
+        count++;
+        }
+    }
+
+return count;
+
+} /* unacked_modules() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       switch_key
+*
+*   DESCRIPTION:
+*       start sending under the next key, the old one becomes the
+*       grace key until the grace window is over
+*
+*********************************************************************/
+static void switch_key
+    (
+    rekey_ctx *rekey
+    )
+{
+
+if( rekey->initiator )
+    {
+    rekey->stats.unacked += unacked_modules( rekey );
+    }
+
+rotate_key_ctx( rekey->ctx, rekey->next_key );
+rekey->phase       = PHASE_GRACE;
+rekey->grace_end   = rekey->current_ms + rekey->grace_ms;
+rekey->stats.switched++;
+
+if( rekey->changed_cb != NULL )
+    {
+    rekey->changed_cb( rekey->next_key, rekey->changed_arg );
+    }
+
+} /* switch_key() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       receive_announce
+*
+*   DESCRIPTION:
+*       take the next key as a grace key and ack it. an announce
+*       heard again is acked again, its ack may have been lost
+*
+*********************************************************************/
+static void receive_announce
+    (
+    rekey_ctx *rekey,
+    location source,
+    const uint8_t payload[]
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t ack[ ACK_SIZE ];                /* ack frame                */
+
+/*----------------------------------------------------------
+A second rotation can not start over one in progress
+----------------------------------------------------------*/
+if( rekey->phase != PHASE_IDLE && payload[ KEY_BYTE ] != rekey->next_key )
+    {
+    rekey->stats.invalid++;
+    return;
+    }
+
+if( rekey->phase == PHASE_IDLE && payload[ KEY_BYTE ] != get_key_ctx( rekey->ctx ) )
+    {
+    rekey->phase       = PHASE_PENDING;
+    rekey->initiator   = false;
+    rekey->next_key    = payload[ KEY_BYTE ];
+    rekey->switch_at   = rekey->current_ms + read_u32( payload, SWITCH_BYTE );
+    rekey->grace_ms    = read_u32( payload, GRACE_BYTE );
+    set_grace_key_ctx( rekey->ctx, true, rekey->next_key );
+    }
+
+rekey->stats.announces_heard++;
+
+ack[ TYPE_BYTE ]    = TYPE_ACK;
+ack[ KEY_BYTE ]     = payload[ KEY_BYTE ];
+
+if( send_rekey_frame( rekey, source, ack, ACK_SIZE ) == RX_NO_ERROR )
+    {
+    rekey->stats.acks_sent++;
+    }
+
+} /* receive_announce() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       receive_ack
+*
+*   DESCRIPTION:
+*       mark source as having the next key
+*
+*********************************************************************/
+static void receive_ack
+    (
+    rekey_ctx *rekey,
+    location source,
+    const uint8_t payload[]
+    )
+{
+
+if( ! rekey->initiator || rekey->phase == PHASE_IDLE || payload[ KEY_BYTE ] != rekey->next_key || source >= MSG_MAX_MODULES )
+    {
+    rekey->stats.invalid++;
+    return;
+    }
+
+rekey->acked[ source / 32 ] |= ( uint32_t ) 1 << ( source % 32 );
+rekey->stats.acks_heard++;
+
+} /* receive_ack() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_receive
+*
+*   DESCRIPTION:
+*       MSG_PORT_REKEY handler
+*
+*********************************************************************/
+static void rekey_receive
+    (
+    const msg_view *view,
+    void *arg
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+rekey_ctx *rekey;                       /* key rotation state       */
+
+rekey = ( rekey_ctx * ) arg;
+
+if( view->size == ANNOUNCE_SIZE && view->payload[ TYPE_BYTE ] == TYPE_ANNOUNCE )
+    {
+    receive_announce( rekey, view->source, view->payload );
+    }
+else if( view->size == ACK_SIZE && view->payload[ TYPE_BYTE ] == TYPE_ACK )
+    {
+    receive_ack( rekey, view->source, view->payload );
+    }
+else
+    {
+    rekey->stats.invalid++;
+    }
+
+} /* rekey_receive() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_init_ctx
+*
+*   DESCRIPTION:
+*       reset rotation state and take MSG_PORT_REKEY on ctx.
+*       callback runs from rekey_poll_ctx each time frames start
+*       going out under a new key, e.g. to keep the key over a
+*       reset
+*
+*********************************************************************/
+void rekey_init_ctx
+    (
+    rekey_ctx *rekey,
+    message_ctx *ctx,
+    rekey_changed_cb callback,
+    void *arg
+    )
+{
+
+memset( rekey, 0, sizeof( *rekey ) );
+rekey->ctx          = ctx;
+rekey->phase        = PHASE_IDLE;
+rekey->changed_cb   = callback;
+rekey->changed_arg  = arg;
+
+set_grace_key_ctx( ctx, false, 0 );
+set_port_handler_ctx( ctx, MSG_PORT_REKEY, rekey_receive, rekey );
+
+} /* rekey_init_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_start_ctx
+*
+*   DESCRIPTION:
+*       announce next to every module. frames go out under it
+*       REKEY_SWITCH_MS from now and the old key is taken for
+*       REKEY_GRACE_MS after that
+*
+*   RETURN:
+*       T/F rotation started y/n, false while one is in progress
+*
+*********************************************************************/
+bool rekey_start_ctx
+    (
+    rekey_ctx *rekey,
+    uint8_t next
+    )
+{
+
+if( rekey->phase != PHASE_IDLE || next == get_key_ctx( rekey->ctx ) )
+    {
+    return false;
+    }
+
+memset( rekey->acked, 0, sizeof( rekey->acked ) );
+rekey->phase       = PHASE_PENDING;
+rekey->initiator   = true;
+rekey->next_key    = next;
+rekey->switch_at   = rekey->current_ms + REKEY_SWITCH_MS;
+rekey->grace_ms    = REKEY_GRACE_MS;
+rekey->stats.started++;
+
+set_grace_key_ctx( rekey->ctx, true, rekey->next_key );
+send_announce( rekey );
+
+return true;
+
+} /* rekey_start_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_schedule_ctx
+*
+*   DESCRIPTION:
+*       rotate every period_ms from this module, each time to the
+*       key after the current one. run it on one module only, e.g.
+*       the gateway
+*
+*********************************************************************/
+void rekey_schedule_ctx
+    (
+    rekey_ctx *rekey,
+    uint32_t period_ms
+    )
+{
+
+rekey->period          = period_ms;
+rekey->scheduled_at    = rekey->current_ms + period_ms;
+
+} /* rekey_schedule_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_poll_ctx
+*
+*   DESCRIPTION:
+*       resend the announce, switch keys and end the grace window
+*       as their times come. call periodically
+*
+*********************************************************************/
+void rekey_poll_ctx
+    (
+    rekey_ctx *rekey,
+    uint32_t now_ms
+    )
+{
+
+rekey->current_ms = now_ms;
+
+if( rekey->phase == PHASE_PENDING )
+    {
+    if( ! time_before( now_ms, rekey->switch_at ) )
+        {
+        switch_key( rekey );
+        }
+    else if( rekey->initiator && ! time_before( now_ms, rekey->retry_at ) && unacked_modules( rekey ) > 0 )
+        {
+        send_announce( rekey );
+        }
+    }
+
+if( rekey->phase == PHASE_GRACE && ! time_before( now_ms, rekey->grace_end ) )
+    {
+    set_grace_key_ctx( rekey->ctx, false, 0 );
+    rekey->phase       = PHASE_IDLE;
+    rekey->initiator   = false;
+    }
+
+if( rekey->period != 0 && ! time_before( now_ms, rekey->scheduled_at ) )
+    {
+    if( rekey->phase == PHASE_IDLE )
+        {
+        ( void ) rekey_start_ctx( rekey, ( uint8_t )( get_key_ctx( rekey->ctx ) + 1 ) );
+        }
+    rekey->scheduled_at = now_ms + rekey->period;
+    }
+
+} /* rekey_poll_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_active_ctx
+*
+*   DESCRIPTION:
+*       a rotation is pending or in its grace window
+*
+*********************************************************************/
+bool rekey_active_ctx
+    (
+    rekey_ctx *rekey
+    )
+{
+
+return rekey->phase != PHASE_IDLE;
+
+} /* rekey_active_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_get_stats_ctx
+*
+*   DESCRIPTION:
+*       copy key rotation counters
+*
+*********************************************************************/
+void rekey_get_stats_ctx
+    (
+    rekey_ctx *rekey,
+    rekey_stats *stats
+    )
+{
+
+*stats = rekey->stats;
+
+} /* rekey_get_stats_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_init
+*
+*   DESCRIPTION:
+*       rekey_init_ctx on the default context
+*
+*********************************************************************/
+void rekey_init
+    (
+    rekey_changed_cb callback,
+    void *arg
+    )
+{
+
+rekey_init_ctx( &default_rekey, get_default_ctx(), callback, arg );
+
+} /* rekey_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_start
+*
+*   DESCRIPTION:
+*       rekey_start_ctx on the default context
+*
+*********************************************************************/
+bool rekey_start
+    (
+    uint8_t next
+    )
+{
+
+return rekey_start_ctx( &default_rekey, next );
+
+} /* rekey_start() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_schedule
+*
+*   DESCRIPTION:
+*       rekey_schedule_ctx on the default context
+*
+*********************************************************************/
+void rekey_schedule
+    (
+    uint32_t period_ms
+    )
+{
+
+rekey_schedule_ctx( &default_rekey, period_ms );
+
+} /* rekey_schedule() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_poll
+*
+*   DESCRIPTION:
+*       rekey_poll_ctx on the default context
+*
+*********************************************************************/
+void rekey_poll
+    (
+    uint32_t now_ms
+    )
+{
+
+rekey_poll_ctx( &default_rekey, now_ms );
+
+} /* rekey_poll() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_active
+*
+*   DESCRIPTION:
+*       rekey_active_ctx on the default context
+*
+*********************************************************************/
+bool rekey_active
+    (
+    void
+    )
+{
+
+return rekey_active_ctx( &default_rekey );
+
+} /* rekey_active() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       rekey_get_stats
+*
+*   DESCRIPTION:
+*       rekey_get_stats_ctx on the default context
+*
+*********************************************************************/
+void rekey_get_stats
+    (
+    rekey_stats *stats
+    )
+{
+
+rekey_get_stats_ctx( &default_rekey, stats );
+
+} /* rekey_get_stats() */
@@ -0,0 +1,182 @@
+/*********************************************************************
+*
+*   HEADER:
+*       key rotation for messageAPI. the module starting a rotation
+*       announces the next key on MSG_PORT_REKEY and every module
+*       acks it. from the announce on the next key is taken as well
+*       as the current one, at the switch time frames go out under
+*       the next key and the old key is still taken for a grace
+*       window, so no frame is lost to RX_KEY_ERR on the way. a
+*       rekey_ctx turns the key of one message_ctx, the plain calls
+*       use one on the default context
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_REKEY_H
+#define MSG_REKEY_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#ifndef REKEY_SWITCH_MS
+#define REKEY_SWITCH_MS     ( 10000 )   /* announce to switch, long
+                                           enough for every module
+                                           to hear and ack it       */
+#endif
+
+#ifndef REKEY_GRACE_MS
+#define REKEY_GRACE_MS      ( 30000 )   /* old key taken after the
+                                           switch, longer than any
+                                           frame is held in a queue */
+#endif
+
+#ifndef REKEY_RETRY_MS
+#define REKEY_RETRY_MS      ( 2000 )    /* announce resent while a
+                                           module has not acked     */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef void ( *rekey_changed_cb )      /* key switched             */
+    (
+    uint8_t key,                        /* key now sent with        */
+    void *arg                           /* rekey_init argument      */
+    );
+
+typedef struct                          /* key rotation counters    */
+    {
+    uint32_t started;                   /* rotations started here   */
+    uint32_t switched;                  /* keys switched            */
+    uint32_t announces_sent;            /* announce frames sent     */
+    uint32_t announces_heard;           /* announce frames taken    */
+    uint32_t acks_sent;                 /* ack frames sent          */
+    uint32_t acks_heard;                /* ack frames taken         */
+    uint32_t unacked;                   /* modules without an ack
+                                           at a switch              */
+    uint32_t invalid;                   /* bad or conflicting frame */
+    } rekey_stats;
+
+typedef struct                          /* key rotation on one
+                                           message_ctx              */
+    {
+    message_ctx *ctx;                   /* context whose key turns  */
+    uint8_t phase;                      /* rotation step            */
+    bool initiator;                     /* rotation started here    */
+    uint8_t next_key;                   /* key being rotated to     */
+    uint32_t switch_at;                 /* time to send next_key    */
+    uint32_t grace_ms;                  /* old key taken this long  */
+    uint32_t grace_end;                 /* time old key is dropped  */
+    uint32_t retry_at;                  /* time to announce again   */
+    uint32_t acked[ MSG_MODULE_WORDS ]; /* modules that acked       */
+    uint32_t period;                    /* scheduled rotation gap   */
+    uint32_t scheduled_at;              /* next scheduled rotation  */
+    rekey_changed_cb changed_cb;        /* key switched hook        */
+    void *changed_arg;                  /* passed to changed_cb     */
+    uint32_t current_ms;                /* time of last rekey_poll  */
+    rekey_stats stats;                  /* key rotation counters    */
+    } rekey_ctx;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_rekey.c
+--------------------------------------------------------------------*/
+void rekey_init
+    (
+    rekey_changed_cb callback,          /* key switched hook or NULL */
+    void *arg                           /* passed to callback       */
+    );
+
+bool rekey_start
+    (
+    uint8_t next_key                    /* key to rotate to         */
+    );
+
+void rekey_schedule
+    (
+    uint32_t period_ms                  /* time between rotations,
+                                           0 for none               */
+    );
+
+void rekey_poll
+    (
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+bool rekey_active
+    (
+    void
+    );
+
+void rekey_get_stats
+    (
+    rekey_stats *stats                  /* pointer to store stats   */
+    );
+
+/*--------------------------------------------------------------------
+msg_rekey.c -- context variants, the calls above run on the default
+message_ctx
+--------------------------------------------------------------------*/
+void rekey_init_ctx
+    (
+    rekey_ctx *rekey,                   /* key rotation state       */
+    message_ctx *ctx,                   /* initialized context      */
+    rekey_changed_cb callback,          /* key switched hook or NULL */
+    void *arg                           /* passed to callback       */
+    );
+
+bool rekey_start_ctx
+    (
+    rekey_ctx *rekey,                   /* key rotation state       */
+    uint8_t next_key                    /* key to rotate to         */
+    );
+
+void rekey_schedule_ctx
+    (
+    rekey_ctx *rekey,                   /* key rotation state       */
+    uint32_t period_ms                  /* time between rotations,
+                                           0 for none               */
+    );
+
+void rekey_poll_ctx
+    (
+    rekey_ctx *rekey,                   /* key rotation state       */
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+bool rekey_active_ctx
+    (
+    rekey_ctx *rekey                    /* key rotation state       */
+    );
+
+void rekey_get_stats_ctx
+    (
+    rekey_ctx *rekey,                   /* key rotation state       */
+    rekey_stats *stats                  /* pointer to store stats   */
+    );
+
+#endif /* MSG_REKEY_H */
+/* msg_rekey.h */
@@ -0,0 +1,497 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_sched.c
+*
+*   DESCRIPTION:
+*       duty cycle aware transmit scheduler. frames handed to the
+*       transport are queued in the class set by sched_set_priority
+*       and sent from sched_poll: higher classes first, earliest
+*       deadline first inside a class, and only while the token
+*       bucket holds the airtime the frame needs. frames still
+*       queued at their deadline are dropped rather than sent late
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_sched.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define LOW_DATA_RATE_US    ( 16000 )   /* symbol time needing low
+                                           data rate optimize       */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_queue
+*
+*   DESCRIPTION:
+*       queue frame in the current priority class, sent later by
+*       sched_poll
+*
+*   RETURN:
+*       RX_TIMEOUT when the class queue is full
+*
+*********************************************************************/
+static lora_errors sched_queue
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+sched_port *sched;                      /* scheduler state          */
+sched_frame *frame;                     /* slot to fill             */
+uint8_t priority;                       /* class of frame           */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+sched       = ( sched_port * ) port;
+priority    = sched->priority;
+
+if( sched->count[ priority ] >= SCHED_QUEUE_SIZE )
+    {
+    sched->stats.classes[ priority ].rejected++;
+    return RX_TIMEOUT;
+    }
+
+/*----------------------------------------------------------
+Copy frame, a deadline landing on 0 is moved so 0 still
+means none
+----------------------------------------------------------*/
+frame               = &sched->queue[ priority ][ sched->count[ priority ]++ ];
+frame->size         = size;
+frame->queued_ms    = sched->now_ms;
+frame->order        = sched->next_order++;
+frame->deadline_ms  = SCHED_NO_DEADLINE;
+memcpy( frame->data, message_array, size );
+
+if( sched->deadline_ms != SCHED_NO_DEADLINE )
+    {
+    frame->deadline_ms = sched->now_ms + sched->deadline_ms;
+    if( frame->deadline_ms == SCHED_NO_DEADLINE )
+        {
+        frame->deadline_ms = 1;
+        }
+    }
+
+sched->stats.classes[ priority ].queued++;
+
+return RX_NO_ERROR;
+
+} /* sched_queue() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       refill
+*
+*   DESCRIPTION:
+*       add the airtime earned since the last poll, duty_bp basis
+*       points of each ms is duty_bp / 10 us
+*
+*********************************************************************/
+static void refill
+    (
+    sched_port *sched,
+    uint32_t now_ms
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t earned;                        /* tenths of a us earned    */
+
+earned  = ( uint64_t )( now_ms - sched->now_ms ) * sched->duty_bp + sched->remainder;
+sched->remainder = ( uint32_t )( earned % 10 );
+earned  = sched->tokens_us + earned / 10;
+
+sched->tokens_us    = ( earned > sched->bucket_us ) ? sched->bucket_us : ( uint32_t ) earned;
+sched->now_ms       = now_ms;
+
+} /* refill() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       next_frame
+*
+*   DESCRIPTION:
+*       find the frame to send next, dropping any past deadline on
+*       the way. classes are strict priority, inside a class the
+*       earliest deadline goes first and frames without one go
+*       oldest first after those that have one
+*
+*   RETURN:
+*       T/F frame found y/n
+*
+*********************************************************************/
+static bool next_frame
+    (
+    sched_port *sched,
+    uint8_t *priority,
+    uint8_t *index
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+sched_frame *queue;                     /* class being searched     */
+sched_frame *best;                      /* frame picked so far      */
+uint8_t i;                              /* iterator                 */
+
+for( *priority = 0; *priority < SCHED_PRIORITY_COUNT; ( *priority )++ )
+    {
+    queue   = sched->queue[ *priority ];
+    best    = NULL;
+
+    for( i = 0; i < sched->count[ *priority ]; )
+        {
+        /*--------------------------------------------------
+        Expired, move last frame into the hole
+        --------------------------------------------------*/
+        if( queue[ i ].deadline_ms != SCHED_NO_DEADLINE
+         && ! time_before( sched->now_ms, queue[ i ].deadline_ms ) )
+            {
+            sched->stats.classes[ *priority ].expired++;
+            queue[ i ] = queue[ --sched->count[ *priority ] ];
+            best = NULL;
+            i = 0;
+            continue;
+            }
+
+        if( best == NULL
+         || ( queue[ i ].deadline_ms != SCHED_NO_DEADLINE
+           && ( best->deadline_ms == SCHED_NO_DEADLINE
+             || time_before( queue[ i ].deadline_ms, best->deadline_ms ) ) )
+         || ( queue[ i ].deadline_ms == best->deadline_ms
+           && time_before( queue[ i ].order, best->order ) ) )
+            {
+            best    = &queue[ i ];
+            *index  = i;
+            }
+        i++;
+        }
+
+    if( best != NULL )
+        {
+        return true;
+        }
+    }
+
+return false;
+
+} /* next_frame() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_transport
+*
+*   DESCRIPTION:
+*       return transport that schedules frames for inner. the token
+*       bucket starts full and holds SCHED_BUCKET_MS of earned
+*       airtime, or one largest frame if that is more. frames go
+*       to SCHED_PRIORITY_NORMAL until sched_set_priority. a duty_bp
+*       of 0 takes SCHED_DUTY_CYCLE_BP
+*
+*********************************************************************/
+msg_transport sched_transport
+    (
+    sched_port *port,
+    const msg_transport *inner,
+    const sched_radio *radio,
+    uint16_t duty_bp
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+uint32_t largest;                       /* airtime of biggest frame */
+
+/*----------------------------------------------------------
+Reset scheduler
+----------------------------------------------------------*/
+memset( port, 0, sizeof( *port ) );
+port->inner     = *inner;
+port->radio     = *radio;
+port->duty_bp   = ( duty_bp != 0 ) ? duty_bp : SCHED_DUTY_CYCLE_BP;
+port->priority  = SCHED_PRIORITY_NORMAL;
+port->bucket_us = ( uint32_t )( ( uint64_t ) SCHED_BUCKET_MS * port->duty_bp / 10 );
+
+largest = sched_airtime_us( radio, MAX_LORA_MSG_SIZE );
+if( port->bucket_us < largest )
+    {
+    port->bucket_us = largest;
+    }
+port->tokens_us = port->bucket_us;
+
+transport = forward_transport( port );
+transport.send      = sched_queue;
+
+return transport;
+
+} /* sched_transport() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_set_priority
+*
+*   DESCRIPTION:
+*       choose class and deadline for the frames sent from here on.
+*       deadline_ms counts from the last sched_poll time
+*
+*********************************************************************/
+void sched_set_priority
+    (
+    sched_port *port,
+    uint8_t priority,
+    uint32_t deadline_ms
+    )
+{
+
+port->priority      = ( priority < SCHED_PRIORITY_COUNT ) ? priority : SCHED_PRIORITY_BULK;
+port->deadline_ms   = deadline_ms;
+
+} /* sched_set_priority() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_send_message_ctx
+*
+*   DESCRIPTION:
+*       send_message_ctx in the given class, port must be the
+*       transport of ctx
+*
+*********************************************************************/
+lora_errors sched_send_message_ctx
+    (
+    message_ctx *ctx,
+    sched_port *port,
+    tx_message message,
+    uint8_t priority,
+    uint32_t deadline_ms
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+lora_errors errors;
+uint8_t saved_priority;
+uint32_t saved_deadline;
+
+saved_priority  = port->priority;
+saved_deadline  = port->deadline_ms;
+
+sched_set_priority( port, priority, deadline_ms );
+errors = send_message_ctx( ctx, message );
+
+port->priority      = saved_priority;
+port->deadline_ms   = saved_deadline;
+
+return errors;
+
+} /* sched_send_message_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_send_message
+*
+*   DESCRIPTION:
+*       sched_send_message_ctx on the default context
+*
+*********************************************************************/
+lora_errors sched_send_message
+    (
+    sched_port *port,
+    tx_message message,
+    uint8_t priority,
+    uint32_t deadline_ms
+    )
+{
+
+return sched_send_message_ctx( get_default_ctx(), port, message, priority, deadline_ms );
+
+} /* sched_send_message() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_poll
+*
+*   DESCRIPTION:
+*       earn airtime, drop expired frames and send queued frames
+*       while the bucket covers them. a frame that does not fit
+*       holds back everything behind it so lower classes cannot
+*       starve it. call periodically and after queueing
+*
+*********************************************************************/
+void sched_poll
+    (
+    sched_port *port,
+    uint32_t now_ms
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+sched_frame *frame;                     /* frame being sent         */
+sched_class_stats *counts;              /* its class counters       */
+uint32_t airtime;                       /* airtime of frame         */
+uint32_t waited;                        /* time frame was queued    */
+uint8_t priority;                       /* class of frame           */
+uint8_t index;                          /* frame within class       */
+
+refill( port, now_ms );
+
+while( next_frame( port, &priority, &index ) )
+    {
+    frame   = &port->queue[ priority ][ index ];
+    counts  = &port->stats.classes[ priority ];
+    airtime = sched_airtime_us( &port->radio, frame->size );
+
+    if( airtime > port->tokens_us )
+        {
+        break;
+        }
+
+    /*------------------------------------------------------
+    Send and charge the bucket, a failed send still used
+    the channel
+    ------------------------------------------------------*/
+    port->tokens_us -= airtime;
+    port->stats.airtime_us += airtime;
+
+    if( port->inner.send( port->inner.port, frame->data, frame->size ) == RX_NO_ERROR )
+        {
+        counts->sent++;
+        }
+    else
+        {
+        port->stats.send_errors++;
+        }
+    ( void ) port->inner.rx_mode( port->inner.port );
+
+    waited = now_ms - frame->queued_ms;
+    counts->queue_ms_total += waited;
+    if( waited > counts->queue_ms_max )
+        {
+        counts->queue_ms_max = waited;
+        }
+
+    *frame = port->queue[ priority ][ --port->count[ priority ] ];
+    }
+
+} /* sched_poll() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_airtime_us
+*
+*   DESCRIPTION:
+*       LoRa time on air of a frame, from the SX127x datasheet:
+*       preamble of n + 4.25 symbols and 8 + ceil( ( 8 PL - 4 SF +
+*       28 + 16 CRC - 20 IH ) / ( 4 ( SF - 2 DE ) ) ) ( CR + 4 )
+*       payload symbols, each symbol 2^SF / BW long. low data rate
+*       optimize (DE) is taken as on for symbols of 16 ms or more
+*
+*********************************************************************/
+uint32_t sched_airtime_us
+    (
+    const sched_radio *radio,
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint64_t chips;                         /* 2^SF                     */
+int32_t numerator;                      /* payload bits to code     */
+int32_t denominator;                    /* bits per symbol group    */
+uint32_t symbols;                       /* payload symbols          */
+uint32_t low_rate;                      /* DE                       */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+chips       = ( uint64_t ) 1 << radio->spreading_factor;
+low_rate    = ( chips * 1000000 / radio->bandwidth_hz >= LOW_DATA_RATE_US ) ? 1 : 0;
+numerator   = 8 * size - 4 * radio->spreading_factor + 28
+            + ( radio->crc_on ? 16 : 0 ) - ( radio->implicit_header ? 20 : 0 );
+denominator = 4 * ( radio->spreading_factor - 2 * low_rate );
+symbols     = 8;
+
+if( numerator > 0 )
+    {
+    symbols += ( uint32_t )( ( numerator + denominator - 1 ) / denominator ) * ( radio->coding_rate + 4 );
+    }
+
+/*----------------------------------------------------------
+Quarter symbols keep the 4.25 preamble symbols exact
+----------------------------------------------------------*/
+return ( uint32_t )( ( ( uint64_t )( radio->preamble_length + symbols ) * 4 + 17 ) * chips * 1000000
+                     / ( 4 * ( uint64_t ) radio->bandwidth_hz ) );
+
+} /* sched_airtime_us() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       sched_get_stats
+*
+*   DESCRIPTION:
+*       copy scheduler counters
+*
+*********************************************************************/
+void sched_get_stats
+    (
+    sched_port *port,
+    sched_stats *stats
+    )
+{
+
+*stats              = port->stats;
+stats->tokens_us    = port->tokens_us;
+
+} /* sched_get_stats() */
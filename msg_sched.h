@@ -0,0 +1,177 @@
+/*********************************************************************
+*
+*   HEADER:
+*       duty cycle aware transmit scheduler. a msg_transport that
+*       sits in front of another one and queues every frame in a
+*       priority class. sched_poll sends frames while a token bucket
+*       of airtime, refilled at the regional duty cycle, allows it
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_SCHED_H
+#define MSG_SCHED_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define SCHED_PRIORITY_ALARM    ( 0 )   /* sent before anything else */
+
+#define SCHED_PRIORITY_NORMAL   ( 1 )   /* default class            */
+
+#define SCHED_PRIORITY_BULK     ( 2 )   /* telemetry, sent last     */
+
+#define SCHED_PRIORITY_COUNT    ( 3 )   /* priority classes         */
+
+#define SCHED_NO_DEADLINE       ( 0 )   /* frame never expires      */
+
+#ifndef SCHED_QUEUE_SIZE
+#define SCHED_QUEUE_SIZE    ( 8 )       /* frames held per class    */
+#endif
+
+#ifndef SCHED_DUTY_CYCLE_BP
+#define SCHED_DUTY_CYCLE_BP ( 100 )     /* airtime share in basis
+                                           points, 100 = 1 %        */
+#endif
+
+#ifndef SCHED_BUCKET_MS
+#define SCHED_BUCKET_MS     ( 60000 )   /* wall time whose airtime
+                                           may be spent in one go   */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* settings for airtime     */
+    {
+    uint8_t spreading_factor;           /* 6 to 12                  */
+    uint32_t bandwidth_hz;              /* 7800 to 500000           */
+    uint8_t coding_rate;                /* 1 to 4 for 4/5 to 4/8    */
+    uint16_t preamble_length;           /* programmed symbols       */
+    bool crc_on;                        /* payload crc enabled      */
+    bool implicit_header;               /* no explicit lora header  */
+    } sched_radio;
+
+typedef struct                          /* queued frame             */
+    {
+    uint8_t size;                       /* size of data[]           */
+    uint32_t queued_ms;                 /* time queued              */
+    uint32_t order;                     /* queue order for ties     */
+    uint32_t deadline_ms;               /* drop after, 0 for none   */
+    uint8_t data[ MAX_LORA_MSG_SIZE ];  /* raw frame                */
+    } sched_frame;
+
+typedef struct                          /* per class counters       */
+    {
+    uint32_t queued;                    /* frames accepted          */
+    uint32_t sent;                      /* frames sent              */
+    uint32_t expired;                   /* dropped at deadline      */
+    uint32_t rejected;                  /* turned away, queue full  */
+    uint32_t queue_ms_total;            /* sum of time queued       */
+    uint32_t queue_ms_max;              /* longest time queued      */
+    } sched_class_stats;
+
+typedef struct                          /* scheduler counters       */
+    {
+    sched_class_stats classes[ SCHED_PRIORITY_COUNT ];
+    uint64_t airtime_us;                /* airtime used             */
+    uint32_t tokens_us;                 /* airtime available now    */
+    uint32_t send_errors;               /* inner transport failures */
+    } sched_stats;
+
+typedef struct                          /* scheduler transport      */
+    {
+    msg_transport inner;                /* radio frames go out on   */
+    sched_radio radio;                  /* for airtime              */
+    uint16_t duty_bp;                   /* airtime share            */
+    uint32_t bucket_us;                 /* token bucket depth       */
+    uint32_t tokens_us;                 /* airtime available        */
+    uint32_t remainder;                 /* refill below 1 us        */
+    uint32_t now_ms;                    /* time of last sched_poll  */
+    uint32_t next_order;                /* order of next frame      */
+    uint8_t priority;                   /* class of next frames     */
+    uint32_t deadline_ms;               /* relative deadline of next
+                                           frames, 0 for none       */
+    uint8_t count[ SCHED_PRIORITY_COUNT ]; /* frames queued         */
+    sched_frame queue[ SCHED_PRIORITY_COUNT ][ SCHED_QUEUE_SIZE ];
+    sched_stats stats;                  /* counters                 */
+    } sched_port;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_sched.c
+--------------------------------------------------------------------*/
+msg_transport sched_transport
+    (
+    sched_port *port,                   /* scheduler state          */
+    const msg_transport *inner,         /* radio to send on         */
+    const sched_radio *radio,           /* radio settings           */
+    uint16_t duty_bp                    /* 100 = 1 %, 0 for default */
+    );
+
+void sched_set_priority
+    (
+    sched_port *port,                   /* scheduler state          */
+    uint8_t priority,                   /* class of next frames     */
+    uint32_t deadline_ms                /* relative, or no deadline */
+    );
+
+lora_errors sched_send_message
+    (
+    sched_port *port,                   /* scheduler state          */
+    tx_message message,                 /* message to queue         */
+    uint8_t priority,                   /* priority class           */
+    uint32_t deadline_ms                /* relative, or no deadline */
+    );
+
+lora_errors sched_send_message_ctx
+    (
+    message_ctx *ctx,                   /* context on this transport */
+    sched_port *port,                   /* scheduler state          */
+    tx_message message,                 /* message to queue         */
+    uint8_t priority,                   /* priority class           */
+    uint32_t deadline_ms                /* relative, or no deadline */
+    );
+
+void sched_poll
+    (
+    sched_port *port,                   /* scheduler state          */
+    uint32_t now_ms                     /* current time in ms       */
+    );
+
+uint32_t sched_airtime_us
+    (
+    const sched_radio *radio,           /* radio settings           */
+    uint8_t size                        /* frame size in bytes      */
+    );
+
+void sched_get_stats
+    (
+    sched_port *port,                   /* scheduler state          */
+    sched_stats *stats                  /* pointer to store stats   */
+    );
+
+#endif /* MSG_SCHED_H */
+/* msg_sched.h */
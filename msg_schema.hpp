@@ -0,0 +1,699 @@
+/*********************************************************************
+*
+*   HEADER:
+*       typed message schemas for C++ users of messageAPI. a message
+*       is a struct whose schema names a one byte message id and
+*       the bit width of each member sent. pack and unpack are
+*       generated from the schema at compile time: every offset,
+*       shift and mask is a constant, so the code is straight line
+*       with no branches or loops, and a message that does not fit
+*       tx_message is a compile error. a dispatcher routes received
+*       messages to a handler through a 256 entry table indexed by
+*       the id byte
+*
+*           struct motor_cmd
+*               {
+*               uint16_t speed;
+*               int8_t   angle;
+*               bool     brake;
+*
+*               using schema = msg::schema< 3,
+*                   msg::field< &motor_cmd::speed, 12 >,
+*                   msg::field< &motor_cmd::angle, 7 >,
+*                   msg::field< &motor_cmd::brake, 1 > >;
+*               };
+*
+*           msg::send( motor_cmd{ 1500, -20, false }, TIVA_MODULE );
+*
+*       data layout: byte 0 is the id, then the fields in schema
+*       order, each packed least significant bit first from the
+*       lowest free bit. a value wider than its field is cut to
+*       its low bits, signed fields are sign extended on unpack.
+*       needs C++17
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_SCHEMA_HPP
+#define MSG_SCHEMA_HPP
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+extern "C"
+    {
+    #include "messageAPI.h"
+    }
+
+namespace msg
+{
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+constexpr std::size_t ID_SIZE       = 1;    /* id byte before fields */
+
+constexpr std::size_t ID_COUNT      = 256;  /* dispatch table size  */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+namespace detail
+{
+
+template< typename M >
+struct member_traits;                       /* splits T C::*        */
+
+template< typename C, typename T >
+struct member_traits< T C::* >
+    {
+    using owner = C;                        /* message struct       */
+    using value = T;                        /* member type          */
+    };
+
+template< typename T, bool = std::is_enum< T >::value >
+struct raw_type                             /* integer carried      */
+    {
+    using type = T;
+    };
+
+template< typename T >
+struct raw_type< T, true >
+    {
+    using type = typename std::underlying_type< T >::type;
+    };
+
+} /* namespace detail */
+
+template< auto Member, unsigned Bits >
+struct field                                /* one member sent      */
+    {
+    using owner = typename detail::member_traits< decltype( Member ) >::owner;
+    using value_type = typename detail::member_traits< decltype( Member ) >::value;
+    using raw_type = typename detail::raw_type< value_type >::type;
+
+    static constexpr auto member = Member;  /* member to send       */
+    static constexpr unsigned bits = Bits;  /* bits on the air      */
+    static constexpr bool is_signed = std::is_signed< raw_type >::value;
+
+    static_assert( std::is_integral< raw_type >::value,
+                   "schema fields must be integers, bools or enums" );
+    static_assert( Bits >= 1 && Bits <= 8 * sizeof( raw_type ) && Bits <= 64,
+                   "field width must be 1 to the bits of its type" );
+    static_assert( ! std::is_same< raw_type, bool >::value || Bits == 1,
+                   "bool fields are 1 bit wide" );
+    };
+
+template< std::uint8_t Id, typename... Fields >
+struct schema                               /* message layout       */
+    {
+    static constexpr std::uint8_t id = Id;  /* first data byte      */
+    static constexpr std::size_t bits = ( std::size_t( 0 ) + ... + Fields::bits );
+    static constexpr std::size_t size = ID_SIZE + ( bits + 7 ) / 8;
+                                            /* data bytes sent      */
+    static constexpr std::array< unsigned, sizeof...( Fields ) + 1 > widths = { Fields::bits..., 0u };
+
+    static_assert( sizeof...( Fields ) > 0, "a schema needs at least one field" );
+    static_assert( size <= MAX_MSG_LENGTH,
+                   "message does not fit tx_message, raise MAX_MSG_LENGTH (up to MAX_MSG_LENGTH_V2)" );
+    };
+
+template< typename T >
+using schema_of = typename T::schema;       /* T's schema           */
+
+namespace detail
+{
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       bit_offset
+*
+*   DESCRIPTION:
+*       first bit of field index, counted from the byte after the id
+*
+*********************************************************************/
+template< typename Schema >
+constexpr unsigned bit_offset
+    (
+    std::size_t index
+    )
+{
+unsigned offset = 0;
+
+for( std::size_t i = 0; i < index; i++ )
+    {
+    offset += Schema::widths[ i ];
+    }
+
+return offset;
+
+} /* bit_offset() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       low_mask
+*
+*   DESCRIPTION:
+*       Bits low bits set
+*
+*********************************************************************/
+template< unsigned Bits >
+constexpr std::uint64_t low_mask
+    (
+    void
+    )
+{
+
+return ( Bits >= 64 ) ? ~std::uint64_t( 0 ) : ( std::uint64_t( 1 ) << ( Bits % 64 ) ) - 1;
+
+} /* low_mask() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       put_byte
+*
+*   DESCRIPTION:
+*       or byte K of a value that starts Shift bits into its first
+*       byte
+*
+*********************************************************************/
+template< unsigned Shift, std::size_t K >
+constexpr std::uint8_t put_byte
+    (
+    std::uint64_t value
+    )
+{
+
+if constexpr( K == 0 )
+    {
+    return std::uint8_t( value << Shift );
+    }
+else
+    {
+    return std::uint8_t( value >> ( 8 * K - Shift ) );
+    }
+
+} /* put_byte() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       get_byte
+*
+*   DESCRIPTION:
+*       byte K of a field moved back to its place in the value
+*
+*********************************************************************/
+template< unsigned Shift, std::size_t K >
+constexpr std::uint64_t get_byte
+    (
+    std::uint8_t byte
+    )
+{
+
+if constexpr( K == 0 )
+    {
+    return std::uint64_t( byte ) >> Shift;
+    }
+else
+    {
+    return std::uint64_t( byte ) << ( 8 * K - Shift );
+    }
+
+} /* get_byte() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       put_bits / get_bits
+*
+*   DESCRIPTION:
+*       store or load Bits bits at bit Offset of data. each touches
+*       a constant run of at most 9 bytes
+*
+*********************************************************************/
+template< unsigned Offset, unsigned Bits, std::size_t... K >
+inline void put_bits
+    (
+    std::uint8_t *data,
+    std::uint64_t value,
+    std::index_sequence< K... >
+    )
+{
+value &= low_mask< Bits >();
+( ( data[ Offset / 8 + K ] |= put_byte< Offset % 8, K >( value ) ), ... );
+
+} /* put_bits() */
+
+template< unsigned Offset, unsigned Bits, std::size_t... K >
+inline std::uint64_t get_bits
+    (
+    const std::uint8_t *data,
+    std::index_sequence< K... >
+    )
+{
+
+return ( std::uint64_t( 0 ) | ... | get_byte< Offset % 8, K >( data[ Offset / 8 + K ] ) ) & low_mask< Bits >();
+
+} /* get_bits() */
+
+template< unsigned Offset, unsigned Bits >
+using byte_run = std::make_index_sequence< ( Offset % 8 + Bits + 7 ) / 8 >;
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       put_field / get_field
+*
+*   DESCRIPTION:
+*       one member of a message to or from its bits. signed values
+*       are sign extended with xor and subtract rather than a test
+*
+*********************************************************************/
+template< typename Field, unsigned Offset, typename T >
+inline void put_field
+    (
+    std::uint8_t *data,
+    const T &message
+    )
+{
+using raw = typename Field::raw_type;
+
+put_bits< Offset, Field::bits >( data, static_cast< std::uint64_t >( static_cast< raw >( message.*Field::member ) ),
+                                 byte_run< Offset, Field::bits >{} );
+
+} /* put_field() */
+
+template< typename Field, unsigned Offset, typename T >
+inline void get_field
+    (
+    const std::uint8_t *data,
+    T &message
+    )
+{
+using raw = typename Field::raw_type;
+constexpr std::uint64_t sign = std::uint64_t( Field::is_signed ) << ( Field::bits - 1 );
+
+std::uint64_t value = get_bits< Offset, Field::bits >( data, byte_run< Offset, Field::bits >{} );
+
+message.*Field::member = static_cast< typename Field::value_type >( static_cast< raw >( ( value ^ sign ) - sign ) );
+
+} /* get_field() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       pack_fields / unpack_fields
+*
+*   DESCRIPTION:
+*       every field of a schema, unrolled
+*
+*********************************************************************/
+template< typename T, std::uint8_t Id, typename... Fields, std::size_t... I >
+inline void pack_fields
+    (
+    std::uint8_t *data,
+    const T &message,
+    schema< Id, Fields... >,
+    std::index_sequence< I... >
+    )
+{
+
+( put_field< Fields, bit_offset< schema< Id, Fields... > >( I ) >( data, message ), ... );
+
+} /* pack_fields() */
+
+template< typename T, std::uint8_t Id, typename... Fields, std::size_t... I >
+inline void unpack_fields
+    (
+    const std::uint8_t *data,
+    T &message,
+    schema< Id, Fields... >,
+    std::index_sequence< I... >
+    )
+{
+
+( get_field< Fields, bit_offset< schema< Id, Fields... > >( I ) >( data, message ), ... );
+
+} /* unpack_fields() */
+
+template< typename Schema >
+struct field_count;                         /* fields in a schema   */
+
+template< std::uint8_t Id, typename... Fields >
+struct field_count< schema< Id, Fields... > >
+    {
+    static constexpr std::size_t value = sizeof...( Fields );
+    };
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       ids_unique
+*
+*   DESCRIPTION:
+*       check no two message types share an id
+*
+*********************************************************************/
+template< typename... Messages >
+constexpr bool ids_unique
+    (
+    void
+    )
+{
+constexpr std::uint8_t ids[] = { schema_of< Messages >::id... };
+
+for( std::size_t i = 0; i < sizeof...( Messages ); i++ )
+    {
+    for( std::size_t j = i + 1; j < sizeof...( Messages ); j++ )
+        {
+        if( ids[ i ] == ids[ j ] )
+            {
+            return false;
+            }
+        }
+    }
+
+return true;
+
+} /* ids_unique() */
+
+} /* namespace detail */
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       pack
+*
+*   DESCRIPTION:
+*       write message as id and fields to data, which must hold
+*       schema_of< T >::size bytes
+*
+*   RETURN:
+*       bytes written
+*
+*********************************************************************/
+template< typename T >
+inline std::size_t pack
+    (
+    const T &message,
+    std::uint8_t *data
+    )
+{
+using layout = schema_of< T >;
+
+std::memset( data, 0, layout::size );
+data[ 0 ] = layout::id;
+detail::pack_fields( data + ID_SIZE, message, layout{},
+                     std::make_index_sequence< detail::field_count< layout >::value >{} );
+
+return layout::size;
+
+} /* pack() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       unpack
+*
+*   DESCRIPTION:
+*       read the fields of a message. the id byte is not checked
+*
+*********************************************************************/
+template< typename T >
+inline void unpack
+    (
+    const std::uint8_t *data,
+    T &message
+    )
+{
+using layout = schema_of< T >;
+
+detail::unpack_fields( data + ID_SIZE, message, layout{},
+                       std::make_index_sequence< detail::field_count< layout >::value >{} );
+
+} /* unpack() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       unpack
+*
+*   DESCRIPTION:
+*       read a received message if it is a T
+*
+*   RETURN:
+*       T/F id and size match y/n
+*
+*********************************************************************/
+template< typename T >
+inline bool unpack
+    (
+    const rx_message &received,
+    T &message
+    )
+{
+
+if( received.size < schema_of< T >::size || received.message[ 0 ] != schema_of< T >::id )
+    {
+    return false;
+    }
+
+unpack( received.message, message );
+
+return true;
+
+} /* unpack() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send
+*
+*   DESCRIPTION:
+*       pack message into a tx_message and send it, on ctx or on
+*       the default context
+*
+*   RETURN:
+*       send_message result
+*
+*********************************************************************/
+template< typename T >
+inline lora_errors send
+    (
+    message_ctx *ctx,
+    const T &message,
+    location destination
+    )
+{
+tx_message tx;
+
+tx.destination  = destination;
+tx.size         = static_cast< std::uint8_t >( pack( message, tx.message ) );
+
+return send_message_ctx( ctx, tx );
+
+} /* send() */
+
+template< typename T >
+inline lora_errors send
+    (
+    const T &message,
+    location destination
+    )
+{
+tx_message tx;
+
+tx.destination  = destination;
+tx.size         = static_cast< std::uint8_t >( pack( message, tx.message ) );
+
+return send_message( tx );
+
+} /* send() */
+
+namespace detail
+{
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       deliver / unknown
+*
+*   DESCRIPTION:
+*       dispatch table entries. deliver unpacks a T and calls the
+*       handler, unknown takes ids no type has
+*
+*   RETURN:
+*       T/F message routed y/n
+*
+*********************************************************************/
+template< typename Handler, typename T >
+bool deliver
+    (
+    Handler &handler,
+    const rx_message &received
+    )
+{
+T message{};
+
+if( received.size < schema_of< T >::size )
+    {
+    return false;
+    }
+
+unpack( received.message, message );
+handler( static_cast< const T & >( message ), received );
+
+return true;
+
+} /* deliver() */
+
+template< typename Handler >
+bool unknown
+    (
+    Handler &,
+    const rx_message &
+    )
+{
+
+return false;
+
+} /* unknown() */
+
+template< typename Handler >
+using entry = bool ( * )( Handler &, const rx_message & );
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       make_table
+*
+*   DESCRIPTION:
+*       entry for every id, built at compile time
+*
+*********************************************************************/
+template< typename Handler, typename... Messages >
+constexpr std::array< entry< Handler >, ID_COUNT > make_table
+    (
+    void
+    )
+{
+std::array< entry< Handler >, ID_COUNT > entries{};
+
+for( std::size_t i = 0; i < ID_COUNT; i++ )
+    {
+    entries[ i ] = &unknown< Handler >;
+    }
+( ( entries[ schema_of< Messages >::id ] = &deliver< Handler, Messages > ), ... );
+
+return entries;
+
+} /* make_table() */
+
+template< typename Handler, typename... Messages >
+inline constexpr std::array< entry< Handler >, ID_COUNT > table = make_table< Handler, Messages... >();
+
+} /* namespace detail */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+template< typename Handler, typename... Messages >
+class dispatcher                            /* id to handler table  */
+    {
+    static_assert( detail::ids_unique< Messages... >(), "two message types share an id" );
+
+public:
+    /*----------------------------------------------------------
+    handler is called as handler( message, received ) with the
+    unpacked T and the rx_message it came in
+    ----------------------------------------------------------*/
+    explicit dispatcher
+        (
+        Handler &handler
+        )
+        : handler_( handler )
+    {
+    }
+
+    /*----------------------------------------------------------
+    route one message, one table load and an indirect call.
+    returns false for an empty message, an id no type has, or
+    a message too short for its type
+    ----------------------------------------------------------*/
+    bool operator()
+        (
+        const rx_message &received
+        ) const
+    {
+
+    return received.size >= ID_SIZE
+        && detail::table< Handler, Messages... >[ received.message[ 0 ] ]( handler_, received );
+
+    }
+
+private:
+    Handler &handler_;                      /* receives messages    */
+    };
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       dispatch
+*
+*   DESCRIPTION:
+*       read every waiting message on ctx and route it
+*
+*   RETURN:
+*       messages routed to a handler
+*
+*********************************************************************/
+template< typename Dispatcher >
+inline std::size_t dispatch
+    (
+    message_ctx *ctx,
+    const Dispatcher &route
+    )
+{
+rx_message received;
+lora_errors errors;
+std::size_t routed = 0;
+
+while( get_message_ctx( ctx, &received, &errors ) )
+    {
+    if( errors == RX_NO_ERROR && received.valid && route( received ) )
+        {
+        routed++;
+        }
+    }
+
+return routed;
+
+} /* dispatch() */
+
+} /* namespace msg */
+
+#endif /* MSG_SCHEMA_HPP */
+/* msg_schema.hpp */
@@ -0,0 +1,668 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_tdma.c
+*
+*   DESCRIPTION:
+*       slotted channel access. network time is split into
+*       superframes of TDMA_SLOT_COUNT slots of slot_ms. slot 0
+*       holds the gateway beacon, every other slot has one owner
+*       and only the owner sends in it, so frames never collide.
+*       a frame waits at most for the owner's next slot plus one
+*       superframe for each TDMA_FRAMES_PER_SLOT frames ahead of it
+*
+*       the beacon carries the gateway's time and the slot owners,
+*       stamped as it starts on air. a receiver adds the beacon's
+*       airtime, so its clock matches the gateway's rather than
+*       running one beacon behind. each beacon resets this
+*       module's idea of network time. the
+*       local clock's rate error is measured against the gateway
+*       over TDMA_DRIFT_WINDOW_MS, a ms clock being too coarse to
+*       see it over one superframe, and taken out between beacons
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_tdma.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define TIME_BYTE           ( 0 )       /* network time, 4 bytes    */
+
+#define SLOT_MS_BYTE        ( 4 )       /* slot length, 2 bytes     */
+
+#define SLOT_COUNT_BYTE     ( 6 )       /* slots in a superframe    */
+
+#define OWNERS_BYTE         ( 7 )       /* one owner per slot       */
+
+#define BEACON_SIZE         ( OWNERS_BYTE + TDMA_SLOT_COUNT )
+
+#define NO_SUPERFRAME       ( 0xFFFFFFFF ) /* nothing sent yet      */
+
+#define PPM                 ( 1000000 ) /* parts per million        */
+
+#if TDMA_SLOT_COUNT < 2 || TDMA_SLOT_COUNT > 0xFF
+#error TDMA_SLOT_COUNT must be 2 to 255
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+#define read_u16( array, index )  \
+    ( ( uint16_t )( ( ( array )[ ( index ) ] << 8 ) | ( array )[ ( index ) + 1 ] ) )
+
+#define read_u32( array, index )  \
+    ( ( ( uint32_t )read_u16( array, index ) << 16 ) | read_u16( array, ( index ) + 2 ) )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       network_time
+*
+*   DESCRIPTION:
+*       network time at local time now. the gateway's clock is the
+*       network clock, elsewhere time since the last beacon is
+*       scaled by the drift estimate
+*
+*********************************************************************/
+static uint32_t network_time
+    (
+    tdma_port *tdma,
+    uint32_t now
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t elapsed;                       /* local ms since beacon    */
+
+if( tdma->gateway )
+    {
+    return now;
+    }
+
+elapsed = now - tdma->sync_local;
+
+return tdma->sync_network + elapsed
+     + ( uint32_t )( int32_t )( ( int64_t ) elapsed * tdma->stats.drift_ppm / PPM );
+
+} /* network_time() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       send_beacon
+*
+*   DESCRIPTION:
+*       broadcast the gateway time and slot owners on MSG_PORT_TDMA
+*
+*********************************************************************/
+static void send_beacon
+    (
+    tdma_port *tdma,
+    uint32_t now
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t frame[ MAX_LORA_MSG_SIZE ];     /* frame being sent         */
+uint8_t *beacon;                        /* beacon payload in frame  */
+msg_header msg;                         /* port header              */
+uint8_t frame_size;                     /* size of frame[]          */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( &msg, 0, sizeof( msg ) );
+msg.destination = MSG_BROADCAST;
+msg.port        = MSG_PORT_TDMA;
+beacon          = &frame[ MSG_PORT_DATA_OFFSET ];
+
+beacon[ TIME_BYTE ]         = ( uint8_t )( now >> 24 );
+beacon[ TIME_BYTE + 1 ]     = ( uint8_t )( now >> 16 );
+beacon[ TIME_BYTE + 2 ]     = ( uint8_t )( now >> 8 );
+beacon[ TIME_BYTE + 3 ]     = ( uint8_t )( now );
+beacon[ SLOT_MS_BYTE ]      = ( uint8_t )( tdma->slot_ms >> 8 );
+beacon[ SLOT_MS_BYTE + 1 ]  = ( uint8_t )( tdma->slot_ms );
+beacon[ SLOT_COUNT_BYTE ]   = TDMA_SLOT_COUNT;
+memcpy( &beacon[ OWNERS_BYTE ], tdma->owners, TDMA_SLOT_COUNT );
+
+/*----------------------------------------------------------
+Beacon goes past the queue to the radio
+----------------------------------------------------------*/
+frame_size = encode_message_header_ctx( tdma->ctx, &msg, beacon, BEACON_SIZE, frame );
+if( frame_size == 0 )
+    {
+    tdma->stats.send_errors++;
+    return;
+    }
+
+tdma->beaconing = true;
+if( send_frame_ctx( tdma->ctx, frame, frame_size ) == RX_NO_ERROR )
+    {
+    tdma->stats.beacons_sent++;
+    }
+else
+    {
+    tdma->stats.send_errors++;
+    }
+tdma->beaconing = false;
+
+} /* send_beacon() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       beacon_delay
+*
+*   DESCRIPTION:
+*       ms from the beacon time stamp to the end of the beacon on
+*       air. the frame is the port header, the beacon and a crc,
+*       or the counter and tag when sealed
+*
+*********************************************************************/
+static uint32_t beacon_delay
+    (
+    tdma_port *tdma
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint8_t frame_size;                     /* beacon frame on air      */
+
+if( ! tdma->radio_valid )
+    {
+    return TDMA_BEACON_DELAY_MS;
+    }
+
+frame_size = MSG_PORT_DATA_OFFSET + BEACON_SIZE + 1;
+if( tdma->ctx != NULL && tdma->ctx->secure )
+    {
+    frame_size += MSG_SECURE_OVERHEAD;
+    }
+
+return ( sched_airtime_us( &tdma->radio, frame_size ) + 500 ) / 1000;
+
+} /* beacon_delay() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_receive
+*
+*   DESCRIPTION:
+*       MSG_PORT_TDMA handler. take the gateway's time and slot
+*       table and update the clock rate error
+*
+*********************************************************************/
+static void tdma_receive
+    (
+    const msg_view *view,
+    void *arg
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+tdma_port *tdma;                        /* slotted access state     */
+uint32_t now;                           /* local time of beacon     */
+uint32_t stamp;                         /* network time of beacon   */
+uint32_t elapsed;                       /* local ms since anchor    */
+int32_t sample;                         /* drift since anchor       */
+uint16_t slot_ms;                       /* announced slot length    */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+tdma = ( tdma_port * ) arg;
+now  = tdma->clock();
+
+if( tdma->gateway || view->source != TDMA_GATEWAY )
+    {
+    return;
+    }
+
+if( view->size != BEACON_SIZE
+ || view->payload[ SLOT_COUNT_BYTE ] != TDMA_SLOT_COUNT
+ || read_u16( view->payload, SLOT_MS_BYTE ) <= 2 * TDMA_GUARD_MS )
+    {
+    tdma->stats.beacons_invalid++;
+    return;
+    }
+
+stamp   = read_u32( view->payload, TIME_BYTE ) + beacon_delay( tdma );
+slot_ms = read_u16( view->payload, SLOT_MS_BYTE );
+
+/*----------------------------------------------------------
+Rate error since the anchor beacon. until the first window
+is over it is used as it is, after that each window is
+averaged with the estimate before it
+----------------------------------------------------------*/
+if( ! tdma->synced )
+    {
+    tdma->anchor_local      = now;
+    tdma->anchor_network    = stamp;
+    }
+else
+    {
+    tdma->stats.correction_ms = ( int32_t )( stamp - network_time( tdma, now ) );
+    elapsed = now - tdma->anchor_local;
+
+    if( elapsed > 0 )
+        {
+        sample = ( int32_t )( ( int64_t )( int32_t )( stamp - tdma->anchor_network - elapsed ) * PPM / elapsed );
+
+        if( ! tdma->drift_valid )
+            {
+            tdma->stats.drift_ppm = sample;
+            }
+
+        if( elapsed >= TDMA_DRIFT_WINDOW_MS )
+            {
+            if( tdma->drift_valid )
+                {
+                tdma->stats.drift_ppm += ( sample - tdma->stats.drift_ppm ) / 2;
+                }
+            tdma->drift_valid       = true;
+            tdma->anchor_local      = now;
+            tdma->anchor_network    = stamp;
+            }
+        }
+    }
+
+tdma->sync_local    = now;
+tdma->sync_network  = stamp;
+tdma->synced        = true;
+tdma->slot_ms       = slot_ms;
+memcpy( tdma->owners, &view->payload[ OWNERS_BYTE ], TDMA_SLOT_COUNT );
+tdma->stats.beacons_heard++;
+
+} /* tdma_receive() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_send
+*
+*   DESCRIPTION:
+*       hold frame for this module's next slot
+*
+*   RETURN:
+*       RX_TIMEOUT when the queue is full
+*
+*********************************************************************/
+static lora_errors tdma_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+tdma_port *tdma;                        /* slotted access state     */
+tdma_frame *frame;                      /* slot to fill             */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+tdma = ( tdma_port * ) port;
+
+if( tdma->beaconing )
+    {
+    return tdma->inner.send( tdma->inner.port, message_array, size );
+    }
+
+if( tdma->count >= TDMA_QUEUE_SIZE )
+    {
+    tdma->stats.rejected++;
+    return RX_TIMEOUT;
+    }
+
+frame = &tdma->queue[ ( tdma->head + tdma->count ) % TDMA_QUEUE_SIZE ];
+frame->size         = size;
+frame->queued_ms    = tdma->clock();
+memcpy( frame->data, message_array, size );
+tdma->count++;
+
+return RX_NO_ERROR;
+
+} /* tdma_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_transport
+*
+*   DESCRIPTION:
+*       return transport that holds frames for this module's slots.
+*       clock gives local time in ms. radio gives the beacon
+*       airtime, NULL takes TDMA_BEACON_DELAY_MS. slot_ms is used
+*       by the gateway, other modules take it from the beacons.
+*       slots are shared out over the build time modules until
+*       tdma_assign_slot changes them
+*
+*********************************************************************/
+msg_transport tdma_transport
+    (
+    tdma_port *port,
+    const msg_transport *inner,
+    const sched_radio *radio,
+    msg_clock clock,
+    uint16_t slot_ms
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+uint8_t i;                              /* iterator                 */
+
+/*----------------------------------------------------------
+Reset state
+----------------------------------------------------------*/
+memset( port, 0, sizeof( *port ) );
+port->inner             = *inner;
+port->clock             = clock;
+port->radio_valid       = ( radio != NULL );
+port->location          = INVALID_LOCATION;
+port->slot_ms           = slot_ms;
+port->beacon_superframe = NO_SUPERFRAME;
+port->last_superframe   = NO_SUPERFRAME;
+
+if( radio != NULL )
+    {
+    port->radio = *radio;
+    }
+
+port->owners[ TDMA_BEACON_SLOT ] = TDMA_GATEWAY;
+for( i = 1; i < TDMA_SLOT_COUNT; i++ )
+    {
+    port->owners[ i ] = ( location )( ( i - 1 ) % NUM_OF_MODULES );
+    }
+
+transport = forward_transport( port );
+transport.send      = tdma_send;
+
+return transport;
+
+} /* tdma_transport() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_start_ctx
+*
+*   DESCRIPTION:
+*       take MSG_PORT_TDMA on ctx, the context whose transport port
+*       is, call after init_message_ctx. the gateway is in sync
+*       straight away, others once a beacon is heard
+*
+*********************************************************************/
+void tdma_start_ctx
+    (
+    tdma_port *port,
+    message_ctx *ctx
+    )
+{
+
+port->ctx       = ctx;
+port->location  = ctx->module;
+port->gateway   = ( ctx->module == TDMA_GATEWAY );
+port->synced    = port->gateway;
+
+set_port_handler_ctx( ctx, MSG_PORT_TDMA, tdma_receive, port );
+
+} /* tdma_start_ctx() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_start
+*
+*   DESCRIPTION:
+*       tdma_start_ctx on the default context
+*
+*********************************************************************/
+void tdma_start
+    (
+    tdma_port *port
+    )
+{
+
+tdma_start_ctx( port, get_default_ctx() );
+
+} /* tdma_start() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_assign_slot
+*
+*   DESCRIPTION:
+*       give slot to owner, sent out with the next beacon. only
+*       has effect on the gateway
+*
+*   RETURN:
+*       T/F slot assigned y/n
+*
+*********************************************************************/
+bool tdma_assign_slot
+    (
+    tdma_port *port,
+    uint8_t slot,
+    location owner
+    )
+{
+
+if( slot == TDMA_BEACON_SLOT || slot >= TDMA_SLOT_COUNT )
+    {
+    return false;
+    }
+
+port->owners[ slot ] = owner;
+
+return true;
+
+} /* tdma_assign_slot() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_poll
+*
+*   DESCRIPTION:
+*       send the beacon at the start of a superframe on the gateway,
+*       and held frames while inside one of this module's slots
+*       clear of the guard times. call at least once per slot
+*
+*********************************************************************/
+void tdma_poll
+    (
+    tdma_port *port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+uint32_t now;                           /* local time               */
+uint32_t network;                       /* network time             */
+uint32_t superframe_ms;                 /* superframe length        */
+uint32_t superframe;                    /* superframe number        */
+uint32_t offset;                        /* ms into the slot         */
+uint8_t slot;                           /* current slot             */
+tdma_frame *frame;                      /* head frame               */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+now             = port->clock();
+superframe_ms   = ( uint32_t ) port->slot_ms * TDMA_SLOT_COUNT;
+
+if( ! port->synced || superframe_ms == 0 )
+    {
+    return;
+    }
+
+if( ! port->gateway && now - port->sync_local > TDMA_SYNC_LOSS * superframe_ms )
+    {
+    port->synced = false;
+    port->stats.sync_lost++;
+    return;
+    }
+
+network     = network_time( port, now );
+superframe  = network / superframe_ms;
+slot        = ( uint8_t )( ( network % superframe_ms ) / port->slot_ms );
+offset      = network % port->slot_ms;
+
+/*----------------------------------------------------------
+Beacon once per superframe
+----------------------------------------------------------*/
+if( slot == TDMA_BEACON_SLOT )
+    {
+    if( port->gateway && superframe != port->beacon_superframe )
+        {
+        port->beacon_superframe = superframe;
+        send_beacon( port, now );
+        ( void ) port->inner.rx_mode( port->inner.port );
+        }
+    return;
+    }
+
+if( port->owners[ slot ] != port->location
+ || offset < TDMA_GUARD_MS
+ || offset >= ( uint32_t )( port->slot_ms - TDMA_GUARD_MS ) )
+    {
+    return;
+    }
+
+if( superframe != port->last_superframe || slot != port->last_slot )
+    {
+    port->last_superframe   = superframe;
+    port->last_slot         = slot;
+    port->slot_sends        = 0;
+    }
+
+/*----------------------------------------------------------
+Send held frames in order
+----------------------------------------------------------*/
+while( port->count > 0 && port->slot_sends < TDMA_FRAMES_PER_SLOT )
+    {
+    frame = &port->queue[ port->head ];
+
+    if( port->inner.send( port->inner.port, frame->data, frame->size ) == RX_NO_ERROR )
+        {
+        port->stats.sent++;
+        }
+    else
+        {
+        port->stats.send_errors++;
+        }
+
+    if( now - frame->queued_ms > port->stats.wait_ms_max )
+        {
+        port->stats.wait_ms_max = now - frame->queued_ms;
+        }
+
+    port->head = ( uint8_t )( ( port->head + 1 ) % TDMA_QUEUE_SIZE );
+    port->count--;
+    port->slot_sends++;
+    ( void ) port->inner.rx_mode( port->inner.port );
+    }
+
+} /* tdma_poll() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_network_time
+*
+*   DESCRIPTION:
+*       current network time
+*
+*   RETURN:
+*       T/F in sync with the gateway y/n
+*
+*********************************************************************/
+bool tdma_network_time
+    (
+    tdma_port *port,
+    uint32_t *network_ms
+    )
+{
+
+*network_ms = network_time( port, port->clock() );
+
+return port->synced;
+
+} /* tdma_network_time() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_pending
+*
+*   DESCRIPTION:
+*       frames waiting for a slot
+*
+*********************************************************************/
+uint8_t tdma_pending
+    (
+    tdma_port *port
+    )
+{
+
+return port->count;
+
+} /* tdma_pending() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       tdma_get_stats
+*
+*   DESCRIPTION:
+*       copy slotted access counters
+*
+*********************************************************************/
+void tdma_get_stats
+    (
+    tdma_port *port,
+    tdma_stats *stats
+    )
+{
+
+*stats = port->stats;
+
+} /* tdma_get_stats() */
@@ -0,0 +1,193 @@
+/*********************************************************************
+*
+*   HEADER:
+*       slotted channel access for messageAPI. a msg_transport that
+*       holds every frame until one of this module's slots. the
+*       gateway broadcasts a beacon on MSG_PORT_TDMA each superframe
+*       with its time and the slot owners, other modules follow its
+*       clock and correct their drift from the beacons
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_TDMA_H
+#define MSG_TDMA_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "messageAPI.h"
+#include "msg_sched.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#define TDMA_BEACON_SLOT    ( 0 )       /* gateway beacon only      */
+
+#ifndef TDMA_GATEWAY
+#define TDMA_GATEWAY        ( RPI_MODULE ) /* sends the beacons     */
+#endif
+
+#ifndef TDMA_SLOT_COUNT
+#define TDMA_SLOT_COUNT     ( 16 )      /* slots in a superframe,
+                                           the same on every module */
+#endif
+
+#ifndef TDMA_QUEUE_SIZE
+#define TDMA_QUEUE_SIZE     ( 8 )       /* frames held for a slot   */
+#endif
+
+#ifndef TDMA_FRAMES_PER_SLOT
+#define TDMA_FRAMES_PER_SLOT ( 1 )      /* frames sent in one slot,
+                                           slot_ms must fit their
+                                           airtime and the guards   */
+#endif
+
+#ifndef TDMA_GUARD_MS
+#define TDMA_GUARD_MS       ( 10 )      /* no sending this close to
+                                           either end of a slot     */
+#endif
+
+#ifndef TDMA_BEACON_DELAY_MS
+#define TDMA_BEACON_DELAY_MS ( 0 )      /* added to the beacon time
+                                           stamp on receive when no
+                                           radio settings are given,
+                                           its airtime otherwise    */
+#endif
+
+#ifndef TDMA_DRIFT_WINDOW_MS
+#define TDMA_DRIFT_WINDOW_MS ( 60000 )  /* clock rate is measured
+                                           over this long           */
+#endif
+
+#ifndef TDMA_SYNC_LOSS
+#define TDMA_SYNC_LOSS      ( 4 )       /* superframes without a
+                                           beacon before sending
+                                           stops                    */
+#endif
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* held frame               */
+    {
+    uint8_t size;                       /* size of data[]           */
+    uint32_t queued_ms;                 /* local time queued        */
+    uint8_t data[ MAX_LORA_MSG_SIZE ];  /* raw frame                */
+    } tdma_frame;
+
+typedef struct                          /* slotted access counters  */
+    {
+    uint32_t sent;                      /* frames sent in a slot    */
+    uint32_t rejected;                  /* turned away, queue full  */
+    uint32_t send_errors;               /* failed sends and beacons */
+    uint32_t wait_ms_max;               /* longest wait for a slot  */
+    uint32_t beacons_sent;              /* gateway beacons          */
+    uint32_t beacons_heard;             /* beacons taken            */
+    uint32_t beacons_invalid;           /* bad beacon payload       */
+    uint32_t sync_lost;                 /* beacons missed too long  */
+    int32_t drift_ppm;                  /* local clock rate error   */
+    int32_t correction_ms;              /* last beacon time less the
+                                           time this module had     */
+    } tdma_stats;
+
+typedef struct                          /* slotted access state     */
+    {
+    msg_transport inner;                /* radio frames go out on   */
+    msg_clock clock;                    /* local ms clock           */
+    sched_radio radio;                  /* for beacon airtime       */
+    bool radio_valid;                   /* radio settings given     */
+    message_ctx *ctx;                   /* context beacons go on    */
+    location location;                  /* this module              */
+    bool gateway;                       /* sends the beacons        */
+    bool synced;                        /* network time known       */
+    bool beaconing;                     /* beacon passes the queue  */
+    uint16_t slot_ms;                   /* slot length              */
+    location owners[ TDMA_SLOT_COUNT ]; /* module sending in slot   */
+    uint32_t sync_local;                /* local time of last beacon */
+    uint32_t sync_network;              /* network time it carried  */
+    uint32_t anchor_local;              /* start of drift window    */
+    uint32_t anchor_network;            /* network time at start    */
+    bool drift_valid;                   /* a window has completed   */
+    uint32_t beacon_superframe;         /* superframe of last beacon */
+    uint32_t last_superframe;           /* superframe of last_slot  */
+    uint8_t last_slot;                  /* slot last sent in        */
+    uint8_t slot_sends;                 /* frames sent in last_slot */
+    uint8_t head;                       /* oldest held frame        */
+    uint8_t count;                      /* frames held              */
+    tdma_frame queue[ TDMA_QUEUE_SIZE ];/* frames held              */
+    tdma_stats stats;                   /* counters                 */
+    } tdma_port;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_tdma.c
+--------------------------------------------------------------------*/
+msg_transport tdma_transport
+    (
+    tdma_port *port,                    /* slotted access state     */
+    const msg_transport *inner,         /* radio to send on         */
+    const sched_radio *radio,           /* radio settings, or NULL  */
+    msg_clock clock,                    /* local ms clock           */
+    uint16_t slot_ms                    /* slot length, gateway only */
+    );
+
+void tdma_start
+    (
+    tdma_port *port                     /* slotted access state     */
+    );
+
+void tdma_start_ctx
+    (
+    tdma_port *port,                    /* slotted access state     */
+    message_ctx *ctx                    /* context on this transport */
+    );
+
+bool tdma_assign_slot
+    (
+    tdma_port *port,                    /* slotted access state     */
+    uint8_t slot,                       /* 1 to TDMA_SLOT_COUNT - 1 */
+    location owner                      /* module, or MODULE_NONE   */
+    );
+
+void tdma_poll
+    (
+    tdma_port *port                     /* slotted access state     */
+    );
+
+bool tdma_network_time
+    (
+    tdma_port *port,                    /* slotted access state     */
+    uint32_t *network_ms                /* pointer to store time    */
+    );
+
+uint8_t tdma_pending
+    (
+    tdma_port *port                     /* slotted access state     */
+    );
+
+void tdma_get_stats
+    (
+    tdma_port *port,                    /* slotted access state     */
+    tdma_stats *stats                   /* pointer to store stats   */
+    );
+
+#endif /* MSG_TDMA_H */
+/* msg_tdma.h */
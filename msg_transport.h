@@ -0,0 +1,169 @@
+/*********************************************************************
+*
+*   HEADER:
+*       transport interface for messageAPI. messageAPI.c only talks to
+*       the radio through a msg_transport so the protocol can run on
+*       top of the LoRa driver, an in-memory loopback or a datagram
+*       socket.
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+#ifndef MSG_TRANSPORT_H
+#define MSG_TRANSPORT_H
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "LoRa/LoraAPI.h"
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+#ifndef MSG_USE_LORA_TRANSPORT
+#define MSG_USE_LORA_TRANSPORT  ( 1 )   /* default to LoRa backend  */
+#endif
+
+#define LOOPBACK_QUEUE_SIZE     ( 32 )  /* frames held by loopback  */
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+typedef struct                          /* transport backend        */
+    {
+    lora_errors ( *init )               /* bring up the backend     */
+        (
+        void *port,
+        lora_config config_data
+        );
+
+    lora_errors ( *send )               /* transmit one buffer      */
+        (
+        void *port,
+        uint8_t message_array[],
+        uint8_t size
+        );
+
+    bool ( *get )                       /* receive one buffer       */
+        (
+        void *port,
+        uint8_t message_array[],
+        uint8_t max_size,
+        uint8_t *size,
+        lora_errors *errors
+        );
+
+    bool ( *rx_mode )                   /* enter continuous rx      */
+        (
+        void *port
+        );
+
+    void *port;                         /* backend private state    */
+
+    int ( *wait_fd )                    /* descriptor readable when
+                                           a frame arrives, or -1.
+                                           NULL if the backend has
+                                           none                     */
+        (
+        void *port
+        );
+    } msg_transport;
+
+typedef struct                          /* loopback frame slot      */
+    {
+    uint8_t size;                       /* size of data[]           */
+    uint8_t data[ MAX_LORA_MSG_SIZE ];  /* raw frame                */
+    } loopback_frame;
+
+typedef struct loopback_port            /* in-memory loopback state */
+    {
+    struct loopback_port *peer;         /* port that receives tx    */
+    uint16_t head;                      /* next slot to read        */
+    uint16_t count;                     /* slots in use             */
+    uint32_t dropped;                   /* tx dropped, queue full   */
+    loopback_frame queue[ LOOPBACK_QUEUE_SIZE ];
+    } loopback_port;
+
+typedef struct                          /* datagram socket state    */
+    {
+    int fd;                             /* socket descriptor        */
+    uint8_t peer_addr[ 128 ];           /* struct sockaddr storage  */
+    uint32_t peer_addr_len;             /* size of peer_addr        */
+    } socket_port;
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+/* a is earlier than b on a ms clock that wraps */
+#define time_before( a, b )     ( ( int32_t )( ( a ) - ( b ) ) < 0 )
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+/*--------------------------------------------------------------------
+msg_transport_forward.c
+--------------------------------------------------------------------*/
+msg_transport forward_transport
+    (
+    void *port                          /* decorator state, inner
+                                           msg_transport first      */
+    );
+
+/*--------------------------------------------------------------------
+msg_transport_lora.c
+--------------------------------------------------------------------*/
+msg_transport lora_transport
+    (
+    void
+    );
+
+/*--------------------------------------------------------------------
+msg_transport_loopback.c
+--------------------------------------------------------------------*/
+msg_transport loopback_transport
+    (
+    loopback_port *port,                /* port to bind             */
+    loopback_port *peer                 /* receiver, NULL for self  */
+    );
+
+/*--------------------------------------------------------------------
+msg_transport_socket.c
+--------------------------------------------------------------------*/
+bool socket_open_unix
+    (
+    socket_port *port,                  /* port to open             */
+    const char *local_path,             /* path to bind             */
+    const char *peer_path               /* path to send to          */
+    );
+
+bool socket_open_udp
+    (
+    socket_port *port,                  /* port to open             */
+    uint16_t local_port,                /* udp port to bind         */
+    const char *peer_ip,                /* dotted quad of peer      */
+    uint16_t peer_port                  /* udp port of peer         */
+    );
+
+void socket_close
+    (
+    socket_port *port                   /* port to close            */
+    );
+
+msg_transport socket_transport
+    (
+    socket_port *port                   /* opened port to bind      */
+    );
+
+#endif /* MSG_TRANSPORT_H */
+/* msg_transport.h */
@@ -0,0 +1,213 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_transport_forward.c
+*
+*   DESCRIPTION:
+*       pass-through msg_transport for decorators. every call is
+*       handed to the inner transport held at the start of the
+*       decorator's port, so a decorator only sets the calls it
+*       changes.
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_transport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       forward_init
+*
+*   DESCRIPTION:
+*       bring up the inner transport
+*
+*********************************************************************/
+static lora_errors forward_init
+    (
+    void *port,
+    lora_config config_data
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport *inner;
+
+inner = ( msg_transport * ) port;
+
+return inner->init( inner->port, config_data );
+
+} /* forward_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       forward_send
+*
+*   DESCRIPTION:
+*       transmit on the inner transport
+*
+*********************************************************************/
+static lora_errors forward_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport *inner;
+
+inner = ( msg_transport * ) port;
+
+return inner->send( inner->port, message_array, size );
+
+} /* forward_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       forward_get
+*
+*   DESCRIPTION:
+*       receive from the inner transport
+*
+*********************************************************************/
+static bool forward_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport *inner;
+
+inner = ( msg_transport * ) port;
+
+return inner->get( inner->port, message_array, max_size, size, errors );
+
+} /* forward_get() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       forward_rx_mode
+*
+*   DESCRIPTION:
+*       put inner transport back in receive mode
+*
+*********************************************************************/
+static bool forward_rx_mode
+    (
+    void *port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport *inner;
+
+inner = ( msg_transport * ) port;
+
+return inner->rx_mode( inner->port );
+
+} /* forward_rx_mode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       forward_wait_fd
+*
+*   DESCRIPTION:
+*       descriptor of the inner transport
+*
+*********************************************************************/
+static int forward_wait_fd
+    (
+    void *port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport *inner;
+
+inner = ( msg_transport * ) port;
+
+return ( inner->wait_fd != NULL ) ? inner->wait_fd( inner->port ) : -1;
+
+} /* forward_wait_fd() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       forward_transport
+*
+*   DESCRIPTION:
+*       return transport that passes every call to the msg_transport
+*       that port starts with. a decorator's port struct must hold
+*       its inner transport as the first member; the decorator then
+*       replaces only the calls it changes
+*
+*********************************************************************/
+msg_transport forward_transport
+    (
+    void *port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+
+transport.init      = forward_init;
+transport.send      = forward_send;
+transport.get       = forward_get;
+transport.rx_mode   = forward_rx_mode;
+transport.port      = port;
+transport.wait_fd   = forward_wait_fd;
+
+return transport;
+
+} /* forward_transport() */
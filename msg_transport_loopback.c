@@ -0,0 +1,250 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_transport_loopback.c
+*
+*   DESCRIPTION:
+*       in-memory msg_transport backend. frames sent on a port are
+*       queued on its peer (or itself) and handed back by get, so the
+*       protocol can be exercised on a host without a radio.
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_transport.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       loopback_init
+*
+*   DESCRIPTION:
+*       empty the frame queue, SPI config is unused
+*
+*********************************************************************/
+static lora_errors loopback_init
+    (
+    void *port,
+    lora_config config_data
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+loopback_port *loopback;
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+loopback = ( loopback_port * ) port;
+( void ) config_data;
+
+loopback->head      = 0;
+loopback->count     = 0;
+loopback->dropped   = 0;
+
+return RX_NO_ERROR;
+
+} /* loopback_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       loopback_send
+*
+*   DESCRIPTION:
+*       queue buffer on the peer port
+*
+*********************************************************************/
+static lora_errors loopback_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+loopback_port *peer;        /* port receiving the frame     */
+loopback_frame *slot;       /* slot to fill                 */
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+peer = ( ( loopback_port * ) port )->peer;
+
+/*----------------------------------------------------------
+Drop like a busy channel when full
+----------------------------------------------------------*/
+if( peer->count >= LOOPBACK_QUEUE_SIZE )
+    {
+    peer->dropped++;
+    return RX_NO_ERROR;
+    }
+
+/*----------------------------------------------------------
+Copy into next free slot
+----------------------------------------------------------*/
+slot = &peer->queue[ ( peer->head + peer->count ) % LOOPBACK_QUEUE_SIZE ];
+slot->size = size;
+memcpy( slot->data, message_array, size );
+peer->count++;
+
+return RX_NO_ERROR;
+
+} /* loopback_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       loopback_get
+*
+*   DESCRIPTION:
+*       pop oldest queued frame
+*
+*   RETURN:
+*       T/F frame received y/n
+*
+*********************************************************************/
+static bool loopback_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+loopback_port *loopback;
+loopback_frame *slot;
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+loopback = ( loopback_port * ) port;
+
+if( loopback->count == 0 )
+    {
+    *errors = RX_TIMEOUT;
+    return false;
+    }
+
+slot = &loopback->queue[ loopback->head ];
+loopback->head = ( loopback->head + 1 ) % LOOPBACK_QUEUE_SIZE;
+loopback->count--;
+
+/*----------------------------------------------------------
+Hand back frame, truncated frames are reported like the
+radio would report an oversized payload
+----------------------------------------------------------*/
+if( slot->size > max_size )
+    {
+    *size   = 0;
+    *errors = RX_ARRAY_SIZE_ERR;
+    return true;
+    }
+
+memcpy( message_array, slot->data, slot->size );
+*size   = slot->size;
+*errors = RX_NO_ERROR;
+
+return true;
+
+} /* loopback_get() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       loopback_rx_mode
+*
+*   DESCRIPTION:
+*       no mode switch needed for loopback
+*
+*********************************************************************/
+static bool loopback_rx_mode
+    (
+    void *port
+    )
+{
+( void ) port;
+
+return true;
+
+} /* loopback_rx_mode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       loopback_transport
+*
+*   DESCRIPTION:
+*       return transport backed by an in-memory frame queue. frames
+*       sent through port are received on peer, pass NULL to have
+*       port receive its own frames.
+*
+*********************************************************************/
+msg_transport loopback_transport
+    (
+    loopback_port *port,
+    loopback_port *peer
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+
+/*----------------------------------------------------------
+Bind port and peer
+----------------------------------------------------------*/
+memset( port, 0, sizeof( *port ) );
+port->peer = ( peer != NULL ) ? peer : port;
+
+transport.init      = loopback_init;
+transport.send      = loopback_send;
+transport.get       = loopback_get;
+transport.rx_mode   = loopback_rx_mode;
+transport.port      = port;
+transport.wait_fd   = NULL;
+
+return transport;
+
+} /* loopback_transport() */
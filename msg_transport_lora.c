@@ -0,0 +1,167 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_transport_lora.c
+*
+*   DESCRIPTION:
+*       msg_transport backend for the SX127x through the LoRa API
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_transport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_transport_init
+*
+*   DESCRIPTION:
+*       setup SPI port for the transceiver
+*
+*********************************************************************/
+static lora_errors lora_transport_init
+    (
+    void *port,
+    lora_config config_data
+    )
+{
+( void ) port;
+
+lora_port_init( config_data );
+
+return RX_NO_ERROR;
+
+} /* lora_transport_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_transport_send
+*
+*   DESCRIPTION:
+*       transmit buffer through the transceiver
+*
+*********************************************************************/
+static lora_errors lora_transport_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+( void ) port;
+
+return lora_send_message( message_array, size );
+
+} /* lora_transport_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_transport_get
+*
+*   DESCRIPTION:
+*       read buffer from the transceiver fifo
+*
+*********************************************************************/
+static bool lora_transport_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+( void ) port;
+
+return lora_get_message( message_array, max_size, size, errors );
+
+} /* lora_transport_get() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_transport_rx_mode
+*
+*   DESCRIPTION:
+*       put transceiver into continuous rx mode
+*
+*********************************************************************/
+static bool lora_transport_rx_mode
+    (
+    void *port
+    )
+{
+( void ) port;
+
+return lora_init_continious_rx();
+
+} /* lora_transport_rx_mode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       lora_transport
+*
+*   DESCRIPTION:
+*       return transport backed by the LoRa API
+*
+*********************************************************************/
+msg_transport lora_transport
+    (
+    void
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+
+/*----------------------------------------------------------
+Fill in operations, LoRa API keeps its own port state
+----------------------------------------------------------*/
+transport.init      = lora_transport_init;
+transport.send      = lora_transport_send;
+transport.get       = lora_transport_get;
+transport.rx_mode   = lora_transport_rx_mode;
+transport.port      = NULL;
+transport.wait_fd   = NULL;
+
+return transport;
+
+} /* lora_transport() */
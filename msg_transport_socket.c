@@ -0,0 +1,407 @@
+/*********************************************************************
+*
+*   NAME:
+*       msg_transport_socket.c
+*
+*   DESCRIPTION:
+*       datagram socket msg_transport backend for host builds. each
+*       frame is carried in one UNIX domain or UDP datagram so two
+*       processes can talk messageAPI without radios.
+*
+*   Copyright 2020 Nate Lenze
+*
+*********************************************************************/
+
+/*--------------------------------------------------------------------
+                           GENERAL INCLUDES
+--------------------------------------------------------------------*/
+
+#include "msg_transport.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*--------------------------------------------------------------------
+                          LITERAL CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                TYPES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                           MEMORY CONSTANTS
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                              VARIABLES
+--------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------
+                                MACROS
+--------------------------------------------------------------------*/
+_Static_assert( sizeof( ( ( socket_port * ) 0 )->peer_addr ) >= sizeof( struct sockaddr_storage ),
+                "socket_port peer_addr too small for sockaddr_storage" );
+
+/*--------------------------------------------------------------------
+                              PROCEDURES
+--------------------------------------------------------------------*/
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_init
+*
+*   DESCRIPTION:
+*       socket is opened by socket_open_*, nothing to do here
+*
+*********************************************************************/
+static lora_errors socket_init
+    (
+    void *port,
+    lora_config config_data
+    )
+{
+( void ) config_data;
+
+return ( ( ( socket_port * ) port )->fd >= 0 ) ? RX_NO_ERROR : RX_INIT_ERR;
+
+} /* socket_init() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_send
+*
+*   DESCRIPTION:
+*       send buffer as a single datagram to the peer
+*
+*********************************************************************/
+static lora_errors socket_send
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t size
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+socket_port *sock;
+ssize_t sent;
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+sock = ( socket_port * ) port;
+
+sent = sendto( sock->fd, message_array, size, 0,
+               ( struct sockaddr * ) sock->peer_addr, ( socklen_t ) sock->peer_addr_len );
+
+/*----------------------------------------------------------
+A missing peer is treated like nobody listening on air
+----------------------------------------------------------*/
+if( sent < 0 && errno != ECONNREFUSED && errno != ENOENT )
+    {
+    return RX_INIT_ERR;
+    }
+
+return RX_NO_ERROR;
+
+} /* socket_send() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_get
+*
+*   DESCRIPTION:
+*       non-blocking read of one datagram
+*
+*   RETURN:
+*       T/F frame received y/n
+*
+*********************************************************************/
+static bool socket_get
+    (
+    void *port,
+    uint8_t message_array[],
+    uint8_t max_size,
+    uint8_t *size,
+    lora_errors *errors
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+socket_port *sock;
+ssize_t received;
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+sock = ( socket_port * ) port;
+
+/*----------------------------------------------------------
+MSG_TRUNC reports the real datagram length so oversized
+frames can be flagged
+----------------------------------------------------------*/
+received = recv( sock->fd, message_array, max_size, MSG_DONTWAIT | MSG_TRUNC );
+
+if( received < 0 )
+    {
+    *errors = RX_TIMEOUT;
+    return false;
+    }
+
+if( received > max_size )
+    {
+    *size   = 0;
+    *errors = RX_ARRAY_SIZE_ERR;
+    return true;
+    }
+
+*size   = ( uint8_t ) received;
+*errors = RX_NO_ERROR;
+
+return true;
+
+} /* socket_get() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_rx_mode
+*
+*   DESCRIPTION:
+*       sockets are always receiving
+*
+*********************************************************************/
+static bool socket_rx_mode
+    (
+    void *port
+    )
+{
+( void ) port;
+
+return true;
+
+} /* socket_rx_mode() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_wait_fd
+*
+*   DESCRIPTION:
+*       socket descriptor, readable when a datagram is waiting
+*
+*********************************************************************/
+static int socket_wait_fd
+    (
+    void *port
+    )
+{
+
+return ( ( socket_port * ) port )->fd;
+
+} /* socket_wait_fd() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_open_unix
+*
+*   DESCRIPTION:
+*       open UNIX domain datagram socket bound to local_path that
+*       sends to peer_path
+*
+*   RETURN:
+*       T/F socket opened y/n
+*
+*********************************************************************/
+bool socket_open_unix
+    (
+    socket_port *port,
+    const char *local_path,
+    const char *peer_path
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+struct sockaddr_un local;
+struct sockaddr_un peer;
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( port, 0, sizeof( *port ) );
+memset( &local, 0, sizeof( local ) );
+memset( &peer, 0, sizeof( peer ) );
+port->fd = -1;
+
+if( strlen( local_path ) >= sizeof( local.sun_path )
+ || strlen( peer_path ) >= sizeof( peer.sun_path ) )
+    {
+    return false;
+    }
+
+local.sun_family = AF_UNIX;
+strcpy( local.sun_path, local_path );
+peer.sun_family = AF_UNIX;
+strcpy( peer.sun_path, peer_path );
+
+/*----------------------------------------------------------
+Open and bind, stale socket files are removed first
+----------------------------------------------------------*/
+port->fd = socket( AF_UNIX, SOCK_DGRAM, 0 );
+if( port->fd < 0 )
+    {
+    return false;
+    }
+
+unlink( local_path );
+if( bind( port->fd, ( struct sockaddr * ) &local, sizeof( local ) ) != 0 )
+    {
+    socket_close( port );
+    return false;
+    }
+
+memcpy( port->peer_addr, &peer, sizeof( peer ) );
+port->peer_addr_len = sizeof( peer );
+
+return true;
+
+} /* socket_open_unix() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_open_udp
+*
+*   DESCRIPTION:
+*       open UDP socket bound to local_port that sends to
+*       peer_ip:peer_port
+*
+*   RETURN:
+*       T/F socket opened y/n
+*
+*********************************************************************/
+bool socket_open_udp
+    (
+    socket_port *port,
+    uint16_t local_port,
+    const char *peer_ip,
+    uint16_t peer_port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+struct sockaddr_in local;
+struct sockaddr_in peer;
+
+/*----------------------------------------------------------
+Initilize local variables
+----------------------------------------------------------*/
+memset( port, 0, sizeof( *port ) );
+memset( &local, 0, sizeof( local ) );
+memset( &peer, 0, sizeof( peer ) );
+port->fd = -1;
+
+local.sin_family        = AF_INET;
+local.sin_addr.s_addr   = htonl( INADDR_ANY );
+local.sin_port          = htons( local_port );
+
+peer.sin_family         = AF_INET;
+peer.sin_port           = htons( peer_port );
+if( inet_pton( AF_INET, peer_ip, &peer.sin_addr ) != 1 )
+    {
+    return false;
+    }
+
+/*----------------------------------------------------------
+Open and bind
+----------------------------------------------------------*/
+port->fd = socket( AF_INET, SOCK_DGRAM, 0 );
+if( port->fd < 0 )
+    {
+    return false;
+    }
+
+if( bind( port->fd, ( struct sockaddr * ) &local, sizeof( local ) ) != 0 )
+    {
+    socket_close( port );
+    return false;
+    }
+
+memcpy( port->peer_addr, &peer, sizeof( peer ) );
+port->peer_addr_len = sizeof( peer );
+
+return true;
+
+} /* socket_open_udp() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_close
+*
+*   DESCRIPTION:
+*       close socket opened by socket_open_*
+*
+*********************************************************************/
+void socket_close
+    (
+    socket_port *port
+    )
+{
+
+if( port->fd >= 0 )
+    {
+    close( port->fd );
+    }
+
+port->fd = -1;
+
+} /* socket_close() */
+
+/*********************************************************************
+*
+*   PROCEDURE NAME:
+*       socket_transport
+*
+*   DESCRIPTION:
+*       return transport backed by an opened datagram socket
+*
+*********************************************************************/
+msg_transport socket_transport
+    (
+    socket_port *port
+    )
+{
+/*----------------------------------------------------------
+Local variables
+----------------------------------------------------------*/
+msg_transport transport;
+
+transport.init      = socket_init;
+transport.send      = socket_send;
+transport.get       = socket_get;
+transport.rx_mode   = socket_rx_mode;
+transport.port      = port;
+transport.wait_fd   = socket_wait_fd;
+
+return transport;
+
+} /* socket_transport() */
@@ -7,6 +7,8 @@
 *   Copyright 2020 Nate Lenze
 *
 *********************************************************************/
+#ifndef SYS_DEF_H
+#define SYS_DEF_H
 
 /*--------------------------------------------------------------------
                            GENERAL INCLUDES
@@ -26,15 +28,17 @@ typedef uint8_t location;          /* source/destination data. add
                                       new modules to begining of
                                       enum, as code uses 
                                       'NUM_OF_MODULES' defined 
-                                      below                         */
+                                      below. modules added at run
+                                      time with register_module()
+                                      need no entry             */
 enum 
     {
     RPI_MODULE,                    /* raspberry pi module           */
     TIVA_MODULE,                   /* tiva launchpad module         */
-    NUM_OF_MODULES,                /* number of modules             */
+    NUM_OF_MODULES,                /* modules known at build time   */
     
-    MODULE_NONE,                   /* no module                     */
-    INVALID_LOCATION               /* invalid module address        */
+    MODULE_NONE = 0xDE,            /* no module                     */
+    INVALID_LOCATION = 0xDF        /* invalid module address        */
     }; 
 
 
@@ -58,4 +62,5 @@ extern const location current_location;   /* current module needs to be
                               PROCEDURES
 --------------------------------------------------------------------*/
 
+#endif /* SYS_DEF_H */
 /* sys_def.h */